@@ -0,0 +1,88 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "db.h"
+#include "log.h"
+#include "sqlite3.h"
+#include "uuid4.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// benches run in an empty working directory made by `make bench`,
+// database files they create there are thrown away afterwards
+
+typedef struct {
+    int id;
+    char uuid[UUID4_LEN];
+    char session_key[UUID4_LEN];
+} BenchUser;
+
+static inline double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// sqlite, uuids and databases the way main does it, quiet logs
+static inline int bench_init_db(void)
+{
+    LogMaxVerbosity = LOG_VERBOSITY_Error;
+    if (sqlite3_initialize() != SQLITE_OK || uuid4_init() || init_db()) {
+        fprintf(stderr, "bench: cant init db\n");
+        return -1;
+    }
+    return 0;
+}
+
+// users with one session each, password hashes are never checked
+static inline int bench_create_users(BenchUser* users, size_t users_len, const char* prefix)
+{
+    char password_hash[] = "-";
+    for (size_t i = 0; i < users_len; i++) {
+        char nickname[64];
+        snprintf(nickname, sizeof(nickname), "%s%zu", prefix, i);
+        uuid4_generate(users[i].uuid);
+        uuid4_generate(users[i].session_key);
+
+        const User user = {
+            .uuid = users[i].uuid,
+            .nickname = nickname,
+            .password_hash = password_hash,
+            .password_hash_pow = password_hash,
+        };
+        if (add_user_to_db(&user) || get_user_id_by_uuid(users[i].uuid, &users[i].id)) {
+            fprintf(stderr, "bench: cant create user %s\n", nickname);
+            return -1;
+        }
+
+        const Session session = {
+            .session_key = users[i].session_key,
+            .user_id = users[i].id,
+        };
+        if (add_session_to_db(&session)) {
+            fprintf(stderr, "bench: cant create session of %s\n", nickname);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline int bench_add_message(const BenchUser* sender, const BenchUser* receiver, const char* data)
+{
+    char uuid[UUID4_LEN];
+    uuid4_generate(uuid);
+    time_t now = time(NULL);
+    const Message message = {
+        .created_at = now,
+        .updated_at = now,
+        .uuid = uuid,
+        .sender_id = sender->id,
+        .receiver_id = receiver->id,
+        .data = (char*)data,
+    };
+    return add_message_to_db(&message);
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include "bench.h"
+#include "event_bus.h"
+#include "events.h"
+#include <string.h>
+
+// one group message to groups of 10, 100 and 1000 members, every one
+// of them connected to event bus: whole send the way
+// add_group_message_route does it, then its fan-out alone against
+// putting the event into every member queue one lookup at a time
+
+#define BENCH_USERS 1000
+#define BENCH_SENDS 200
+
+static BenchUser users[BENCH_USERS];
+static EventBus eb;
+static int queue_indexes[BENCH_USERS];
+
+static void drain_queues(size_t members)
+{
+    for (size_t i = 0; i < members; i++) {
+        EventBase* ev;
+        while (try_get_new_event_in_queue_by_index(&eb, queue_indexes[i], &ev) == 0) {
+            free_event_base(ev);
+        }
+    }
+}
+
+static int run_group(size_t members)
+{
+    char group_uuid[UUID4_LEN];
+    char name[] = "bench";
+    int member_ids[BENCH_USERS];
+    for (size_t i = 0; i < members; i++) {
+        member_ids[i] = users[i].id;
+    }
+
+    uuid4_generate(group_uuid);
+    const Group group = {
+        .uuid = group_uuid,
+        .name = name,
+        .owner_id = users[0].id,
+        .created_at = time(NULL),
+    };
+    if (create_group_in_db(&group, member_ids, members)) {
+        fprintf(stderr, "bench: cant create group of %zu\n", members);
+        return -1;
+    }
+
+    for (size_t i = 0; i < members; i++) {
+        queue_indexes[i] = add_new_user_id_with_queue_to_event_bus(&eb, users[i].id);
+    }
+
+    double send = 0, fan_out = 0, per_member = 0;
+    for (int s = 0; s < BENCH_SENDS; s++) {
+        char uuid[UUID4_LEN];
+        char data[] = "hello everyone in this group";
+        uuid4_generate(uuid);
+
+        double started = bench_now();
+        int group_id = 0;
+        int* ids;
+        size_t ids_len;
+        if (get_group_members_by_uuid(group_uuid, users[0].id, &group_id, &ids, &ids_len)) {
+            fprintf(stderr, "bench: cant read members\n");
+            return -1;
+        }
+
+        time_t now = time(NULL);
+        const GroupMessage message = {
+            .created_at = now,
+            .updated_at = now,
+            .uuid = uuid,
+            .group_id = group_id,
+            .sender_id = users[0].id,
+            .data = data,
+        };
+        if (add_group_message_to_db(&message)) {
+            fprintf(stderr, "bench: cant add group message\n");
+            free(ids);
+            return -1;
+        }
+
+        // sender does not get its own message, ids stay sorted
+        size_t receivers_len = 0;
+        for (size_t i = 0; i < ids_len; i++) {
+            if (ids[i] != message.sender_id) {
+                ids[receivers_len++] = ids[i];
+            }
+        }
+
+        EventGroupMessage ev;
+        double fan_out_started = bench_now();
+        if (create_event_group_message(&ev, group_uuid, uuid, users[0].uuid, data, now)) {
+            free(ids);
+            return -1;
+        }
+        add_new_event_to_queues_by_user_ids(&eb, ids, receivers_len, (EventBase*)&ev);
+        free_event_group_message(&ev);
+        double finished = bench_now();
+        send += finished - started;
+        fan_out += finished - fan_out_started;
+        drain_queues(members);
+
+        started = bench_now();
+        if (create_event_group_message(&ev, group_uuid, uuid, users[0].uuid, data, now)) {
+            free(ids);
+            return -1;
+        }
+        for (size_t i = 0; i < receivers_len; i++) {
+            add_new_event_to_queue_by_user_id(&eb, ids[i], (EventBase*)&ev);
+        }
+        free_event_group_message(&ev);
+        per_member += bench_now() - started;
+        drain_queues(members);
+
+        free(ids);
+    }
+
+    for (size_t i = 0; i < members; i++) {
+        disconnect_from_queue_by_index(&eb, queue_indexes[i]);
+    }
+
+    printf("%4zu members  send %8.3f ms  fan-out %8.3f ms  per member lookup %8.3f ms\n",
+        members, send * 1000 / BENCH_SENDS, fan_out * 1000 / BENCH_SENDS, per_member * 1000 / BENCH_SENDS);
+    return 0;
+}
+
+int main(void)
+{
+    if (bench_init_db() || bench_create_users(users, BENCH_USERS, "u") || create_event_bus(&eb)) {
+        return 1;
+    }
+
+    const size_t groups[] = { 10, 100, 1000 };
+    for (size_t i = 0; i < sizeof(groups) / sizeof(groups[0]); i++) {
+        if (run_group(groups[i])) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include "bench.h"
+#include "http.h"
+#include "json_reader.h"
+#include <string.h>
+
+// request body decoding, generated JSON_DECODER against lookups of
+// every field with yyjson_obj_get the routes used before it; body
+// is copied into a padded buffer per run as in place parsing eats it
+
+#define BENCH_RUNS 1000000
+
+typedef struct {
+    char* session_key;
+    char* msg;
+    char* receiver_uuid;
+} SmallInput;
+
+#define SMALL_INPUT_FIELDS(FIELD)             \
+    FIELD(SmallInput, session_key, string)    \
+    FIELD(SmallInput, msg, string)            \
+    FIELD(SmallInput, receiver_uuid, string)
+
+JSON_DECODER(parse_small_input, SmallInput, SMALL_INPUT_FIELDS)
+
+typedef struct {
+    char* f0;
+    char* f1;
+    char* f2;
+    char* f3;
+    char* f4;
+    char* f5;
+    char* f6;
+    char* f7;
+    char* f8;
+    char* f9;
+} WideInput;
+
+#define WIDE_INPUT_FIELDS(FIELD) \
+    FIELD(WideInput, f0, string) \
+    FIELD(WideInput, f1, string) \
+    FIELD(WideInput, f2, string) \
+    FIELD(WideInput, f3, string) \
+    FIELD(WideInput, f4, string) \
+    FIELD(WideInput, f5, string) \
+    FIELD(WideInput, f6, string) \
+    FIELD(WideInput, f7, string) \
+    FIELD(WideInput, f8, string) \
+    FIELD(WideInput, f9, string)
+
+JSON_DECODER(parse_wide_input, WideInput, WIDE_INPUT_FIELDS)
+
+static int obj_get_string(yyjson_val* root, const char* key, char** dst)
+{
+    yyjson_val* val = yyjson_obj_get(root, key);
+    if (!yyjson_is_str(val)) {
+        return -1;
+    }
+    *dst = (char*)yyjson_get_str(val);
+    return 0;
+}
+
+static int parse_small_input_obj_get(size_t json_len, char* json, SmallInput* out)
+{
+    yyjson_doc* doc = json_read_insitu(json, json_len);
+    if (!doc) {
+        return -2;
+    }
+    yyjson_val* root = yyjson_doc_get_root(doc);
+    int rc = !yyjson_is_obj(root) ? -3
+        : obj_get_string(root, "session_key", &out->session_key)
+            || obj_get_string(root, "msg", &out->msg)
+            || obj_get_string(root, "receiver_uuid", &out->receiver_uuid)
+        ? -4
+        : 0;
+    yyjson_doc_free(doc);
+    return rc;
+}
+
+static int parse_wide_input_obj_get(size_t json_len, char* json, WideInput* out)
+{
+    yyjson_doc* doc = json_read_insitu(json, json_len);
+    if (!doc) {
+        return -2;
+    }
+    yyjson_val* root = yyjson_doc_get_root(doc);
+    int rc = !yyjson_is_obj(root) ? -3
+        : obj_get_string(root, "f0", &out->f0) || obj_get_string(root, "f1", &out->f1)
+            || obj_get_string(root, "f2", &out->f2) || obj_get_string(root, "f3", &out->f3)
+            || obj_get_string(root, "f4", &out->f4) || obj_get_string(root, "f5", &out->f5)
+            || obj_get_string(root, "f6", &out->f6) || obj_get_string(root, "f7", &out->f7)
+            || obj_get_string(root, "f8", &out->f8) || obj_get_string(root, "f9", &out->f9)
+        ? -4
+        : 0;
+    yyjson_doc_free(doc);
+    return rc;
+}
+
+typedef int (*Decoder)(size_t json_len, char* json, void* out);
+
+static double run(Decoder decode, const char* body, void* out)
+{
+    size_t len = strlen(body);
+    char* buf = calloc(1, len + HTTP_REQUEST_BODY_PADDING);
+    if (!buf) {
+        exit(1);
+    }
+
+    double started = bench_now();
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        memcpy(buf, body, len);
+        if (decode(len, buf, out)) {
+            fprintf(stderr, "bench: cant decode '%s'\n", body);
+            exit(1);
+        }
+    }
+    double elapsed = bench_now() - started;
+
+    free(buf);
+    return elapsed * 1e9 / BENCH_RUNS;
+}
+
+static void compare(const char* name, Decoder generated, Decoder obj_get, const char* body, void* out)
+{
+    // warm up pools and caches
+    run(generated, body, out);
+    double g = run(generated, body, out);
+    double o = run(obj_get, body, out);
+    printf("%-28s %5zu B  JSON_DECODER %7.1f ns  obj_get %7.1f ns\n", name, strlen(body), g, o);
+}
+
+int main(void)
+{
+    LogMaxVerbosity = LOG_VERBOSITY_Error;
+
+    char text[1100];
+    memset(text, 'x', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+
+    char small[256];
+    snprintf(small, sizeof(small),
+        "{\"session_key\":\"4f1c2a0e-7b55-4d6a-9a53-1d1f0c9e2b77\",\"msg\":\"hello there\","
+        "\"receiver_uuid\":\"0b6c5f1e-2d3a-4f8b-8c7d-9e1a2b3c4d5e\"}");
+    char small_long[1400];
+    snprintf(small_long, sizeof(small_long),
+        "{\"session_key\":\"4f1c2a0e-7b55-4d6a-9a53-1d1f0c9e2b77\",\"msg\":\"%s\","
+        "\"receiver_uuid\":\"0b6c5f1e-2d3a-4f8b-8c7d-9e1a2b3c4d5e\"}", text);
+    const char wide[] = "{\"f0\":\"a\",\"f1\":\"b\",\"f2\":\"c\",\"f3\":\"d\",\"f4\":\"e\","
+                        "\"f5\":\"f\",\"f6\":\"g\",\"f7\":\"h\",\"f8\":\"i\",\"f9\":\"j\"}";
+    const char wide_reversed[] = "{\"f9\":\"j\",\"f8\":\"i\",\"f7\":\"h\",\"f6\":\"g\",\"f5\":\"f\","
+                                 "\"f4\":\"e\",\"f3\":\"d\",\"f2\":\"c\",\"f1\":\"b\",\"f0\":\"a\"}";
+
+    SmallInput s;
+    WideInput w;
+    compare("add_message", (Decoder)parse_small_input, (Decoder)parse_small_input_obj_get, small, &s);
+    compare("add_message, 1KB msg", (Decoder)parse_small_input, (Decoder)parse_small_input_obj_get, small_long, &s);
+    compare("10 fields in order", (Decoder)parse_wide_input, (Decoder)parse_wide_input_obj_get, wide, &w);
+    compare("10 fields reversed", (Decoder)parse_wide_input, (Decoder)parse_wide_input_obj_get, wide_reversed, &w);
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "bench.h"
+#include <string.h>
+
+// /messages/search latency over a bulk loaded corpus; rows are written
+// straight into messages and indexed with one fts rebuild, going
+// through add_message_to_db would take hours for ten million of them.
+// corpus size comes from BENCH_SEARCH_MESSAGES, request asked for 10M:
+// BENCH_SEARCH_MESSAGES=10000000 make bench DEBUG=0
+
+#define BENCH_USERS 1000
+#define BENCH_DEFAULT_MESSAGES 1000000
+#define BENCH_VOCABULARY 20000
+#define BENCH_WORDS_PER_MESSAGE 8
+#define BENCH_QUERIES 200
+#define BENCH_PAGE 20
+
+static BenchUser users[BENCH_USERS];
+
+// skewed towards low indexes, so low words are common and high rare
+static int pick_word(unsigned* seed)
+{
+    double r = (double)rand_r(seed) / RAND_MAX;
+    return (int)(r * r * r * (BENCH_VOCABULARY - 1));
+}
+
+static int load_corpus(long messages)
+{
+    sqlite3* db;
+    if (sqlite3_open_v2("main.db", &db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK) {
+        fprintf(stderr, "bench: cant open main.db: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sqlite3_stmt* stmt;
+    const char* sql = "INSERT INTO messages(created_at, updated_at, uuid, sender_id, receiver_id, data) VALUES(?, ?, randomblob(16), ?, ?, ?);";
+    if (sqlite3_exec(db, "pragma synchronous = off; BEGIN;", NULL, NULL, NULL) != SQLITE_OK
+        || sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "bench: cant prepare corpus load: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return -1;
+    }
+
+    unsigned seed = 1;
+    time_t now = time(NULL);
+    for (long i = 0; i < messages; i++) {
+        char data[BENCH_WORDS_PER_MESSAGE * 8];
+        size_t data_len = 0;
+        for (int w = 0; w < BENCH_WORDS_PER_MESSAGE; w++) {
+            data_len += snprintf(data + data_len, sizeof(data) - data_len, "%sw%d", w ? " " : "", pick_word(&seed));
+        }
+
+        sqlite3_bind_int64(stmt, 1, now);
+        sqlite3_bind_int64(stmt, 2, now);
+        sqlite3_bind_int(stmt, 3, users[rand_r(&seed) % BENCH_USERS].id);
+        sqlite3_bind_int(stmt, 4, users[rand_r(&seed) % BENCH_USERS].id);
+        sqlite3_bind_text(stmt, 5, data, data_len, SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            fprintf(stderr, "bench: cant insert corpus row: %s\n", sqlite3_errmsg(db));
+            sqlite3_finalize(stmt);
+            sqlite3_close(db);
+            return -1;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    if (sqlite3_exec(db, "INSERT INTO messages_fts(messages_fts) VALUES('rebuild'); COMMIT;", NULL, NULL, NULL) != SQLITE_OK) {
+        fprintf(stderr, "bench: cant index corpus: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return -1;
+    }
+
+    sqlite3_close(db);
+    return 0;
+}
+
+static int run_queries(const char* name, const char* fmt, int word_lo, int word_hi)
+{
+    unsigned seed = 3;
+    double total = 0, max = 0;
+    size_t found = 0;
+    for (int i = 0; i < BENCH_QUERIES; i++) {
+        char query[64];
+        int word = word_lo + rand_r(&seed) % (word_hi - word_lo);
+        snprintf(query, sizeof(query), fmt, word, word + 1);
+
+        MessageSearchResult* msgs;
+        size_t msgs_len;
+        double started = bench_now();
+        if (search_messages_by_user_id_from_session_key(
+                users[rand_r(&seed) % BENCH_USERS].session_key, query, 0, BENCH_PAGE, &msgs, &msgs_len)) {
+            fprintf(stderr, "bench: search '%s' failed\n", query);
+            return -1;
+        }
+        double elapsed = (bench_now() - started) * 1000;
+        free_message_search_results(msgs, msgs_len);
+
+        total += elapsed;
+        max = elapsed > max ? elapsed : max;
+        found += msgs_len;
+    }
+
+    printf("%-16s avg %8.3f ms  max %8.3f ms  %5.1f hits/query\n",
+        name, total / BENCH_QUERIES, max, (double)found / BENCH_QUERIES);
+    return 0;
+}
+
+int main(void)
+{
+    const char* env = getenv("BENCH_SEARCH_MESSAGES");
+    long messages = env ? atol(env) : BENCH_DEFAULT_MESSAGES;
+
+    if (bench_init_db() || bench_create_users(users, BENCH_USERS, "u")) {
+        return 1;
+    }
+
+    double started = bench_now();
+    if (load_corpus(messages)) {
+        return 1;
+    }
+    printf("corpus: %ld messages, %d users, loaded and indexed in %.1f s\n",
+        messages, BENCH_USERS, bench_now() - started);
+
+    // ranks of common words cover most of corpus, rare ones a few rows
+    if (run_queries("common word", "w%d", 0, 10)
+        || run_queries("rare word", "w%d", BENCH_VOCABULARY - 2000, BENCH_VOCABULARY - 1)
+        || run_queries("prefix", "w%d*", 10, 100)
+        || run_queries("two words", "w%d w%d", 0, 100)) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "bench.h"
+#include "trinity.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// sqlite threading modes compared on pooled connections the way
+// server uses them: readers resolve sessions and list contacts
+// while one writer keeps adding messages; mode can only be chosen
+// before sqlite3_initialize, so every mode runs in its own process
+
+#define BENCH_USERS 200
+#define BENCH_SEED_MESSAGES 20000
+#define BENCH_READERS NUM_THREADS
+#define BENCH_SECONDS 3
+
+static BenchUser users[BENCH_USERS];
+static atomic_int stop;
+static atomic_long reads;
+static atomic_long writes;
+
+static void* reader(void* arg)
+{
+    unsigned seed = (unsigned)(size_t)arg;
+    while (!atomic_load(&stop)) {
+        BenchUser* u = &users[rand_r(&seed) % BENCH_USERS];
+
+        int user_id;
+        SenderUuidAndNickname* senders;
+        size_t senders_len;
+        if (get_user_id_by_session_key(u->session_key, &user_id)
+            || get_all_senders_uuid_and_nicknames_by_user_id_from_session_key(u->session_key, &senders, &senders_len)) {
+            fprintf(stderr, "bench: read failed\n");
+            exit(1);
+        }
+        for (size_t i = 0; i < senders_len; i++) {
+            free(senders[i].uuid);
+            free(senders[i].nickname);
+        }
+        free(senders);
+        atomic_fetch_add(&reads, 2);
+    }
+    return NULL;
+}
+
+static void* writer(void* arg)
+{
+    unsigned seed = 1;
+    while (!atomic_load(&stop)) {
+        if (bench_add_message(&users[rand_r(&seed) % BENCH_USERS], &users[rand_r(&seed) % BENCH_USERS], "bench")) {
+            fprintf(stderr, "bench: write failed\n");
+            exit(1);
+        }
+        atomic_fetch_add(&writes, 1);
+    }
+    return NULL;
+}
+
+static int run_mode(const char* name, int mode)
+{
+    if (mkdir(name, 0700) || chdir(name)) {
+        perror("bench: cant make mode directory");
+        return -1;
+    }
+
+    if (sqlite3_config(mode) != SQLITE_OK) {
+        fprintf(stderr, "bench: sqlite3 library does not support %s mode\n", name);
+        return -1;
+    }
+
+    if (bench_init_db() || bench_create_users(users, BENCH_USERS, "u")) {
+        return -1;
+    }
+
+    unsigned seed = 2;
+    for (int i = 0; i < BENCH_SEED_MESSAGES; i++) {
+        if (bench_add_message(&users[rand_r(&seed) % BENCH_USERS], &users[rand_r(&seed) % BENCH_USERS], "seed")) {
+            return -1;
+        }
+    }
+
+    pthread_t threads[BENCH_READERS + 1];
+    double started = bench_now();
+    pthread_create(&threads[BENCH_READERS], NULL, writer, NULL);
+    for (size_t i = 0; i < BENCH_READERS; i++) {
+        pthread_create(&threads[i], NULL, reader, (void*)(i + 1));
+    }
+
+    sleep(BENCH_SECONDS);
+    atomic_store(&stop, 1);
+    for (size_t i = 0; i <= BENCH_READERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = bench_now() - started;
+
+    printf("%-12s %10.0f reads/s %8.0f writes/s (%d readers, 1 writer)\n",
+        name, atomic_load(&reads) / elapsed, atomic_load(&writes) / elapsed, BENCH_READERS);
+    return 0;
+}
+
+int main(void)
+{
+    const struct {
+        const char* name;
+        int mode;
+    } modes[] = {
+        { "multithread", SQLITE_CONFIG_MULTITHREAD },
+        { "serialized", SQLITE_CONFIG_SERIALIZED },
+    };
+
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            int rc = run_mode(modes[i].name, modes[i].mode);
+            fflush(stdout);
+            _exit(rc ? 1 : 0);
+        }
+
+        int status;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+            fprintf(stderr, "bench: %s mode failed\n", modes[i].name);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "bench.h"
+#include "events.h"
+#include "json_writer.h"
+#include <string.h>
+
+// size and encode time of each wire format: a /messages page written
+// row by row the way get_messages does, and events as subscribers
+// get them; json events copy their prebuilt text, binary ones are
+// encoded per subscriber
+
+#define BENCH_RUNS 100000
+#define BENCH_PAGE_ROWS 100
+
+static const char* format_names[] = {
+    [WireFormatJson] = "json",
+    [WireFormatMsgPack] = "msgpack",
+    [WireFormatCbor] = "cbor",
+};
+
+static char* encode_page(WireFormat format, const char* data, size_t* len)
+{
+    // msgpack pages are a sequence of maps, see get_messages
+    int sequence = format == WireFormatMsgPack;
+    JsonWriter w;
+    json_writer_init_format(&w, 16 * 1024, format);
+    if (!sequence) {
+        json_writer_begin_array(&w);
+    }
+    for (int i = 0; i < BENCH_PAGE_ROWS; i++) {
+        json_writer_begin_object(&w);
+        json_writer_key(&w, "data");
+        json_writer_string(&w, data);
+        json_writer_key(&w, "created_at");
+        json_writer_int(&w, 1700000000 + i);
+        json_writer_key(&w, "updated_at");
+        json_writer_int(&w, 1700000000 + i);
+        json_writer_end_object(&w);
+    }
+    if (!sequence) {
+        json_writer_end_array(&w);
+    }
+    return json_writer_finish(&w, len);
+}
+
+static void run_page(const char* name, const char* data)
+{
+    for (WireFormat f = WireFormatJson; f <= WireFormatCbor; f++) {
+        size_t len = 0;
+        double started = bench_now();
+        for (int i = 0; i < BENCH_RUNS / 10; i++) {
+            free(encode_page(f, data, &len));
+        }
+        double ns = (bench_now() - started) * 1e9 / (BENCH_RUNS / 10);
+        printf("%-26s %-8s %7zu B  %9.1f ns\n", name, format_names[f], len, ns);
+    }
+}
+
+static void run_event(const char* name, EventBase* ev)
+{
+    for (WireFormat f = WireFormatJson; f <= WireFormatCbor; f++) {
+        size_t len = 0;
+        double started = bench_now();
+        for (int i = 0; i < BENCH_RUNS; i++) {
+            char* data = encode_event_base(ev, f, &len);
+            if (!data) {
+                fprintf(stderr, "bench: cant encode %s\n", name);
+                exit(1);
+            }
+            free(data);
+        }
+        double ns = (bench_now() - started) * 1e9 / BENCH_RUNS;
+        printf("%-26s %-8s %7zu B  %9.1f ns\n", name, format_names[f], len, ns);
+    }
+}
+
+int main(void)
+{
+    LogMaxVerbosity = LOG_VERBOSITY_Error;
+
+    const char* uuid = "4f1c2a0e-7b55-4d6a-9a53-1d1f0c9e2b77";
+    char text[1025];
+    memset(text, 'x', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+
+    run_page("page, 100 short messages", "hello there, see you at 8?");
+    run_page("page, 100 1KB messages", text);
+
+    EventTyping typing;
+    EventGroupMessage group;
+    if (create_event_typing(&typing, uuid, 1700000000)
+        || create_event_group_message(&group, uuid, uuid, uuid, "hello there, see you at 8?", 1700000000)) {
+        fprintf(stderr, "bench: cant create events\n");
+        return 1;
+    }
+    run_event("typing event", &typing.base);
+    run_event("group message event", &group.base);
+    free_event_group_message(&group);
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "add_group_message.h"
+#include "db.h"
+#include "event_bus.h"
+#include "events.h"
+#include "json_reader.h"
+#include "log.h"
+#include "uuid4.h"
+#include <stdlib.h>
+
+#define ADD_GROUP_MESSAGE_INPUT_FIELDS(FIELD) \
+    FIELD(AddGroupMessageInput, session_key, string) \
+    FIELD(AddGroupMessageInput, group_uuid, string) \
+    FIELD(AddGroupMessageInput, msg, string)
+
+JSON_DECODER(parse_json_to_add_group_message_input, AddGroupMessageInput, ADD_GROUP_MESSAGE_INPUT_FIELDS)
+
+// event is serialized once, every online member gets a reference to it
+static void publish_group_message_event(
+    const char* group_uuid, const GroupMessage* message, int* member_ids, size_t member_ids_len)
+{
+    char sender_uuid[UUID4_LEN];
+    if (get_user_uuid_by_id(message->sender_id, sender_uuid)) {
+        LogErr("Cant find uuid of sender: user_id = %d", message->sender_id);
+        return;
+    }
+
+    // sender does not need its own message back, ids stay sorted
+    size_t receivers_len = 0;
+    for (size_t i = 0; i < member_ids_len; i++) {
+        if (member_ids[i] != message->sender_id) {
+            member_ids[receivers_len++] = member_ids[i];
+        }
+    }
+
+    EventGroupMessage ev;
+    if (create_event_group_message(&ev, group_uuid, message->uuid, sender_uuid, message->data, message->created_at)) {
+        LogErr("Cant create group message event");
+        return;
+    }
+
+    int delivered = add_new_event_to_queues_by_user_ids(global_event_bus, member_ids, receivers_len, (EventBase*)&ev);
+    LogTrace("Group message delivered to %d event streams", delivered);
+
+    free_event_group_message(&ev);
+}
+
+int add_group_message_route(HttpRequest* req, HttpResponse* res)
+{
+    LogInfo("add_group_message_route executed");
+
+    AddGroupMessageInput input;
+    if (parse_json_to_add_group_message_input(req->body_len, req->body, &input)) {
+        LogErr("Incorrect Json on Input: %zu bytes", req->body_len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    int user_id;
+    if (get_user_id_by_session_key(input.session_key, &user_id)) {
+        LogErr("Cant find such session key in db: session_key = '%s'", input.session_key);
+        create_http_response(res, "403", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    int group_id;
+    int* member_ids;
+    size_t member_ids_len;
+    if (get_group_members_by_uuid(input.group_uuid, user_id, &group_id, &member_ids, &member_ids_len)) {
+        LogErr("Cant find such group of user: group_uuid = '%s'", input.group_uuid);
+        create_http_response(res, "404", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    char message_uuid[UUID4_LEN];
+    uuid4_generate(message_uuid);
+
+    time_t current_time = time(NULL);
+
+    const GroupMessage message = {
+        .created_at = current_time,
+        .updated_at = current_time,
+        .uuid = message_uuid,
+        .group_id = group_id,
+        .sender_id = user_id,
+        .data = input.msg,
+    };
+
+    if (add_group_message_to_db(&message)) {
+        LogErr("Cant add group message to db");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        free(member_ids);
+        return 0;
+    }
+
+    publish_group_message_event(input.group_uuid, &message, member_ids, member_ids_len);
+
+    create_http_response_static_body(res, "200", NULL, 0, HTTP_LITERAL_BODY("message added"));
+    free(member_ids);
+
+    return 0;
+}
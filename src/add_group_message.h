@@ -0,0 +1,19 @@
+#ifndef ADD_GROUP_MESSAGE_H
+#define ADD_GROUP_MESSAGE_H
+
+#include "http.h"
+
+// fields point into json parsed by parse_json_to_add_group_message_input,
+// valid as long as it is and never freed
+typedef struct {
+    char* session_key;
+    char* group_uuid;
+    char* msg;
+} AddGroupMessageInput;
+
+// parses json in place, see json_read_insitu
+int parse_json_to_add_group_message_input(size_t json_len, char json[json_len], AddGroupMessageInput* model);
+
+int add_group_message_route(HttpRequest* req, HttpResponse* res);
+
+#endif
@@ -3,13 +3,15 @@
 
 #include "http.h"
 
+// fields point into json parsed by parse_json_to_add_message_input,
+// valid as long as it is and never freed
 typedef struct {
     char* session_key;
     char* msg;
     char* receiver_uuid;
 } AddMessageInput;
 
-void free_add_message_input(AddMessageInput* self);
+// parses json in place, see json_read_insitu
 int parse_json_to_add_message_input(size_t json_len, char json[json_len], AddMessageInput* model);
 
 int add_message_route(HttpRequest* req, HttpResponse* _);
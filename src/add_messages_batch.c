@@ -0,0 +1,230 @@
+#include "add_messages_batch.h"
+#include "db.h"
+#include "event_bus.h"
+#include "events.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "log.h"
+#include "uuid4.h"
+#include <stdlib.h>
+
+void free_add_messages_batch_input(AddMessagesBatchInput* self)
+{
+    if (!self)
+        return;
+    free(self->msgs.items);
+}
+
+#define ADD_MESSAGES_BATCH_ITEM_FIELDS(FIELD) \
+    FIELD(AddMessagesBatchItem, receiver_uuid, string) \
+    FIELD(AddMessagesBatchItem, msg, string)
+
+JSON_OBJECT_DECODER(decode_add_messages_batch_item, AddMessagesBatchItem, ADD_MESSAGES_BATCH_ITEM_FIELDS)
+
+// kind of msgs field, array of {receiver_uuid, msg} objects
+static int json_decode_batch_items(yyjson_val* val, AddMessagesBatchItems* dst)
+{
+    if (!yyjson_is_arr(val)) {
+        return 0;
+    }
+
+    size_t len = unsafe_yyjson_get_len(val);
+    AddMessagesBatchItem* items = len ? malloc(len * sizeof(AddMessagesBatchItem)) : NULL;
+    if (len && !items) {
+        LogErr("Cant alloc memory for messages batch items");
+        return 0;
+    }
+
+    size_t idx, max;
+    yyjson_val* item;
+    yyjson_arr_foreach(val, idx, max, item)
+    {
+        if (decode_add_messages_batch_item(item, &items[idx])) {
+            free(items);
+            return 0;
+        }
+    }
+
+    dst->len = len;
+    dst->items = items;
+    return 1;
+}
+
+#define ADD_MESSAGES_BATCH_INPUT_FIELDS(FIELD) \
+    FIELD(AddMessagesBatchInput, session_key, string) \
+    FIELD(AddMessagesBatchInput, msgs, batch_items)
+
+JSON_DECODER(parse_json_to_add_messages_batch_input, AddMessagesBatchInput, ADD_MESSAGES_BATCH_INPUT_FIELDS)
+
+// every receiver gets one event holding all of its stored messages
+static void publish_new_messages_events(const Message* messages, const char* stored, size_t messages_len)
+{
+    char* published = calloc(messages_len, 1);
+    if (!published) {
+        LogErr("Cant alloc memory for published flags");
+        return;
+    }
+
+    for (size_t i = 0; i < messages_len; i++) {
+        if (published[i] || !stored[i]) {
+            continue;
+        }
+
+        size_t msgs_len = 0;
+        for (size_t j = i; j < messages_len; j++) {
+            msgs_len += stored[j] && messages[j].receiver_id == messages[i].receiver_id;
+        }
+
+        EventNewMessage* ev = malloc(sizeof(EventNewMessage));
+        MsgWithMetaInfo* msgs = calloc(msgs_len, sizeof(MsgWithMetaInfo));
+        if (!ev || !msgs) {
+            LogErr("Cant alloc memory for new message event");
+            free(ev);
+            free(msgs);
+            break;
+        }
+
+        size_t k = 0;
+        int failed = 0;
+        for (size_t j = i; j < messages_len; j++) {
+            if (!stored[j] || messages[j].receiver_id != messages[i].receiver_id) {
+                continue;
+            }
+            published[j] = 1;
+            failed |= create_msg_with_meta_info(&msgs[k++], messages[j].uuid, messages[j].data, messages[j].created_at);
+        }
+
+        create_event_new_messages(ev, msgs, msgs_len);
+        if (failed) {
+            LogErr("Cant create msg with meta info for event");
+        } else if (add_new_event_to_queue_by_user_id(global_event_bus, messages[i].receiver_id, (EventBase*)ev)) {
+            LogWarn("Cant send messages to bus");
+        }
+
+        // bus queues own copies of the event
+        free_event_new_message(ev);
+        free(ev);
+    }
+
+    free(published);
+}
+
+// uuids of created messages in request order, null for messages
+// whose shard failed, so client can resend exactly those
+static char* build_message_uuids_json(
+    char (*message_uuids)[UUID4_LEN], const char* stored, size_t messages_len, WireFormat format, size_t* len)
+{
+    JsonWriter w;
+    json_writer_init_format(&w, 2 + messages_len * (UUID4_LEN + 2), format);
+    json_writer_begin_array(&w);
+    for (size_t i = 0; i < messages_len; i++) {
+        if (stored[i]) {
+            json_writer_string(&w, message_uuids[i]);
+        } else {
+            json_writer_null(&w);
+        }
+    }
+    json_writer_end_array(&w);
+
+    return json_writer_finish(&w, len);
+}
+
+int add_messages_batch_route(HttpRequest* req, HttpResponse* res)
+{
+    LogInfo("add_messages_batch_route executed");
+
+    AddMessagesBatchInput input = { 0 };
+    if (parse_json_to_add_messages_batch_input(req->body_len, req->body, &input)) {
+        LogErr("Incorrect Json on Input: %zu bytes", req->body_len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        free_add_messages_batch_input(&input);
+        return 0;
+    }
+
+    if (input.msgs.len == 0 || input.msgs.len > SEND_BATCH_MAX_MESSAGES) {
+        LogErr("Messages batch size out of range: %zu", input.msgs.len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        free_add_messages_batch_input(&input);
+        return 0;
+    }
+
+    int user_id;
+    if (get_user_id_by_session_key(input.session_key, &user_id)) {
+        LogErr("Cant find such session key in db: session_key = '%s'", input.session_key);
+        create_http_response(res, "403", NULL, 0, NULL, 0);
+        free_add_messages_batch_input(&input);
+        return 0;
+    }
+
+    time_t current_time = time(NULL);
+    char* json_response = NULL;
+    size_t json_len = 0;
+    WireFormat format = wire_format_from_accept(http_request_get_header(req, "Accept"));
+
+    const char** receiver_uuids = malloc(input.msgs.len * sizeof(char*));
+    int* receiver_ids = malloc(input.msgs.len * sizeof(int));
+    Message* messages = malloc(input.msgs.len * sizeof(Message));
+    char(*message_uuids)[UUID4_LEN] = malloc(input.msgs.len * UUID4_LEN);
+    char* stored = malloc(input.msgs.len);
+    if (!receiver_uuids || !receiver_ids || !messages || !message_uuids || !stored) {
+        LogErr("Cant alloc memory for messages batch");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        goto cleanup;
+    }
+
+    for (size_t i = 0; i < input.msgs.len; i++) {
+        receiver_uuids[i] = input.msgs.items[i].receiver_uuid;
+    }
+
+    if (get_user_ids_by_uuids(receiver_uuids, input.msgs.len, receiver_ids)) {
+        LogErr("Cant find some of receiver uuids in db");
+        create_http_response(res, "404", NULL, 0, NULL, 0);
+        goto cleanup;
+    }
+
+    for (size_t i = 0; i < input.msgs.len; i++) {
+        uuid4_generate(message_uuids[i]);
+        messages[i] = (Message) {
+            .created_at = current_time,
+            .updated_at = current_time,
+            .uuid = message_uuids[i],
+            .sender_id = user_id,
+            .receiver_id = receiver_ids[i],
+            .data = input.msgs.items[i].msg,
+        };
+    }
+
+    // once any shard committed batch is answered with 200, failed
+    // messages are nulls in it, so a retry never duplicates stored ones
+    if (add_messages_to_db(messages, input.msgs.len, stored)) {
+        LogErr("Cant add messages batch to db");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        goto cleanup;
+    }
+
+    publish_new_messages_events(messages, stored, input.msgs.len);
+
+    json_response = build_message_uuids_json(message_uuids, stored, input.msgs.len, format, &json_len);
+    if (!json_response) {
+        LogErr("Memory allocation for JSON response failed.");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        goto cleanup;
+    }
+
+    create_http_response_adopt_body(
+        res, "200", (const char*[]) { wire_format_content_type_header(format), WIRE_FORMAT_VARY_HEADER }, 2,
+        json_response, json_len);
+    json_response = NULL; // owned by response now
+
+    LogInfo("Messages batch of %zu handled", input.msgs.len);
+
+cleanup:
+    free(json_response);
+    free(receiver_uuids);
+    free(receiver_ids);
+    free(messages);
+    free(message_uuids);
+    free(stored);
+    free_add_messages_batch_input(&input);
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef ADD_MESSAGES_BATCH_H
+#define ADD_MESSAGES_BATCH_H
+
+#include "http.h"
+
+// upper bound of messages in one /send/batch request
+#define SEND_BATCH_MAX_MESSAGES 1000
+
+typedef struct {
+    char* receiver_uuid;
+    char* msg;
+} AddMessagesBatchItem;
+
+typedef struct {
+    size_t len;
+    AddMessagesBatchItem* items;
+} AddMessagesBatchItems;
+
+// strings point into json parsed by parse_json_to_add_messages_batch_input,
+// valid as long as it is
+typedef struct {
+    char* session_key;
+    AddMessagesBatchItems msgs;
+} AddMessagesBatchInput;
+
+// frees only msgs array, strings belong to parsed json
+void free_add_messages_batch_input(AddMessagesBatchInput* self);
+// parses json in place, see json_read_insitu
+int parse_json_to_add_messages_batch_input(size_t json_len, char json[json_len], AddMessagesBatchInput* model);
+
+int add_messages_batch_route(HttpRequest* req, HttpResponse* res);
+
+#endif
@@ -3,13 +3,14 @@
 
 #include "http.h"
 
+// fields point into json parsed by parse_json_to_auth_user_input,
+// valid as long as it is and never freed
 typedef struct {
     char* nickname;
     char* password;
 } AuthUserInput;
 
-void free_auth_user_input(AuthUserInput* self);
-
+// parses json in place, see json_read_insitu
 int parse_json_to_auth_user_input(size_t json_len, char json[json_len], AuthUserInput* model);
 
 int auth_user_route(HttpRequest* req, HttpResponse* res);
@@ -0,0 +1,286 @@
+#include "compression.h"
+#include "log.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static CompressionStats compression_stats = { 0 };
+static pthread_mutex_t compression_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// one deflate state per thread and encoding, allocating one costs
+// ~256KB per body otherwise; workers live as long as the process,
+// so states are only reset between bodies and never freed
+static __thread z_stream* thread_deflate_streams[ContentEncodingDeflate + 1];
+
+// plain window bits give zlib wrapper http calls deflate, +16 gzip one
+static int deflate_window_bits(ContentEncoding encoding, int window_bits)
+{
+    return encoding == ContentEncodingGzip ? window_bits + 16 : window_bits;
+}
+
+static z_stream* get_thread_deflate_stream(ContentEncoding encoding)
+{
+    z_stream* zs = thread_deflate_streams[encoding];
+    if (zs) {
+        return deflateReset(zs) == Z_OK ? zs : NULL;
+    }
+
+    zs = calloc(1, sizeof(z_stream));
+    if (!zs) {
+        return NULL;
+    }
+
+    if (deflateInit2(zs, COMPRESS_LEVEL, Z_DEFLATED, deflate_window_bits(encoding, 15), 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        LogErr("Cant init deflate stream");
+        free(zs);
+        return NULL;
+    }
+
+    thread_deflate_streams[encoding] = zs;
+    return zs;
+}
+
+static void add_compression_stats(size_t input_bytes, size_t output_bytes)
+{
+    pthread_mutex_lock(&compression_stats_mutex);
+    compression_stats.responses++;
+    compression_stats.input_bytes += input_bytes;
+    compression_stats.output_bytes += output_bytes;
+    pthread_mutex_unlock(&compression_stats_mutex);
+}
+
+ContentEncoding content_encoding_from_accept(const char* accept_encoding)
+{
+    // 1 accepted, -1 refused with q=0, 0 not mentioned
+    int gzip = 0;
+    int deflate = 0;
+    int any = 0;
+
+    const char* p = accept_encoding;
+    while (p && *p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+
+        const char* name = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ') {
+            p++;
+        }
+        size_t name_len = p - name;
+
+        // parameters run up to next coding, only q matters
+        const char* end = strchr(p, ',');
+        if (!end) {
+            end = p + strlen(p);
+        }
+        double q = 1;
+        const char* q_param = strstr(p, "q=");
+        if (q_param && q_param < end) {
+            q = strtod(q_param + 2, NULL);
+        }
+
+        int accepted = q > 0 ? 1 : -1;
+        if (name_len == 4 && strncasecmp(name, "gzip", 4) == 0) {
+            gzip = accepted;
+        } else if (name_len == 7 && strncasecmp(name, "deflate", 7) == 0) {
+            deflate = accepted;
+        } else if (name_len == 1 && *name == '*') {
+            any = accepted;
+        }
+
+        p = end;
+    }
+
+    // '*' stands only for codings not named explicitly
+    if (gzip == 0) {
+        gzip = any;
+    }
+    if (deflate == 0) {
+        deflate = any;
+    }
+
+    return gzip > 0 ? ContentEncodingGzip : deflate > 0 ? ContentEncodingDeflate : ContentEncodingIdentity;
+}
+
+const char* content_encoding_header(ContentEncoding encoding)
+{
+    switch (encoding) {
+    case ContentEncodingGzip:
+        return "Content-Encoding: gzip";
+    case ContentEncodingDeflate:
+        return "Content-Encoding: deflate";
+    default:
+        return NULL;
+    }
+}
+
+int compress_http_response(HttpRequest* req, HttpResponse* res)
+{
+    if (res->streamed || !res->body) {
+        return 0;
+    }
+
+    // caches must not hand this body to clients sending other
+    // Accept-Encoding, whether or not it ends up compressed
+    if (http_response_add_header(res, "Vary: Accept-Encoding")) {
+        return -1;
+    }
+
+    if (res->body_len < COMPRESS_MIN_SIZE) {
+        return 0;
+    }
+
+    ContentEncoding encoding = content_encoding_from_accept(http_request_get_header(req, "Accept-Encoding"));
+    if (encoding == ContentEncodingIdentity) {
+        return 0;
+    }
+
+    z_stream* zs = get_thread_deflate_stream(encoding);
+    if (!zs) {
+        return -1;
+    }
+
+    size_t out_cap = deflateBound(zs, res->body_len);
+    char* out = malloc(out_cap);
+    if (!out) {
+        return -1;
+    }
+
+    zs->next_in = (Bytef*)res->body;
+    zs->avail_in = res->body_len;
+    zs->next_out = (Bytef*)out;
+    zs->avail_out = out_cap;
+    if (deflate(zs, Z_FINISH) != Z_STREAM_END) {
+        LogErr("Cant deflate response body of %zu bytes", res->body_len);
+        free(out);
+        return -1;
+    }
+
+    // already compressed payloads only grow
+    size_t out_len = zs->total_out;
+    if (out_len >= res->body_len) {
+        free(out);
+        return 0;
+    }
+
+    if (http_response_add_header(res, content_encoding_header(encoding))) {
+        free(out);
+        return -1;
+    }
+
+    add_compression_stats(res->body_len, out_len);
+
+    if (res->body_ownership == HttpBodyOwned) {
+        free(res->body);
+    }
+    res->body = out;
+    res->body_len = out_len;
+    res->body_ownership = HttpBodyOwned;
+
+    return 0;
+}
+
+int compress_stream_begin(CompressStream* cs, ContentEncoding encoding, CompressSink sink, void* ctx)
+{
+    cs->zs = get_thread_deflate_stream(encoding);
+    cs->owns_zs = 0;
+    cs->sink = sink;
+    cs->ctx = ctx;
+    cs->input_bytes = 0;
+    cs->output_bytes = 0;
+    return cs->zs ? 0 : -1;
+}
+
+// runs deflate until it leaves room in output, so all input is consumed
+static int compress_stream_deflate(CompressStream* cs, int flush)
+{
+    do {
+        cs->zs->next_out = (Bytef*)cs->out;
+        cs->zs->avail_out = sizeof(cs->out);
+        if (deflate(cs->zs, flush) == Z_STREAM_ERROR) {
+            return -1;
+        }
+
+        size_t produced = sizeof(cs->out) - cs->zs->avail_out;
+        if (produced > 0 && cs->sink(cs->out, produced, cs->ctx)) {
+            return -1;
+        }
+        cs->output_bytes += produced;
+    } while (cs->zs->avail_out == 0);
+
+    return 0;
+}
+
+int compress_stream_write(CompressStream* cs, const char* data, size_t len)
+{
+    cs->zs->next_in = (Bytef*)data;
+    cs->zs->avail_in = len;
+    cs->input_bytes += len;
+    return compress_stream_deflate(cs, Z_NO_FLUSH);
+}
+
+int compress_stream_finish(CompressStream* cs)
+{
+    cs->zs->next_in = NULL;
+    cs->zs->avail_in = 0;
+    if (compress_stream_deflate(cs, Z_FINISH)) {
+        return -1;
+    }
+
+    add_compression_stats(cs->input_bytes, cs->output_bytes);
+    return 0;
+}
+
+int compress_stream_open(CompressStream* cs, ContentEncoding encoding, CompressSink sink, void* ctx)
+{
+    cs->zs = calloc(1, sizeof(z_stream));
+    cs->owns_zs = 1;
+    cs->sink = sink;
+    cs->ctx = ctx;
+    cs->input_bytes = 0;
+    cs->output_bytes = 0;
+    if (!cs->zs) {
+        return -1;
+    }
+
+    if (deflateInit2(cs->zs, COMPRESS_LEVEL, Z_DEFLATED,
+            deflate_window_bits(encoding, COMPRESS_STREAM_WINDOW_BITS),
+            COMPRESS_STREAM_MEM_LEVEL, Z_DEFAULT_STRATEGY)
+        != Z_OK) {
+        LogErr("Cant init deflate stream");
+        free(cs->zs);
+        cs->zs = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+int compress_stream_flush(CompressStream* cs)
+{
+    cs->zs->next_in = NULL;
+    cs->zs->avail_in = 0;
+    return compress_stream_deflate(cs, Z_SYNC_FLUSH);
+}
+
+void compress_stream_close(CompressStream* cs)
+{
+    if (!cs->zs) {
+        return;
+    }
+
+    add_compression_stats(cs->input_bytes, cs->output_bytes);
+    if (cs->owns_zs) {
+        deflateEnd(cs->zs);
+        free(cs->zs);
+    }
+    cs->zs = NULL;
+}
+
+void get_compression_stats(CompressionStats* stats)
+{
+    pthread_mutex_lock(&compression_stats_mutex);
+    *stats = compression_stats;
+    pthread_mutex_unlock(&compression_stats_mutex);
+}
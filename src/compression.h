@@ -0,0 +1,77 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include "http.h"
+#include <stddef.h>
+#include <zlib.h>
+
+// bodies shorter than this are sent as they are, deflate
+// framing and cpu are not worth it for them
+#ifndef COMPRESS_MIN_SIZE
+#define COMPRESS_MIN_SIZE 1024
+#endif
+
+// zlib level, 6 is its default speed to ratio trade off
+#define COMPRESS_LEVEL 6
+// long lived streams, one per event subscriber, get smaller window
+// and hash: ~48KB each instead of ~256KB, events repeat their keys
+// within a few hundred bytes anyway
+#define COMPRESS_STREAM_WINDOW_BITS 13
+#define COMPRESS_STREAM_MEM_LEVEL 5
+// compressed bytes handed to sink at once
+#define COMPRESS_OUT_CHUNK_SIZE 16384
+
+typedef enum {
+    ContentEncodingIdentity,
+    ContentEncodingGzip,
+    ContentEncodingDeflate,
+} ContentEncoding;
+
+typedef struct {
+    size_t responses;
+    size_t input_bytes;
+    size_t output_bytes;
+} CompressionStats;
+
+// picks encoding from Accept-Encoding value, gzip is preferred
+// over deflate, q=0 excludes one even when '*' is accepted;
+// identity when value is NULL
+ContentEncoding content_encoding_from_accept(const char* accept_encoding);
+// Content-Encoding header line, NULL for identity
+const char* content_encoding_header(ContentEncoding encoding);
+
+// adds Vary to every buffered body, compresses it in place when it is
+// long enough and client accepts one of encodings, adds Content-Encoding
+int compress_http_response(HttpRequest* req, HttpResponse* res);
+
+typedef int (*CompressSink)(const char* data, size_t len, void* ctx);
+
+// body compressed piece by piece as it is produced, output is
+// handed to sink in COMPRESS_OUT_CHUNK_SIZE pieces; deflate
+// state is borrowed from calling thread and reused by next body
+typedef struct {
+    z_stream* zs;
+    int owns_zs;
+    CompressSink sink;
+    void* ctx;
+    size_t input_bytes;
+    size_t output_bytes;
+    char out[COMPRESS_OUT_CHUNK_SIZE];
+} CompressStream;
+
+int compress_stream_begin(CompressStream* cs, ContentEncoding encoding, CompressSink sink, void* ctx);
+int compress_stream_write(CompressStream* cs, const char* data, size_t len);
+// ends deflate stream and hands rest of output to sink
+int compress_stream_finish(CompressStream* cs);
+
+// stream owning its deflate state for bodies which stay open, like
+// event streams; history is kept across writes so later ones compress
+// against earlier ones, compress_stream_close releases it
+int compress_stream_open(CompressStream* cs, ContentEncoding encoding, CompressSink sink, void* ctx);
+// sync flush, client can decode everything written so far
+int compress_stream_flush(CompressStream* cs);
+void compress_stream_close(CompressStream* cs);
+
+void get_compression_stats(CompressionStats* stats);
+
+#endif
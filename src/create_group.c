@@ -0,0 +1,88 @@
+#include "create_group.h"
+#include "db.h"
+#include "json_reader.h"
+#include "log.h"
+#include "uuid4.h"
+#include <stdlib.h>
+
+void free_create_group_input(CreateGroupInput* self)
+{
+    if (!self)
+        return;
+    json_free_string_array(&self->member_uuids);
+}
+
+#define CREATE_GROUP_INPUT_FIELDS(FIELD) \
+    FIELD(CreateGroupInput, session_key, string) \
+    FIELD(CreateGroupInput, name, string) \
+    FIELD(CreateGroupInput, member_uuids, string_array)
+
+JSON_DECODER(parse_json_to_create_group_input, CreateGroupInput, CREATE_GROUP_INPUT_FIELDS)
+
+int create_group_route(HttpRequest* req, HttpResponse* res)
+{
+    LogInfo("create_group_route executed");
+
+    CreateGroupInput input = { 0 };
+    if (parse_json_to_create_group_input(req->body_len, req->body, &input)) {
+        LogErr("Incorrect Json on Input: %zu bytes", req->body_len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        free_create_group_input(&input);
+        return 0;
+    }
+
+    if (input.member_uuids.len == 0 || input.member_uuids.len > GROUP_MAX_MEMBERS) {
+        LogErr("Group members count out of range: %zu", input.member_uuids.len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        free_create_group_input(&input);
+        return 0;
+    }
+
+    int user_id;
+    if (get_user_id_by_session_key(input.session_key, &user_id)) {
+        LogErr("Cant find such session key in db: session_key = '%s'", input.session_key);
+        create_http_response(res, "403", NULL, 0, NULL, 0);
+        free_create_group_input(&input);
+        return 0;
+    }
+
+    int* member_ids = malloc(input.member_uuids.len * sizeof(int));
+    if (!member_ids) {
+        LogErr("Cant alloc memory for group members");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        free_create_group_input(&input);
+        return 0;
+    }
+
+    if (get_user_ids_by_uuids((const char**)input.member_uuids.items, input.member_uuids.len, member_ids)) {
+        LogErr("Cant find some of member uuids in db");
+        create_http_response(res, "404", NULL, 0, NULL, 0);
+        free(member_ids);
+        free_create_group_input(&input);
+        return 0;
+    }
+
+    char group_uuid[UUID4_LEN];
+    uuid4_generate(group_uuid);
+
+    const Group group = {
+        .uuid = group_uuid,
+        .name = input.name,
+        .owner_id = user_id,
+        .created_at = time(NULL),
+    };
+
+    if (create_group_in_db(&group, member_ids, input.member_uuids.len)) {
+        LogErr("Cant add group to db");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        free(member_ids);
+        free_create_group_input(&input);
+        return 0;
+    }
+
+    create_http_response(res, "200", NULL, 0, group_uuid, UUID4_LEN - 1);
+    free(member_ids);
+    free_create_group_input(&input);
+
+    return 0;
+}
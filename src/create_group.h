@@ -0,0 +1,25 @@
+#ifndef CREATE_GROUP_H
+#define CREATE_GROUP_H
+
+#include "http.h"
+#include "json_reader.h"
+
+// upper bound of members listed in one /groups/create request
+#define GROUP_MAX_MEMBERS 1000
+
+// strings point into json parsed by parse_json_to_create_group_input,
+// valid as long as it is
+typedef struct {
+    char* session_key;
+    char* name;
+    JsonStringArray member_uuids;
+} CreateGroupInput;
+
+// frees only member_uuids array, strings belong to parsed json
+void free_create_group_input(CreateGroupInput* self);
+// parses json in place, see json_read_insitu
+int parse_json_to_create_group_input(size_t json_len, char json[json_len], CreateGroupInput* model);
+
+int create_group_route(HttpRequest* req, HttpResponse* res);
+
+#endif
@@ -2,79 +2,32 @@
 #include "crypto.h"
 #include "db.h"
 #include "http.h"
+#include "json_reader.h"
 #include "log.h"
 #include "sha256.h"
 #include "uuid4.h"
-#include "yyjson.h"
 #include <stdio.h>
 #include <string.h>
 
-void free_create_user_input(CreateUserInput* self)
-{
-    free(self->nickname);
-    free(self->password);
-}
-
-int parse_json_to_create_user_input(size_t json_len, char json[json_len], CreateUserInput* model)
-{
-    if (!json || !model) {
-        return -1; // Error: Invalid input
-    }
+#define CREATE_USER_INPUT_FIELDS(FIELD) \
+    FIELD(CreateUserInput, nickname, string) \
+    FIELD(CreateUserInput, password, string)
 
-    // Parse the JSON string into a yyjson document
-    yyjson_doc* doc = yyjson_read(json, json_len, 0);
-    if (!doc) {
-        return -2; // Error: Failed to parse JSON
-    }
-
-    // Get the root JSON object
-    yyjson_val* root = yyjson_doc_get_root(doc);
-    if (!yyjson_is_obj(root)) {
-        yyjson_doc_free(doc);
-        return -3; // Error: Root is not a JSON object
-    }
-
-    // Extract "nickname" field
-    yyjson_val* nickname_val = yyjson_obj_get(root, "nickname");
-    if (!yyjson_is_str(nickname_val)) {
-        yyjson_doc_free(doc);
-        return -4; // Error: "nickname" is missing or not a string
-    }
-
-    // Extract "password" field
-    yyjson_val* password_val = yyjson_obj_get(root, "password");
-    if (!yyjson_is_str(password_val)) {
-        yyjson_doc_free(doc);
-        return -5; // Error: "password" is missing or not a string
-    }
-
-    // Allocate memory for nickname and password (caller must free later)
-    model->nickname = strdup(yyjson_get_str(nickname_val));
-    model->password = strdup(yyjson_get_str(password_val));
-
-    // Free the JSON document
-    yyjson_doc_free(doc);
-
-    // Check allocation success
-    if (!model->nickname || !model->password) {
-        return -6; // Error: Memory allocation failed
-    }
-
-    return 0; // Success
-}
+JSON_DECODER(parse_json_to_create_user_input, CreateUserInput, CREATE_USER_INPUT_FIELDS)
 
 int create_user_route(HttpRequest* req, HttpResponse* res)
 {
     LogInfo("create_user_route executed");
 
+    LogTrace("Input Body: %.*s", (int)req->body_len, req->body);
+
     CreateUserInput input;
     if (parse_json_to_create_user_input(req->body_len, req->body, &input)) {
-        LogErr("Incorrect Json on Input: Json = '%.*s'", (int)req->body_len, req->body);
-        create_http_response(res, "400", NULL, 0, NULL);
+        LogErr("Incorrect Json on Input: %zu bytes", req->body_len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
         return 0;
     };
 
-    LogTrace("Input Body: %.*s", (int)req->body_len, req->body);
     LogTrace("Nickname = '%s'; Password = '%s'", input.nickname, input.password);
 
     char user_uuid[UUID4_LEN];
@@ -85,8 +38,7 @@ int create_user_route(HttpRequest* req, HttpResponse* res)
 
     char user_password_hash[SHA256_HEX_SIZE];
     if (hash_user_password_with_pow(user_password_hash, input.password, password_hash_pow)) {
-        create_http_response(res, "500", NULL, 0, NULL);
-        free_create_user_input(&input);
+        create_http_response(res, "500", NULL, 0, NULL, 0);
         LogErr("Cant hash password");
         return 0;
     }
@@ -104,14 +56,12 @@ int create_user_route(HttpRequest* req, HttpResponse* res)
 
     int rc = add_user_to_db(&user);
     if (rc) {
-        create_http_response(res, "500", NULL, 0, NULL);
-        free_create_user_input(&input);
+        create_http_response(res, "500", NULL, 0, NULL, 0);
         LogErr("Db error: rc = %d", rc);
         return 0;
     }
 
-    create_http_response(res, "200", NULL, 0, "user created");
-    free_create_user_input(&input);
+    create_http_response_static_body(res, "200", NULL, 0, HTTP_LITERAL_BODY("user created"));
 
     LogInfo("user created");
 
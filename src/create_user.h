@@ -3,13 +3,14 @@
 
 #include "http.h"
 
+// fields point into json parsed by parse_json_to_create_user_input,
+// valid as long as it is and never freed
 typedef struct {
     char* nickname;
     char* password;
 } CreateUserInput;
 
-void free_create_user_input(CreateUserInput* self);
-
+// parses json in place, see json_read_insitu
 int parse_json_to_create_user_input(size_t json_len, char json[json_len], CreateUserInput* model);
 
 int create_user_route(HttpRequest* req, HttpResponse* res);
@@ -1,29 +1,43 @@
 #include "db.h"
 #include "log.h"
+#include "messages_archive.h"
+#include "messages_compactor.h"
 #include "sqlite_connection_pool.h"
 #include "trinity.h"
+#include "uuid4.h"
+#include "wal_checkpointer.h"
+#include <limits.h>
+#include <stdio.h>
 #include <string.h>
+#include <strings.h>
 
-static SQLiteConnectionPool conn_pool;
+// shard 0 is main.db itself and also holds users and sessions,
+// other shards hold only message data of users hashed to them
+static SQLiteConnectionPool shard_pools[DB_SHARDS];
+static SQLiteConnectionPool* const conn_pool = &shard_pools[0];
+
+static SQLiteConnectionPool* get_shard_pool_by_user_id(int user_id)
+{
+    // ids are handed out sequentially, so plain modulo already
+    // deals users round robin and evenly over shards
+    return &shard_pools[(unsigned)user_id % DB_SHARDS];
+}
 
 static const char db_schema[] = STR(
-    pragma journal_mode = WAL;
-    pragma synchronous = normal;
-    pragma journal_size_limit = 6144000;
-    pragma temp_store = memory;
-    pragma mmap_size = 30000000000;
+    pragma auto_vacuum = INCREMENTAL;
     pragma page_size = 32768;
+    pragma journal_mode = WAL;
 
     CREATE TABLE IF NOT EXISTS users(
         id INTEGER PRIMARY KEY AUTOINCREMENT,
-        uuid TEXT NOT NULL,
+        uuid BLOB NOT NULL,
         nickname TEXT UNIQUE NOT NULL,
         password_hash TEXT NOT NULL,
         password_hash_pow TEXT NOT NULL);
 
     CREATE TABLE IF NOT EXISTS sessions(
         id INTEGER PRIMARY KEY AUTOINCREMENT,
-        session_key TEXT NOT NULL,
+        session_key BLOB NOT NULL,
         user_id INTEGER NOT NULL,
 
         FOREIGN KEY(user_id) REFERENCES users(id));
@@ -33,7 +47,7 @@ static const char db_schema[] = STR(
         deleted_at BIGINTEGER,
         created_at BIGINTEGER NOT NULL,
         updated_at BIGINTEGER NOT NULL,
-        uuid TEXT NOT NULL,
+        uuid BLOB NOT NULL,
         sender_id INTEGER NOT NULL,
         receiver_id INTEGER NOT NULL,
         data TEXT NOT NULL,
@@ -41,32 +55,455 @@ static const char db_schema[] = STR(
         FOREIGN KEY(sender_id) REFERENCES users(id),
         FOREIGN KEY(receiver_id) REFERENCES users(id)););
 
-int init_db(void)
+// each migration moves schema from user_version = i to i + 1,
+// only append here, never edit already shipped entries
+static const char* db_migrations[] = {
+    // 0 -> 1: denormalized per user conversation list,
+    // backfill relies on bare created_at coming from row holding MAX(id)
+    STR(
+        CREATE TABLE conversations(
+            user_id INTEGER NOT NULL,
+            peer_id INTEGER NOT NULL,
+            last_message_at BIGINTEGER NOT NULL,
+            last_message_id INTEGER NOT NULL,
+            unread_count INTEGER NOT NULL DEFAULT 0,
+
+            PRIMARY KEY(user_id, peer_id),
+            FOREIGN KEY(user_id) REFERENCES users(id),
+            FOREIGN KEY(peer_id) REFERENCES users(id)) WITHOUT ROWID;
+
+        INSERT INTO conversations(user_id, peer_id, last_message_at, last_message_id)
+            SELECT user_id, peer_id, created_at, MAX(id) FROM (
+                SELECT receiver_id AS user_id, sender_id AS peer_id, created_at, id FROM messages
+                UNION ALL
+                SELECT sender_id AS user_id, receiver_id AS peer_id, created_at, id FROM messages)
+            GROUP BY user_id, peer_id;),
+
+    // 1 -> 2: uuids stored as 16 byte blobs instead of 36 char text,
+    // declared column types of old databases stay TEXT which is harmless
+    STR(
+        UPDATE users SET uuid = uuid_text_to_blob(uuid);
+        UPDATE sessions SET session_key = uuid_text_to_blob(session_key);
+        UPDATE messages SET uuid = uuid_text_to_blob(uuid);
+
+        CREATE UNIQUE INDEX users_uuid ON users(uuid);
+        CREATE UNIQUE INDEX sessions_session_key ON sessions(session_key);),
+
+    // 2 -> 3: full text index over message data, rows are
+    // read from messages table so text is not stored twice
+    STR(
+        CREATE VIRTUAL TABLE messages_fts USING fts5(
+            data,
+            content = 'messages',
+            content_rowid = 'id');
+
+        INSERT INTO messages_fts(messages_fts) VALUES('rebuild');),
+
+    // 3 -> 4: old months are moved to archive files, registry of
+    // them lives here; conversation index serves /messages paging
+    STR(
+        CREATE TABLE message_partitions(
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            starts_at BIGINTEGER NOT NULL,
+            ends_at BIGINTEGER NOT NULL,
+            path TEXT UNIQUE NOT NULL);
+
+        CREATE INDEX messages_receiver_sender_created_at
+            ON messages(receiver_id, sender_id, created_at);),
+
+    // 4 -> 5: messages are deleted by uuid, compactor
+    // looks only through rows which were soft deleted
+    STR(
+        CREATE UNIQUE INDEX messages_uuid ON messages(uuid);
+
+        CREATE INDEX messages_deleted_at
+            ON messages(deleted_at) WHERE deleted_at IS NOT NULL;),
+
+    // 5 -> 6: /sync reads new received messages by id
+    // and already synced ones changed since last cursor
+    STR(
+        CREATE INDEX messages_receiver_id ON messages(receiver_id, id);
+
+        CREATE INDEX messages_receiver_updated_at
+            ON messages(receiver_id, updated_at);),
+
+    // 6 -> 7: per conversation read watermark, unread_count
+    // is recounted from it whenever it moves forward
+    STR(
+        ALTER TABLE conversations
+            ADD COLUMN last_read_message_id INTEGER NOT NULL DEFAULT 0;),
+
+    // 7 -> 8: group conversations, a message is stored once for
+    // the whole group and members are looked up on fan-out
+    STR(
+        CREATE TABLE chat_groups(
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            uuid BLOB NOT NULL,
+            name TEXT NOT NULL,
+            owner_id INTEGER NOT NULL,
+            created_at BIGINTEGER NOT NULL,
+
+            FOREIGN KEY(owner_id) REFERENCES users(id));
+
+        CREATE UNIQUE INDEX chat_groups_uuid ON chat_groups(uuid);
+
+        CREATE TABLE group_members(
+            group_id INTEGER NOT NULL,
+            user_id INTEGER NOT NULL,
+            joined_at BIGINTEGER NOT NULL,
+
+            PRIMARY KEY(group_id, user_id),
+            FOREIGN KEY(group_id) REFERENCES chat_groups(id),
+            FOREIGN KEY(user_id) REFERENCES users(id)) WITHOUT ROWID;
+
+        CREATE TABLE group_messages(
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            created_at BIGINTEGER NOT NULL,
+            updated_at BIGINTEGER NOT NULL,
+            uuid BLOB NOT NULL,
+            group_id INTEGER NOT NULL,
+            sender_id INTEGER NOT NULL,
+            data TEXT NOT NULL,
+
+            FOREIGN KEY(group_id) REFERENCES chat_groups(id),
+            FOREIGN KEY(sender_id) REFERENCES users(id));
+
+        CREATE UNIQUE INDEX group_messages_uuid ON group_messages(uuid);
+        CREATE INDEX group_messages_group_id ON group_messages(group_id, id);),
+
+    // 8 -> 9: /sync reads sent messages too
+    STR(
+        CREATE INDEX messages_sender_id ON messages(sender_id, id);
+
+        CREATE INDEX messages_sender_updated_at
+            ON messages(sender_id, updated_at);),
+};
+
+#define DB_MIGRATIONS_LEN (sizeof(db_migrations) / sizeof(db_migrations[0]))
+
+// message tables of extra shard files in the shape first shard build
+// created them; users resolve to attached main.db, so they must not
+// exist here. files of builds before shard_migrations have no version
+static const char shard_schema[] = STR(
+    pragma auto_vacuum = INCREMENTAL;
+    pragma page_size = 32768;
+    pragma journal_mode = WAL;
+
+    CREATE TABLE IF NOT EXISTS messages(
+        id INTEGER PRIMARY KEY AUTOINCREMENT,
+        deleted_at BIGINTEGER,
+        created_at BIGINTEGER NOT NULL,
+        updated_at BIGINTEGER NOT NULL,
+        uuid BLOB NOT NULL,
+        sender_id INTEGER NOT NULL,
+        receiver_id INTEGER NOT NULL,
+        data TEXT NOT NULL);
+
+    CREATE INDEX IF NOT EXISTS messages_receiver_sender_created_at
+        ON messages(receiver_id, sender_id, created_at);
+
+    CREATE TABLE IF NOT EXISTS conversations(
+        user_id INTEGER NOT NULL,
+        peer_id INTEGER NOT NULL,
+        last_message_at BIGINTEGER NOT NULL,
+        last_message_id INTEGER NOT NULL,
+        unread_count INTEGER NOT NULL DEFAULT 0,
+
+        PRIMARY KEY(user_id, peer_id)) WITHOUT ROWID;
+
+    CREATE VIRTUAL TABLE IF NOT EXISTS messages_fts USING fts5(
+        data,
+        content = 'messages',
+        content_rowid = 'id');
+
+    CREATE TABLE IF NOT EXISTS message_partitions(
+        id INTEGER PRIMARY KEY AUTOINCREMENT,
+        starts_at BIGINTEGER NOT NULL,
+        ends_at BIGINTEGER NOT NULL,
+        path TEXT UNIQUE NOT NULL););
+
+// db_migrations touching message tables are mirrored here, same
+// rules apply; unversioned files may already have indexes, so
+// those steps say IF NOT EXISTS
+static const char* shard_migrations[] = {
+    // 0 -> 1: soft delete by uuid and compaction
+    STR(
+        CREATE UNIQUE INDEX IF NOT EXISTS messages_uuid ON messages(uuid);
+
+        CREATE INDEX IF NOT EXISTS messages_deleted_at
+            ON messages(deleted_at) WHERE deleted_at IS NOT NULL;),
+
+    // 1 -> 2: /sync of received messages
+    STR(
+        CREATE INDEX IF NOT EXISTS messages_receiver_id ON messages(receiver_id, id);
+
+        CREATE INDEX IF NOT EXISTS messages_receiver_updated_at
+            ON messages(receiver_id, updated_at);),
+
+    // 2 -> 3: per conversation read watermark
+    STR(
+        ALTER TABLE conversations
+            ADD COLUMN last_read_message_id INTEGER NOT NULL DEFAULT 0;),
+
+    // 3 -> 4: /sync of sent messages
+    STR(
+        CREATE INDEX IF NOT EXISTS messages_sender_id ON messages(sender_id, id);
+
+        CREATE INDEX IF NOT EXISTS messages_sender_updated_at
+            ON messages(sender_id, updated_at);),
+};
+
+#define SHARD_MIGRATIONS_LEN (sizeof(shard_migrations) / sizeof(shard_migrations[0]))
+// unversioned file having read watermark column is at least here
+#define SHARD_READ_WATERMARK_VERSION 3
+
+static int exec_sql(sqlite3* db, const char* sql)
 {
-    // Open database connection
-    int rc = init_sqlite_connection_pool(&conn_pool, "main.db");
-    if (rc) {
-        LogErr("Can't open sqlite3 connection pool");
+    char* err_msg = NULL;
+    int rc = sqlite3_exec(db, sql, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to execute SQL '%s': %s", sql, err_msg);
+        sqlite3_free(err_msg);
         return EXIT_FAILURE;
-    } else {
-        LogTrace("Opened database successfully");
     }
+    return EXIT_SUCCESS;
+}
 
-    LogInfo("db_schema = '%s'", db_schema);
+// sql function used by migrations, values which are not
+// canonical text uuids are returned as is
+static void uuid_text_to_blob(sqlite3_context* ctx, int argc, sqlite3_value** argv)
+{
+    const char* text = (const char*)sqlite3_value_text(argv[0]);
+    unsigned char bytes[UUID4_BYTES_LEN];
 
-    sqlite3* db = sqlite_get_connection(&conn_pool);
+    if (sqlite3_value_type(argv[0]) != SQLITE_TEXT || uuid4_to_bytes(text, bytes)) {
+        sqlite3_result_value(ctx, argv[0]);
+        return;
+    }
 
-    char* err_msg = NULL;
-    rc = sqlite3_exec(db, db_schema, NULL, NULL, &err_msg);
+    sqlite3_result_blob(ctx, bytes, sizeof(bytes), SQLITE_TRANSIENT);
+}
+
+// uuids are passed around as text and stored as blobs
+static int bind_uuid(sqlite3_stmt* stmt, int index, const char* uuid)
+{
+    unsigned char bytes[UUID4_BYTES_LEN];
+    if (uuid4_to_bytes(uuid, bytes)) {
+        LogWarn("Malformed uuid: '%s'", uuid);
+        return EXIT_FAILURE;
+    }
+
+    if (sqlite3_bind_blob(stmt, index, bytes, sizeof(bytes), SQLITE_TRANSIENT) != SQLITE_OK) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// dst must hold UUID4_LEN bytes
+static int column_uuid(sqlite3_stmt* stmt, int column, char* dst)
+{
+    const unsigned char* bytes = sqlite3_column_blob(stmt, column);
+    if (!bytes || sqlite3_column_bytes(stmt, column) != UUID4_BYTES_LEN) {
+        LogErr("Malformed uuid in column %d", column);
+        return EXIT_FAILURE;
+    }
+
+    uuid4_from_bytes(bytes, dst);
+    return EXIT_SUCCESS;
+}
+
+static int get_schema_version(sqlite3* db, int* version)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "pragma user_version;", -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        LogErr("Failed to read schema version: %s", sqlite3_errmsg(db));
+        sqlite3_finalize(stmt);
+        return EXIT_FAILURE;
+    }
+
+    *version = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    return EXIT_SUCCESS;
+}
+
+static int run_migrations(
+    sqlite3* db, const char* db_path, const char* const* migrations, size_t migrations_len, int version)
+{
+    for (size_t i = version; i < migrations_len; ++i) {
+        LogInfo("Migrating schema of %s: %zu -> %zu", db_path, i, i + 1);
+
+        char set_version[64];
+        snprintf(set_version, sizeof(set_version), "pragma user_version = %zu;", i + 1);
+
+        if (exec_sql(db, "BEGIN IMMEDIATE;")) {
+            return EXIT_FAILURE;
+        }
+
+        if (exec_sql(db, migrations[i]) || exec_sql(db, set_version)) {
+            exec_sql(db, "ROLLBACK;");
+            return EXIT_FAILURE;
+        }
+
+        if (exec_sql(db, "COMMIT;")) {
+            exec_sql(db, "ROLLBACK;");
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int migrate_db(sqlite3* db)
+{
+    int version = 0;
+    if (get_schema_version(db, &version)) {
+        return EXIT_FAILURE;
+    }
+
+    int rc = sqlite3_create_function(
+        db, "uuid_text_to_blob", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+        NULL, uuid_text_to_blob, NULL, NULL);
     if (rc != SQLITE_OK) {
-        LogErr("Failed to initialize database schema: %s", err_msg);
-        sqlite3_free(err_msg);
-        sqlite_release_connection(&conn_pool, db);
+        LogErr("Failed to register migration functions: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    return run_migrations(db, "main.db", db_migrations, DB_MIGRATIONS_LEN, version);
+}
+
+static int migrate_shard(sqlite3* db, const char* db_path)
+{
+    int version = 0;
+    if (get_schema_version(db, &version)) {
+        return EXIT_FAILURE;
+    }
+
+    // only step which can't be repeated is adding a column, so
+    // unversioned file which has it starts right after it
+    if (version == 0) {
+        sqlite3_stmt* stmt;
+        const char* sql = "SELECT 1 FROM pragma_table_info('conversations') WHERE name = 'last_read_message_id';";
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+            LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+            return EXIT_FAILURE;
+        }
+
+        int rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+        if (rc == SQLITE_ROW) {
+            version = SHARD_READ_WATERMARK_VERSION;
+        } else if (rc != SQLITE_DONE) {
+            LogErr("Failed to read shard schema: %s", sqlite3_errmsg(db));
+            return EXIT_FAILURE;
+        }
+    }
+
+    return run_migrations(db, db_path, shard_migrations, SHARD_MIGRATIONS_LEN, version);
+}
+
+static int init_shard(int shard)
+{
+    char db_path[64];
+    char db_name[32];
+    char archive_name[64];
+    snprintf(db_path, sizeof(db_path), "main_shard_%d.db", shard);
+    snprintf(db_name, sizeof(db_name), "shard_%d", shard);
+    snprintf(archive_name, sizeof(archive_name), "shard_%d_messages", shard);
+
+    // schema is created before pool is opened, so read only
+    // connections never see shard file before it is in wal mode
+    sqlite3* db;
+    if (sqlite3_open_v2(db_path, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK
+        || exec_sql(db, shard_schema)) {
+        LogErr("Failed to initialize schema of shard %d: %s", shard, sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return EXIT_FAILURE;
+    }
+
+    if (migrate_shard(db, db_path)) {
+        LogErr("Failed to migrate schema of shard %d", shard);
+        sqlite3_close(db);
+        return EXIT_FAILURE;
+    }
+    sqlite3_close(db);
+
+    if (init_sqlite_connection_pool(&shard_pools[shard], db_path, "main.db")) {
+        LogErr("Can't open sqlite3 connection pool for shard %d", shard);
+        return EXIT_FAILURE;
+    }
+
+    if (start_wal_checkpointer(db_path, db_name)) {
+        LogErr("Can't start wal checkpointer for shard %d", shard);
+        return EXIT_FAILURE;
+    }
+
+    if (start_messages_archiver(db_path, archive_name)) {
+        LogErr("Can't start messages archiver for shard %d", shard);
+        return EXIT_FAILURE;
+    }
+
+    if (start_messages_compactor(db_path)) {
+        LogErr("Can't start messages compactor for shard %d", shard);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int init_db(void)
+{
+    LogInfo("db_schema = '%s'", db_schema);
+
+    // like shards, schema is created before pool is opened, so read
+    // only connections never see main.db before it is in wal mode
+    sqlite3* db;
+    if (sqlite3_open_v2("main.db", &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK
+        || exec_sql(db, db_schema)) {
+        LogErr("Failed to initialize database schema: %s", sqlite3_errmsg(db));
+        sqlite3_close(db);
         return EXIT_FAILURE;
     }
     LogInfo("Database schema initialized successfully.");
 
-    sqlite_release_connection(&conn_pool, db);
+    if (migrate_db(db)) {
+        LogErr("Failed to migrate database schema");
+        sqlite3_close(db);
+        return EXIT_FAILURE;
+    }
+    sqlite3_close(db);
+
+    if (init_sqlite_connection_pool(conn_pool, "main.db", NULL)) {
+        LogErr("Can't open sqlite3 connection pool");
+        return EXIT_FAILURE;
+    }
+    LogTrace("Opened database successfully");
+
+    if (start_wal_checkpointer("main.db", "main")) {
+        LogErr("Can't start wal checkpointer");
+        return EXIT_FAILURE;
+    }
+
+    if (start_messages_archiver("main.db", "messages")) {
+        LogErr("Can't start messages archiver");
+        return EXIT_FAILURE;
+    }
+
+    if (start_messages_compactor("main.db")) {
+        LogErr("Can't start messages compactor");
+        return EXIT_FAILURE;
+    }
+
+    for (int shard = 1; shard < DB_SHARDS; shard++) {
+        if (init_shard(shard)) {
+            return EXIT_FAILURE;
+        }
+    }
 
     return 0;
 }
@@ -78,7 +515,7 @@ int add_user_to_db(const User* user)
         return EXIT_FAILURE;
     }
 
-    sqlite3* db = sqlite_get_connection(&conn_pool);
+    sqlite3* db = sqlite_get_connection(conn_pool, SQLiteConnWrite);
 
     const char* sql = "INSERT INTO users (uuid, nickname, password_hash, password_hash_pow) VALUES (?, ?, ?, ?);";
     sqlite3_stmt* stmt;
@@ -86,11 +523,15 @@ int add_user_to_db(const User* user)
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     }
 
-    sqlite3_bind_text(stmt, 1, user->uuid, -1, SQLITE_STATIC);
+    if (bind_uuid(stmt, 1, user->uuid)) {
+        sqlite3_finalize(stmt);
+        sqlite_release_connection(conn_pool, db);
+        return EXIT_FAILURE;
+    }
     sqlite3_bind_text(stmt, 2, user->nickname, -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 3, user->password_hash, -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 4, user->password_hash_pow, -1, SQLITE_STATIC);
@@ -99,14 +540,14 @@ int add_user_to_db(const User* user)
     if (rc != SQLITE_DONE) {
         LogErr("Failed to execute SQL statement: %s", sqlite3_errmsg(db));
         sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     }
 
     LogInfo("User added to the database: UUID = %s, Nickname = %s", user->uuid, user->nickname);
 
     sqlite3_finalize(stmt);
-    sqlite_release_connection(&conn_pool, db);
+    sqlite_release_connection(conn_pool, db);
     return EXIT_SUCCESS;
 }
 
@@ -117,7 +558,7 @@ int get_user_password_hash_and_pow_and_id_by_nickname_from_db(const char* nickna
         return EXIT_FAILURE;
     }
 
-    sqlite3* db = sqlite_get_connection(&conn_pool);
+    sqlite3* db = sqlite_get_connection(conn_pool, SQLiteConnRead);
 
     const char* sql = "SELECT password_hash, password_hash_pow, id FROM users WHERE nickname = ?;";
     sqlite3_stmt* stmt;
@@ -125,7 +566,7 @@ int get_user_password_hash_and_pow_and_id_by_nickname_from_db(const char* nickna
     // Prepare the SQL statement
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
         return EXIT_FAILURE;
     }
@@ -148,7 +589,7 @@ int get_user_password_hash_and_pow_and_id_by_nickname_from_db(const char* nickna
         } else {
             LogErr("Password hash is NULL for nickname: %s", nickname);
             sqlite3_finalize(stmt);
-            sqlite_release_connection(&conn_pool, db);
+            sqlite_release_connection(conn_pool, db);
             return EXIT_FAILURE;
         }
 
@@ -157,7 +598,7 @@ int get_user_password_hash_and_pow_and_id_by_nickname_from_db(const char* nickna
         } else {
             LogErr("Password hash pow is NULL for nickname: %s", nickname);
             sqlite3_finalize(stmt);
-            sqlite_release_connection(&conn_pool, db);
+            sqlite_release_connection(conn_pool, db);
             return EXIT_FAILURE;
         }
 
@@ -165,18 +606,18 @@ int get_user_password_hash_and_pow_and_id_by_nickname_from_db(const char* nickna
     } else if (rc == SQLITE_DONE) {
         LogWarn("No user found with nickname: %s", nickname);
         sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     } else {
         LogErr("Failed to execute SQL statement: %s", sqlite3_errmsg(db));
         sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     }
 
     // Finalize the statement
     sqlite3_finalize(stmt);
-    sqlite_release_connection(&conn_pool, db);
+    sqlite_release_connection(conn_pool, db);
     return EXIT_SUCCESS;
 }
 
@@ -187,7 +628,7 @@ int get_user_id_by_uuid(const char* uuid, int* user_id)
         return EXIT_FAILURE;
     }
 
-    sqlite3* db = sqlite_get_connection(&conn_pool);
+    sqlite3* db = sqlite_get_connection(conn_pool, SQLiteConnRead);
 
     const char* sql = "SELECT id FROM users WHERE uuid = ?;";
     sqlite3_stmt* stmt;
@@ -195,18 +636,22 @@ int get_user_id_by_uuid(const char* uuid, int* user_id)
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     }
 
-    sqlite3_bind_text(stmt, 1, uuid, -1, SQLITE_STATIC);
+    if (bind_uuid(stmt, 1, uuid)) {
+        sqlite3_finalize(stmt);
+        sqlite_release_connection(conn_pool, db);
+        return EXIT_FAILURE;
+    }
 
     rc = sqlite3_step(stmt);
     if (rc == SQLITE_ROW) {
         *user_id = sqlite3_column_int(stmt, 0);
         LogInfo("Found user ID for UUID %s: %d", uuid, *user_id);
         sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_SUCCESS;
     } else if (rc == SQLITE_DONE) {
         LogErr("No user found with UUID: %s", uuid);
@@ -215,10 +660,81 @@ int get_user_id_by_uuid(const char* uuid, int* user_id)
     }
 
     sqlite3_finalize(stmt);
-    sqlite_release_connection(&conn_pool, db);
+    sqlite_release_connection(conn_pool, db);
     return EXIT_FAILURE;
 }
 
+int get_user_ids_by_uuids(const char** uuids, size_t uuids_len, int* user_ids)
+{
+    if (!uuids || !user_ids || uuids_len == 0) {
+        LogErr("Invalid parameters provided.");
+        return EXIT_FAILURE;
+    }
+
+    // one statement with a placeholder per uuid, duplicates are harmless
+    size_t sql_len = sizeof("SELECT uuid, id FROM users WHERE uuid IN ();") + uuids_len * 2;
+    char* sql = malloc(sql_len);
+    if (!sql) {
+        LogErr("Memory allocation failed for SQL statement.");
+        return EXIT_FAILURE;
+    }
+    char* out = sql + sprintf(sql, "SELECT uuid, id FROM users WHERE uuid IN (");
+    for (size_t i = 0; i < uuids_len; i++) {
+        out += sprintf(out, i > 0 ? ",?" : "?");
+        user_ids[i] = 0;
+    }
+    sprintf(out, ");");
+
+    sqlite3* db = sqlite_get_connection(conn_pool, SQLiteConnRead);
+
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    free(sql);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        sqlite_release_connection(conn_pool, db);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < uuids_len; i++) {
+        if (bind_uuid(stmt, i + 1, uuids[i])) {
+            sqlite3_finalize(stmt);
+            sqlite_release_connection(conn_pool, db);
+            return EXIT_FAILURE;
+        }
+    }
+
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        char uuid[UUID4_LEN];
+        if (column_uuid(stmt, 0, uuid)) {
+            continue;
+        }
+        int id = sqlite3_column_int(stmt, 1);
+        for (size_t i = 0; i < uuids_len; i++) {
+            if (strcasecmp(uuids[i], uuid) == 0) {
+                user_ids[i] = id;
+            }
+        }
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite_release_connection(conn_pool, db);
+
+    if (rc != SQLITE_DONE) {
+        LogErr("Failed to fetch user ids by uuids.");
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < uuids_len; i++) {
+        if (user_ids[i] == 0) {
+            LogErr("No user found with UUID: %s", uuids[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
 int get_user_uuid_by_id(int user_id, char* uuid)
 {
     if (!uuid) {
@@ -226,7 +742,7 @@ int get_user_uuid_by_id(int user_id, char* uuid)
         return EXIT_FAILURE;
     }
 
-    sqlite3* db = sqlite_get_connection(&conn_pool);
+    sqlite3* db = sqlite_get_connection(conn_pool, SQLiteConnRead);
 
     const char* sql = "SELECT uuid FROM users WHERE id = ?;";
     sqlite3_stmt* stmt;
@@ -234,7 +750,7 @@ int get_user_uuid_by_id(int user_id, char* uuid)
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     }
 
@@ -242,11 +758,9 @@ int get_user_uuid_by_id(int user_id, char* uuid)
 
     rc = sqlite3_step(stmt);
     if (rc == SQLITE_ROW) {
-        const char* retrieved_uuid = (const char*)sqlite3_column_text(stmt, 0);
-        if (retrieved_uuid) {
-            strcpy(uuid, retrieved_uuid); // Directly copy the UUID
+        if (column_uuid(stmt, 0, uuid) == EXIT_SUCCESS) {
             sqlite3_finalize(stmt);
-            sqlite_release_connection(&conn_pool, db);
+            sqlite_release_connection(conn_pool, db);
             LogInfo("Found UUID for user ID %d: %s", user_id, uuid);
             return EXIT_SUCCESS;
         }
@@ -257,7 +771,7 @@ int get_user_uuid_by_id(int user_id, char* uuid)
     }
 
     sqlite3_finalize(stmt);
-    sqlite_release_connection(&conn_pool, db);
+    sqlite_release_connection(conn_pool, db);
     return EXIT_FAILURE;
 }
 
@@ -268,7 +782,7 @@ int add_session_to_db(const Session* session)
         return EXIT_FAILURE;
     }
 
-    sqlite3* db = sqlite_get_connection(&conn_pool);
+    sqlite3* db = sqlite_get_connection(conn_pool, SQLiteConnWrite);
 
     // SQL statement to insert a session into the sessions table
     const char* sql = "INSERT INTO sessions (session_key, user_id) VALUES (?, ?);";
@@ -278,11 +792,16 @@ int add_session_to_db(const Session* session)
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     }
 
     // Bind values to the prepared statement
-    sqlite3_bind_text(stmt, 1, session->session_key, -1, SQLITE_STATIC);
+    if (bind_uuid(stmt, 1, session->session_key)) {
+        sqlite3_finalize(stmt);
+        sqlite_release_connection(conn_pool, db);
+        return EXIT_FAILURE;
+    }
     sqlite3_bind_int(stmt, 2, session->user_id);
 
     // Execute the SQL statement
@@ -290,7 +809,7 @@ int add_session_to_db(const Session* session)
     if (rc != SQLITE_DONE) {
         LogErr("Failed to execute SQL statement: %s", sqlite3_errmsg(db));
         sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     }
 
@@ -298,7 +817,7 @@ int add_session_to_db(const Session* session)
 
     // Finalize the statement to release resources
     sqlite3_finalize(stmt);
-    sqlite_release_connection(&conn_pool, db);
+    sqlite_release_connection(conn_pool, db);
     return EXIT_SUCCESS;
 }
 
@@ -309,7 +828,7 @@ int get_sessions_id_by_user_id(int user_id, Session** sessions, size_t* sessions
         return EXIT_FAILURE;
     }
 
-    sqlite3* db = sqlite_get_connection(&conn_pool);
+    sqlite3* db = sqlite_get_connection(conn_pool, SQLiteConnRead);
 
     *sessions = NULL;
     *sessions_len = 0;
@@ -320,7 +839,7 @@ int get_sessions_id_by_user_id(int user_id, Session** sessions, size_t* sessions
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     }
 
@@ -331,7 +850,7 @@ int get_sessions_id_by_user_id(int user_id, Session** sessions, size_t* sessions
     if (!*sessions) {
         LogErr("Memory allocation failed for sessions array.");
         sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     }
 
@@ -344,7 +863,7 @@ int get_sessions_id_by_user_id(int user_id, Session** sessions, size_t* sessions
             if (!*sessions) {
                 LogErr("Memory reallocation failed for sessions array.");
                 sqlite3_finalize(stmt);
-                sqlite_release_connection(&conn_pool, db);
+                sqlite_release_connection(conn_pool, db);
                 return EXIT_FAILURE;
             }
         }
@@ -353,7 +872,10 @@ int get_sessions_id_by_user_id(int user_id, Session** sessions, size_t* sessions
         Session* current_session = &(*sessions)[*sessions_len];
         current_session->user_id = user_id;
 
-        const char* session_key = (const char*)sqlite3_column_text(stmt, 0);
+        char session_key[UUID4_LEN];
+        if (column_uuid(stmt, 0, session_key)) {
+            break;
+        }
         current_session->session_key = strdup(session_key); // Duplicate the session key string
 
         (*sessions_len)++;
@@ -367,24 +889,77 @@ int get_sessions_id_by_user_id(int user_id, Session** sessions, size_t* sessions
         }
         free(*sessions);
         sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     }
 
     sqlite3_finalize(stmt);
-    sqlite_release_connection(&conn_pool, db);
+    sqlite_release_connection(conn_pool, db);
     return EXIT_SUCCESS;
 }
 
-int add_message_to_db(const Message* message)
+static int upsert_conversation(
+    sqlite3* db, int user_id, int peer_id, time_t last_message_at,
+    sqlite3_int64 last_message_id, int unread_increment)
 {
-    if (!message || !message->uuid || !message->data) {
-        LogErr("Invalid input parameters.");
+    const char* sql = "INSERT INTO conversations (user_id, peer_id, last_message_at, last_message_id, unread_count) "
+                      "VALUES (?, ?, ?, ?, ?) "
+                      "ON CONFLICT (user_id, peer_id) DO UPDATE SET "
+                      "last_message_at = excluded.last_message_at, "
+                      "last_message_id = excluded.last_message_id, "
+                      "unread_count = unread_count + excluded.unread_count;";
+    sqlite3_stmt* stmt;
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    sqlite3_bind_int(stmt, 1, user_id);
+    sqlite3_bind_int(stmt, 2, peer_id);
+    sqlite3_bind_int64(stmt, 3, last_message_at);
+    sqlite3_bind_int64(stmt, 4, last_message_id);
+    sqlite3_bind_int(stmt, 5, unread_increment);
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Failed to upsert conversation: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int add_message_to_fts_index(sqlite3* db, sqlite3_int64 message_id, const char* data)
+{
+    const char* sql = "INSERT INTO messages_fts (rowid, data) VALUES (?, ?);";
+    sqlite3_stmt* stmt;
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    sqlite3_bind_int64(stmt, 1, message_id);
+    sqlite3_bind_text(stmt, 2, data, -1, SQLITE_STATIC);
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Failed to index message: %s", sqlite3_errmsg(db));
         return EXIT_FAILURE;
     }
 
-    sqlite3* db = sqlite_get_connection(&conn_pool);
+    return EXIT_SUCCESS;
+}
 
+// inserts message with its fts entry and conversation rows living in
+// the receiver shard, caller holds the transaction
+static int insert_message(sqlite3* db, const Message* message, int sender_in_shard, sqlite3_int64* message_id)
+{
     const char* sql = "INSERT INTO messages (created_at, updated_at, uuid, sender_id, receiver_id, data) "
                       "VALUES (?, ?, ?, ?, ?, ?);";
     sqlite3_stmt* stmt;
@@ -393,43 +968,453 @@ int add_message_to_db(const Message* message)
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
-        sqlite_release_connection(&conn_pool, db);
         return EXIT_FAILURE;
     }
 
     // Bind the parameters to the SQL statement
     sqlite3_bind_int64(stmt, 1, message->created_at);
     sqlite3_bind_int64(stmt, 2, message->updated_at);
-    sqlite3_bind_text(stmt, 3, message->uuid, -1, SQLITE_STATIC);
+    if (bind_uuid(stmt, 3, message->uuid)) {
+        sqlite3_finalize(stmt);
+        return EXIT_FAILURE;
+    }
     sqlite3_bind_int(stmt, 4, message->sender_id);
     sqlite3_bind_int(stmt, 5, message->receiver_id);
     sqlite3_bind_text(stmt, 6, message->data, -1, SQLITE_STATIC);
 
     // Execute the statement
     rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
     if (rc != SQLITE_DONE) {
         LogErr("Failed to execute SQL statement: %s", sqlite3_errmsg(db));
-        sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
         return EXIT_FAILURE;
     }
 
-    LogInfo("Message added to the database successfully.");
+    *message_id = sqlite3_last_insert_rowid(db);
 
-    // Finalize the statement
-    sqlite3_finalize(stmt);
-    sqlite_release_connection(&conn_pool, db);
-    return EXIT_SUCCESS;
-}
+    if (add_message_to_fts_index(db, *message_id, message->data)) {
+        return EXIT_FAILURE;
+    }
 
-int get_user_id_by_session_key(const char* session_key, int* user_id)
-{
-    if (!session_key || !user_id) {
-        LogErr("Invalid input: session_key or user_id pointer is NULL.");
+    if (upsert_conversation(db, message->receiver_id, message->sender_id, message->created_at, *message_id, 1)) {
         return EXIT_FAILURE;
     }
 
-    sqlite3* db = sqlite_get_connection(&conn_pool);
+    if (message->sender_id != message->receiver_id && sender_in_shard
+        && upsert_conversation(db, message->sender_id, message->receiver_id, message->created_at, *message_id, 0)) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int add_message_to_db(const Message* message)
+{
+    return add_messages_to_db(message, 1, NULL);
+}
+
+int add_messages_to_db(const Message* messages, size_t messages_len, char* stored)
+{
+    if (!messages) {
+        LogErr("Invalid input parameters.");
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < messages_len; i++) {
+        if (!messages[i].uuid || !messages[i].data) {
+            LogErr("Invalid input parameters.");
+            return EXIT_FAILURE;
+        }
+    }
+
+    sqlite3_int64* message_ids = malloc(messages_len * sizeof(sqlite3_int64));
+    char* committed = calloc(messages_len, 1);
+    if ((!message_ids || !committed) && messages_len > 0) {
+        LogErr("Memory allocation failed for message ids.");
+        free(message_ids);
+        free(committed);
+        return EXIT_FAILURE;
+    }
+
+    // messages live in receiver shards, one transaction per shard;
+    // shard which fails does not undo already committed ones, so
+    // the rest of shards is still tried and batch is partially stored
+    size_t committed_len = 0;
+    int failed = 0;
+    for (int shard = 0; shard < DB_SHARDS; shard++) {
+        SQLiteConnectionPool* pool = &shard_pools[shard];
+        sqlite3* db = NULL;
+        size_t shard_len = 0;
+
+        for (size_t i = 0; i < messages_len; i++) {
+            if (get_shard_pool_by_user_id(messages[i].receiver_id) != pool) {
+                continue;
+            }
+
+            if (!db) {
+                db = sqlite_get_connection(pool, SQLiteConnWrite);
+                if (exec_sql(db, "BEGIN IMMEDIATE;")) {
+                    goto shard_failed;
+                }
+            }
+
+            int sender_in_shard = get_shard_pool_by_user_id(messages[i].sender_id) == pool;
+            if (insert_message(db, &messages[i], sender_in_shard, &message_ids[i])) {
+                exec_sql(db, "ROLLBACK;");
+                goto shard_failed;
+            }
+            shard_len++;
+        }
+
+        if (!db) {
+            continue;
+        }
+
+        if (exec_sql(db, "COMMIT;")) {
+            exec_sql(db, "ROLLBACK;");
+            goto shard_failed;
+        }
+        sqlite_release_connection(pool, db);
+
+        for (size_t i = 0; i < messages_len; i++) {
+            if (get_shard_pool_by_user_id(messages[i].receiver_id) == pool) {
+                committed[i] = 1;
+            }
+        }
+        committed_len += shard_len;
+        continue;
+
+    shard_failed:
+        LogErr("Failed to store messages of shard %d", shard);
+        sqlite_release_connection(pool, db);
+        failed = 1;
+    }
+
+    // sender conversation rows of messages stored in another shard; they
+    // only mirror what receiver shards already have, so their failure is
+    // logged and the sender's contact list catches up on next message
+    for (int shard = 0; shard < DB_SHARDS; shard++) {
+        SQLiteConnectionPool* pool = &shard_pools[shard];
+        sqlite3* db = NULL;
+
+        for (size_t i = 0; i < messages_len; i++) {
+            if (!committed[i]
+                || get_shard_pool_by_user_id(messages[i].sender_id) != pool
+                || get_shard_pool_by_user_id(messages[i].receiver_id) == pool) {
+                continue;
+            }
+
+            if (!db) {
+                db = sqlite_get_connection(pool, SQLiteConnWrite);
+                if (exec_sql(db, "BEGIN IMMEDIATE;")) {
+                    LogErr("Failed to update sender conversations of shard %d", shard);
+                    sqlite_release_connection(pool, db);
+                    db = NULL;
+                    break;
+                }
+            }
+
+            if (upsert_conversation(
+                    db, messages[i].sender_id, messages[i].receiver_id,
+                    messages[i].created_at, message_ids[i], 0)) {
+                LogErr("Failed to update sender conversation of message %s", messages[i].uuid);
+            }
+        }
+
+        if (!db) {
+            continue;
+        }
+        if (exec_sql(db, "COMMIT;")) {
+            LogErr("Failed to update sender conversations of shard %d", shard);
+            exec_sql(db, "ROLLBACK;");
+        }
+        sqlite_release_connection(pool, db);
+    }
+
+    if (stored) {
+        memcpy(stored, committed, messages_len);
+    }
+    free(message_ids);
+    free(committed);
+
+    if (failed && committed_len == 0) {
+        return EXIT_FAILURE;
+    }
+
+    LogInfo("%zu of %zu messages added to the database successfully.", committed_len, messages_len);
+
+    return EXIT_SUCCESS;
+}
+
+static int exec_sql_with_id(sqlite3* db, const char* sql, sqlite3_int64 id)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    sqlite3_bind_int64(stmt, 1, id);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Failed to execute SQL statement: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// text and fts entry of one shard message are replaced atomically,
+// found stays 0 when the shard has no such message of the sender
+static int edit_shard_message(
+    SQLiteConnectionPool* pool, int sender_id, const char* uuid, const char* data,
+    time_t updated_at, int* receiver_id, int* found)
+{
+    sqlite3* db = sqlite_get_connection(pool, SQLiteConnWrite);
+
+    if (exec_sql(db, "BEGIN IMMEDIATE;")) {
+        sqlite_release_connection(pool, db);
+        return EXIT_FAILURE;
+    }
+
+    const char* sql = "SELECT id, receiver_id FROM messages "
+                      "WHERE uuid = ? AND sender_id = ? AND deleted_at IS NULL;";
+    sqlite3_stmt* stmt;
+    sqlite3_int64 message_id = 0;
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        goto rollback;
+    }
+
+    if (bind_uuid(stmt, 1, uuid)) {
+        sqlite3_finalize(stmt);
+        goto rollback;
+    }
+    sqlite3_bind_int(stmt, 2, sender_id);
+
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        message_id = sqlite3_column_int64(stmt, 0);
+        *receiver_id = sqlite3_column_int(stmt, 1);
+        *found = 1;
+    }
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_ROW) {
+        if (rc != SQLITE_DONE) {
+            LogErr("Failed to execute SQL statement: %s", sqlite3_errmsg(db));
+            goto rollback;
+        }
+        exec_sql(db, "ROLLBACK;");
+        sqlite_release_connection(pool, db);
+        return EXIT_SUCCESS;
+    }
+
+    // fts 'delete' has to see the old text, so it goes before update
+    if (exec_sql_with_id(
+            db,
+            "INSERT INTO messages_fts (messages_fts, rowid, data) "
+            "SELECT 'delete', id, data FROM messages WHERE id = ?;",
+            message_id)) {
+        goto rollback;
+    }
+
+    sql = "UPDATE messages SET data = ?, updated_at = ? WHERE id = ?;";
+    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        goto rollback;
+    }
+
+    sqlite3_bind_text(stmt, 1, data, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, updated_at);
+    sqlite3_bind_int64(stmt, 3, message_id);
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Failed to execute SQL statement: %s", sqlite3_errmsg(db));
+        goto rollback;
+    }
+
+    if (add_message_to_fts_index(db, message_id, data)) {
+        goto rollback;
+    }
+
+    if (exec_sql(db, "COMMIT;")) {
+        goto rollback;
+    }
+
+    sqlite_release_connection(pool, db);
+    return EXIT_SUCCESS;
+
+rollback:
+    exec_sql(db, "ROLLBACK;");
+    sqlite_release_connection(pool, db);
+    return EXIT_FAILURE;
+}
+
+int edit_message_in_db(int sender_id, const char* uuid, const char* data, time_t updated_at, int* receiver_id)
+{
+    if (!uuid || !data || !receiver_id) {
+        LogErr("Invalid input parameters.");
+        return EXIT_FAILURE;
+    }
+
+    // like delete, author does not know receiver shard
+    for (int shard = 0; shard < DB_SHARDS; shard++) {
+        int found = 0;
+        if (edit_shard_message(&shard_pools[shard], sender_id, uuid, data, updated_at, receiver_id, &found)) {
+            return EXIT_FAILURE;
+        }
+
+        if (found) {
+            LogInfo("Message %s edited by user ID %d.", uuid, sender_id);
+            return EXIT_SUCCESS;
+        }
+    }
+
+    LogWarn("No message %s of user ID %d to edit.", uuid, sender_id);
+    return EXIT_FAILURE;
+}
+
+// soft delete and unread counter of receiver change atomically,
+// found stays 0 when the shard has no such message of the sender
+static int delete_shard_message(
+    SQLiteConnectionPool* pool, int sender_id, const char* uuid, time_t deleted_at, int* found)
+{
+    sqlite3* db = sqlite_get_connection(pool, SQLiteConnWrite);
+
+    if (exec_sql(db, "BEGIN IMMEDIATE;")) {
+        sqlite_release_connection(pool, db);
+        return EXIT_FAILURE;
+    }
+
+    const char* sql = "SELECT id, receiver_id FROM messages "
+                      "WHERE uuid = ? AND sender_id = ? AND deleted_at IS NULL;";
+    sqlite3_stmt* stmt;
+    sqlite3_int64 message_id = 0;
+    int receiver_id = 0;
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        goto rollback;
+    }
+
+    if (bind_uuid(stmt, 1, uuid)) {
+        sqlite3_finalize(stmt);
+        goto rollback;
+    }
+    sqlite3_bind_int(stmt, 2, sender_id);
+
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        message_id = sqlite3_column_int64(stmt, 0);
+        receiver_id = sqlite3_column_int(stmt, 1);
+        *found = 1;
+    }
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_ROW) {
+        if (rc != SQLITE_DONE) {
+            LogErr("Failed to execute SQL statement: %s", sqlite3_errmsg(db));
+            goto rollback;
+        }
+        exec_sql(db, "ROLLBACK;");
+        sqlite_release_connection(pool, db);
+        return EXIT_SUCCESS;
+    }
+
+    // row is purged later by messages compactor
+    sql = "UPDATE messages SET deleted_at = ?, updated_at = ? WHERE id = ?;";
+    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        goto rollback;
+    }
+
+    sqlite3_bind_int64(stmt, 1, deleted_at);
+    sqlite3_bind_int64(stmt, 2, deleted_at);
+    sqlite3_bind_int64(stmt, 3, message_id);
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Failed to execute SQL statement: %s", sqlite3_errmsg(db));
+        goto rollback;
+    }
+
+    // message past read watermark was counted as unread
+    sql = "UPDATE conversations SET unread_count = unread_count - 1 "
+          "WHERE user_id = ? AND peer_id = ? AND last_read_message_id < ? AND unread_count > 0;";
+    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        goto rollback;
+    }
+
+    sqlite3_bind_int(stmt, 1, receiver_id);
+    sqlite3_bind_int(stmt, 2, sender_id);
+    sqlite3_bind_int64(stmt, 3, message_id);
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Failed to update unread count: %s", sqlite3_errmsg(db));
+        goto rollback;
+    }
+
+    if (exec_sql(db, "COMMIT;")) {
+        goto rollback;
+    }
+
+    sqlite_release_connection(pool, db);
+    return EXIT_SUCCESS;
+
+rollback:
+    exec_sql(db, "ROLLBACK;");
+    sqlite_release_connection(pool, db);
+    return EXIT_FAILURE;
+}
+
+int delete_message_from_db(int sender_id, const char* uuid, time_t deleted_at)
+{
+    if (!uuid) {
+        LogErr("Invalid input parameters.");
+        return EXIT_FAILURE;
+    }
+
+    // author knows only message uuid, not receiver shard, so every
+    // shard is tried
+    for (int shard = 0; shard < DB_SHARDS; shard++) {
+        int found = 0;
+        if (delete_shard_message(&shard_pools[shard], sender_id, uuid, deleted_at, &found)) {
+            return EXIT_FAILURE;
+        }
+
+        if (found) {
+            LogInfo("Message %s deleted by user ID %d.", uuid, sender_id);
+            return EXIT_SUCCESS;
+        }
+    }
+
+    LogWarn("No message %s of user ID %d to delete.", uuid, sender_id);
+    return EXIT_FAILURE;
+}
+
+int get_user_id_by_session_key(const char* session_key, int* user_id)
+{
+    if (!session_key || !user_id) {
+        LogErr("Invalid input: session_key or user_id pointer is NULL.");
+        return EXIT_FAILURE;
+    }
+
+    sqlite3* db = sqlite_get_connection(conn_pool, SQLiteConnRead);
 
     const char* sql = "SELECT user_id FROM sessions WHERE session_key = ?;";
     sqlite3_stmt* stmt;
@@ -438,12 +1423,16 @@ int get_user_id_by_session_key(const char* session_key, int* user_id)
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     }
 
     // Bind the session_key to the SQL statement
-    sqlite3_bind_text(stmt, 1, session_key, -1, SQLITE_STATIC);
+    if (bind_uuid(stmt, 1, session_key)) {
+        sqlite3_finalize(stmt);
+        sqlite_release_connection(conn_pool, db);
+        return EXIT_FAILURE;
+    }
 
     // Execute the SQL statement
     rc = sqlite3_step(stmt);
@@ -452,7 +1441,7 @@ int get_user_id_by_session_key(const char* session_key, int* user_id)
         *user_id = sqlite3_column_int(stmt, 0);
         LogInfo("User ID retrieved for session key: %s -> User ID: %d", session_key, *user_id);
         sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(conn_pool, db);
         return EXIT_SUCCESS;
     } else if (rc == SQLITE_DONE) {
         // No matching session key found
@@ -464,7 +1453,7 @@ int get_user_id_by_session_key(const char* session_key, int* user_id)
 
     // Finalize the SQL statement
     sqlite3_finalize(stmt);
-    sqlite_release_connection(&conn_pool, db);
+    sqlite_release_connection(conn_pool, db);
     return EXIT_FAILURE;
 }
 
@@ -476,28 +1465,31 @@ int get_all_senders_uuid_and_nicknames_by_user_id_from_session_key(
         return EXIT_FAILURE;
     }
 
-    sqlite3* db = sqlite_get_connection(&conn_pool);
-
     // Find the user_id associated with the given session_key
+    // before taking a connection, lookup acquires its own one
     int user_id = 0;
     if (get_user_id_by_session_key(session_key, &user_id) != EXIT_SUCCESS) {
         LogErr("Failed to retrieve user ID for session key: %s", session_key);
-        sqlite_release_connection(&conn_pool, db);
         return EXIT_FAILURE;
     }
 
+    SQLiteConnectionPool* pool = get_shard_pool_by_user_id(user_id);
+    sqlite3* db = sqlite_get_connection(pool, SQLiteConnRead);
+
+    // most recent conversation first
     const char* sql =
-        "SELECT DISTINCT u.uuid, u.nickname "
-        "FROM messages m "
-        "JOIN users u ON m.sender_id = u.id "
-        "WHERE m.receiver_id = ?;";
+        "SELECT u.uuid, u.nickname, c.last_message_at, c.unread_count "
+        "FROM conversations c "
+        "JOIN users u ON c.peer_id = u.id "
+        "WHERE c.user_id = ? "
+        "ORDER BY c.last_message_at DESC, c.last_message_id DESC;";
 
     sqlite3_stmt* stmt;
 
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(pool, db);
         return EXIT_FAILURE;
     }
 
@@ -512,7 +1504,7 @@ int get_all_senders_uuid_and_nicknames_by_user_id_from_session_key(
     if (!*senders) {
         LogErr("Memory allocation failed for senders array.");
         sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(pool, db);
         return EXIT_FAILURE;
     }
 
@@ -523,18 +1515,23 @@ int get_all_senders_uuid_and_nicknames_by_user_id_from_session_key(
             if (!*senders) {
                 LogErr("Memory reallocation failed for senders array.");
                 sqlite3_finalize(stmt);
-                sqlite_release_connection(&conn_pool, db);
+                sqlite_release_connection(pool, db);
                 return EXIT_FAILURE;
             }
         }
 
         SenderUuidAndNickname* current_sender = &(*senders)[*senders_len];
 
-        const char* uuid = (const char*)sqlite3_column_text(stmt, 0);
+        char uuid[UUID4_LEN];
+        if (column_uuid(stmt, 0, uuid)) {
+            break;
+        }
         const char* nickname = (const char*)sqlite3_column_text(stmt, 1);
 
         current_sender->uuid = strdup(uuid);
         current_sender->nickname = strdup(nickname);
+        current_sender->last_message_at = sqlite3_column_int64(stmt, 2);
+        current_sender->unread_count = sqlite3_column_int(stmt, 3);
 
         if (!current_sender->uuid || !current_sender->nickname) {
             LogErr("Memory allocation failed for sender UUID or nickname.");
@@ -544,7 +1541,7 @@ int get_all_senders_uuid_and_nicknames_by_user_id_from_session_key(
             }
             free(*senders);
             sqlite3_finalize(stmt);
-            sqlite_release_connection(&conn_pool, db);
+            sqlite_release_connection(pool, db);
             return EXIT_FAILURE;
         }
 
@@ -559,128 +1556,1187 @@ int get_all_senders_uuid_and_nicknames_by_user_id_from_session_key(
         }
         free(*senders);
         sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
+        sqlite_release_connection(pool, db);
         return EXIT_FAILURE;
     }
 
     sqlite3_finalize(stmt);
-    sqlite_release_connection(&conn_pool, db);
+    sqlite_release_connection(pool, db);
 
     LogInfo("Retrieved %zu senders for user ID %d.", *senders_len, user_id);
     return EXIT_SUCCESS;
 }
 
-int get_messages_by_reciever_user_id_from_session_key_and_sender_user_uuid(
-    char* session_key, char* sender_uuid, int offset, int limit,
-    MessageWithTimeAndData** msgs, size_t* msgs_len) {
+typedef struct {
+    time_t starts_at;
+    time_t ends_at;
+    char* path;
+} MessagePartition;
 
-    if (!session_key || !sender_uuid || !msgs || !msgs_len) {
-        LogErr("Invalid input: session_key, sender_uuid, msgs, or msgs_len is NULL.");
-        return EXIT_FAILURE;
+static void free_message_partitions(MessagePartition* parts, size_t parts_len)
+{
+    for (size_t i = 0; i < parts_len; i++) {
+        free(parts[i].path);
     }
+    free(parts);
+}
 
-    sqlite3* db = sqlite_get_connection(&conn_pool);
+// archived months in chronological order, hot messages
+// table holds only rows newer than last partition end
+static int get_message_partitions(sqlite3* db, MessagePartition** parts, size_t* parts_len)
+{
+    const char* sql = "SELECT starts_at, ends_at, path FROM message_partitions ORDER BY starts_at ASC;";
+    sqlite3_stmt* stmt;
 
-    // Find the user_id associated with the given session_key
-    int receiver_user_id = 0;
-    if (get_user_id_by_session_key(session_key, &receiver_user_id) != EXIT_SUCCESS) {
-        LogErr("Failed to retrieve user ID for session key: %s", session_key);
-        sqlite_release_connection(&conn_pool, db);
+    *parts = NULL;
+    *parts_len = 0;
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
         return EXIT_FAILURE;
     }
 
-    // Find the sender_id associated with the sender_uuid
-    int sender_user_id = 0;
-    if (get_user_id_by_uuid(sender_uuid, &sender_user_id) != EXIT_SUCCESS) {
-        LogErr("Failed to retrieve user ID for sender UUID: %s", sender_uuid);
-        sqlite_release_connection(&conn_pool, db);
+    size_t capacity = 0;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (*parts_len == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            MessagePartition* new_parts = realloc(*parts, capacity * sizeof(MessagePartition));
+            if (!new_parts) {
+                LogErr("Memory reallocation failed for partitions array.");
+                break;
+            }
+            *parts = new_parts;
+        }
+
+        MessagePartition* part = &(*parts)[*parts_len];
+        part->starts_at = sqlite3_column_int64(stmt, 0);
+        part->ends_at = sqlite3_column_int64(stmt, 1);
+        part->path = strdup((const char*)sqlite3_column_text(stmt, 2));
+        if (!part->path) {
+            LogErr("Memory allocation failed for partition path.");
+            break;
+        }
+
+        (*parts_len)++;
+    }
+
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE) {
+        LogErr("Failed to fetch partitions: %s", sqlite3_errmsg(db));
+        free_message_partitions(*parts, *parts_len);
+        *parts = NULL;
+        *parts_len = 0;
         return EXIT_FAILURE;
     }
 
-    const char* sql =
-        "SELECT data, created_at, updated_at "
-        "FROM messages "
-        "WHERE receiver_id = ? AND sender_id = ? AND deleted_at IS NULL "
-        "ORDER BY created_at ASC "
-        "LIMIT ? OFFSET ?;";
+    return EXIT_SUCCESS;
+}
 
+static int attach_message_partition(sqlite3* db, const char* path)
+{
     sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    int rc = sqlite3_prepare_v2(db, "ATTACH DATABASE ? AS part;", -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
-        sqlite_release_connection(&conn_pool, db);
         return EXIT_FAILURE;
     }
 
-    // Bind parameters
-    sqlite3_bind_int(stmt, 1, receiver_user_id);
-    sqlite3_bind_int(stmt, 2, sender_user_id);
-    sqlite3_bind_int(stmt, 3, limit);
-    sqlite3_bind_int(stmt, 4, offset);
-
-    *msgs = NULL;
-    *msgs_len = 0;
+    sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Failed to attach partition '%s': %s", path, sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
 
-    size_t capacity = 10; // Initial capacity for the messages array
-    *msgs = malloc(capacity * sizeof(MessageWithTimeAndData));
-    if (!*msgs) {
-        LogErr("Memory allocation failed for messages array.");
+    return EXIT_SUCCESS;
+}
+
+// connection which failed to detach still has partition under
+// "part" name, caller has to discard it instead of releasing
+static int detach_message_partition(sqlite3* db)
+{
+    return exec_sql(db, "DETACH DATABASE part;");
+}
+
+static int count_conversation_messages(
+    sqlite3* db, const char* schema, int receiver_id, int sender_id, time_t created_from, int* count)
+{
+    char sql[256];
+    snprintf(sql, sizeof(sql),
+        "SELECT COUNT(*) FROM %s.messages "
+        "WHERE receiver_id = ? AND sender_id = ? AND created_at >= ? AND deleted_at IS NULL;",
+        schema);
+
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    sqlite3_bind_int(stmt, 1, receiver_id);
+    sqlite3_bind_int(stmt, 2, sender_id);
+    sqlite3_bind_int64(stmt, 3, created_from);
+
+    rc = sqlite3_step(stmt);
+    if (rc != SQLITE_ROW) {
+        LogErr("Failed to count messages: %s", sqlite3_errmsg(db));
         sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
         return EXIT_FAILURE;
     }
 
-    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        if (*msgs_len == capacity) {
-            capacity *= 2;
-            *msgs = realloc(*msgs, capacity * sizeof(MessageWithTimeAndData));
-            if (!*msgs) {
-                LogErr("Memory reallocation failed for messages array.");
-                sqlite3_finalize(stmt);
-                sqlite_release_connection(&conn_pool, db);
-                return EXIT_FAILURE;
-            }
-        }
+    *count = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    return EXIT_SUCCESS;
+}
+
+// appends at most limit rows to msgs growing it when needed
+static int fetch_conversation_messages(
+    sqlite3* db, const char* schema, int receiver_id, int sender_id, time_t created_from,
+    int offset, int limit, MessageRowHandler handler, void* ctx, int* fetched)
+{
+    char sql[256];
+    snprintf(sql, sizeof(sql),
+        "SELECT data, created_at, updated_at "
+        "FROM %s.messages "
+        "WHERE receiver_id = ? AND sender_id = ? AND created_at >= ? AND deleted_at IS NULL "
+        "ORDER BY created_at ASC "
+        "LIMIT ? OFFSET ?;",
+        schema);
+
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
 
-        MessageWithTimeAndData* current_msg = &(*msgs)[*msgs_len];
+    // Bind parameters
+    sqlite3_bind_int(stmt, 1, receiver_id);
+    sqlite3_bind_int(stmt, 2, sender_id);
+    sqlite3_bind_int64(stmt, 3, created_from);
+    sqlite3_bind_int(stmt, 4, limit);
+    sqlite3_bind_int(stmt, 5, offset);
 
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
         const char* data = (const char*)sqlite3_column_text(stmt, 0);
         time_t created_at = sqlite3_column_int64(stmt, 1);
         time_t updated_at = sqlite3_column_int64(stmt, 2);
 
-        current_msg->data = strdup(data);
-        current_msg->created_at = created_at;
-        current_msg->updated_at = updated_at;
+        if (handler(data ? data : "", created_at, updated_at, ctx)) {
+            LogErr("Message row handler failed, stopping page walk.");
+            sqlite3_finalize(stmt);
+            return EXIT_FAILURE;
+        }
+
+        (*fetched)++;
+    }
+
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE) {
+        LogErr("Failed to fetch message data: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// rows are handed over straight from sqlite3_step, so a page
+// is never materialized whatever its limit is
+int for_each_message_by_reciever_user_id_from_session_key_and_sender_user_uuid(
+    char* session_key, char* sender_uuid, int offset, int limit,
+    MessageRowHandler handler, void* ctx) {
+
+    if (!session_key || !sender_uuid || !handler) {
+        LogErr("Invalid input: session_key, sender_uuid, or handler is NULL.");
+        return EXIT_FAILURE;
+    }
+
+    // Find the user_id associated with the given session_key
+    // before taking a connection, lookups acquire their own ones
+    int receiver_user_id = 0;
+    if (get_user_id_by_session_key(session_key, &receiver_user_id) != EXIT_SUCCESS) {
+        LogErr("Failed to retrieve user ID for session key: %s", session_key);
+        return EXIT_FAILURE;
+    }
+
+    // Find the sender_id associated with the sender_uuid
+    int sender_user_id = 0;
+    if (get_user_id_by_uuid(sender_uuid, &sender_user_id) != EXIT_SUCCESS) {
+        LogErr("Failed to retrieve user ID for sender UUID: %s", sender_uuid);
+        return EXIT_FAILURE;
+    }
+
+    SQLiteConnectionPool* pool = get_shard_pool_by_user_id(receiver_user_id);
+    sqlite3* db = sqlite_get_connection(pool, SQLiteConnRead);
+
+    MessagePartition* parts = NULL;
+    size_t parts_len = 0;
+    if (get_message_partitions(db, &parts, &parts_len)) {
+        sqlite_release_connection(pool, db);
+        return EXIT_FAILURE;
+    }
+
+    // rows already moved to archive may still wait for deletion in hot table
+    time_t hot_from = parts_len > 0 ? parts[parts_len - 1].ends_at : 0;
+
+    int fetched = 0;
+
+    // pages are in ascending time order, so archived
+    // partitions are walked first, oldest one first
+    for (size_t i = 0; i < parts_len && fetched < limit; i++) {
+        if (attach_message_partition(db, parts[i].path)) {
+            goto fail;
+        }
+
+        int part_count = 0;
+        int rc = offset > 0 && count_conversation_messages(db, "part", receiver_user_id, sender_user_id, 0, &part_count);
+        int skip = !rc && offset > 0 && offset >= part_count;
+        if (!rc && !skip) {
+            rc = fetch_conversation_messages(
+                db, "part", receiver_user_id, sender_user_id, 0,
+                offset, limit - fetched, handler, ctx, &fetched);
+        }
+
+        if (detach_message_partition(db)) {
+            goto discard;
+        }
+        if (rc) {
+            goto fail;
+        }
+
+        offset = skip ? offset - part_count : 0;
+    }
+
+    if (fetched < limit
+        && fetch_conversation_messages(
+            db, "main", receiver_user_id, sender_user_id, hot_from,
+            offset, limit - fetched, handler, ctx, &fetched)) {
+        goto fail;
+    }
+
+    free_message_partitions(parts, parts_len);
+    sqlite_release_connection(pool, db);
+
+    LogInfo("Retrieved %d messages for receiver ID %d and sender ID %d.", fetched, receiver_user_id, sender_user_id);
+    return EXIT_SUCCESS;
+
+fail:
+    free_message_partitions(parts, parts_len);
+    sqlite_release_connection(pool, db);
+    return EXIT_FAILURE;
+
+discard:
+    free_message_partitions(parts, parts_len);
+    sqlite_discard_connection(pool, db);
+    return EXIT_FAILURE;
+}
+
+// every whitespace separated word of user input becomes quoted
+// fts5 string, so input never gets parsed as fts5 query syntax,
+// trailing '*' of a word is kept outside of quotes as prefix search
+static char* build_fts_match_query(const char* query)
+{
+    size_t query_len = strlen(query);
+    // worst case every char is a quote doubled plus quotes around one char words
+    char* match = malloc(query_len * 4 + 1);
+    if (!match) {
+        return NULL;
+    }
+
+    char* out = match;
+    const char* in = query;
+    while (*in) {
+        while (*in == ' ' || *in == '\t' || *in == '\n' || *in == '\r') {
+            in++;
+        }
+        if (!*in) {
+            break;
+        }
+
+        if (out != match) {
+            *out++ = ' ';
+        }
+        const char* word_end = in;
+        while (*word_end && *word_end != ' ' && *word_end != '\t' && *word_end != '\n' && *word_end != '\r') {
+            word_end++;
+        }
+        int prefix = word_end - in > 1 && word_end[-1] == '*';
+
+        *out++ = '"';
+        for (; in < word_end - prefix; in++) {
+            if (*in == '"') {
+                *out++ = '"';
+            }
+            *out++ = *in;
+        }
+        *out++ = '"';
+        if (prefix) {
+            *out++ = '*';
+            in++;
+        }
+    }
+    *out = '\0';
+
+    if (out == match) {
+        free(match);
+        return NULL;
+    }
+
+    return match;
+}
+
+void free_message_search_results(MessageSearchResult* msgs, size_t msgs_len)
+{
+    for (size_t i = 0; i < msgs_len; i++) {
+        free(msgs[i].data);
+    }
+    free(msgs);
+}
+
+// appends up to limit best matches of one shard to msgs
+static int search_shard_messages(
+    SQLiteConnectionPool* pool, const char* match, int user_id, int limit,
+    MessageSearchResult** msgs, size_t* msgs_len, size_t* capacity)
+{
+    sqlite3* db = sqlite_get_connection(pool, SQLiteConnRead);
+
+    // only messages from conversations user takes part in, best match first
+    const char* sql =
+        "SELECT m.uuid, s.uuid, r.uuid, m.data, m.created_at, m.updated_at, f.rank "
+        "FROM messages_fts f "
+        "JOIN messages m ON m.id = f.rowid "
+        "JOIN users s ON s.id = m.sender_id "
+        "JOIN users r ON r.id = m.receiver_id "
+        "WHERE messages_fts MATCH ? "
+        "AND (m.receiver_id = ? OR m.sender_id = ?) "
+        "AND m.deleted_at IS NULL "
+        "ORDER BY f.rank "
+        "LIMIT ?;";
+
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        sqlite_release_connection(pool, db);
+        return EXIT_FAILURE;
+    }
+
+    sqlite3_bind_text(stmt, 1, match, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, user_id);
+    sqlite3_bind_int(stmt, 3, user_id);
+    sqlite3_bind_int(stmt, 4, limit);
+
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (*msgs_len == *capacity) {
+            size_t new_capacity = *capacity * 2;
+            MessageSearchResult* new_msgs = realloc(*msgs, new_capacity * sizeof(MessageSearchResult));
+            if (!new_msgs) {
+                LogErr("Memory reallocation failed for search results array.");
+                break;
+            }
+            *msgs = new_msgs;
+            *capacity = new_capacity;
+        }
+
+        MessageSearchResult* current_msg = &(*msgs)[*msgs_len];
+        if (column_uuid(stmt, 0, current_msg->uuid)
+            || column_uuid(stmt, 1, current_msg->sender_uuid)
+            || column_uuid(stmt, 2, current_msg->receiver_uuid)) {
+            break;
+        }
 
+        current_msg->data = strdup((const char*)sqlite3_column_text(stmt, 3));
+        current_msg->created_at = sqlite3_column_int64(stmt, 4);
+        current_msg->updated_at = sqlite3_column_int64(stmt, 5);
+        current_msg->rank = sqlite3_column_double(stmt, 6);
         if (!current_msg->data) {
             LogErr("Memory allocation failed for message data.");
-            for (size_t i = 0; i < *msgs_len; i++) {
-                free((*msgs)[i].data);
+            break;
+        }
+
+        (*msgs_len)++;
+    }
+
+    if (rc != SQLITE_DONE) {
+        LogErr("Failed to fetch search results: %s", sqlite3_errmsg(db));
+        sqlite3_finalize(stmt);
+        sqlite_release_connection(pool, db);
+        return EXIT_FAILURE;
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite_release_connection(pool, db);
+    return EXIT_SUCCESS;
+}
+
+static int compare_search_results_by_rank(const void* a, const void* b)
+{
+    double rank_a = ((const MessageSearchResult*)a)->rank;
+    double rank_b = ((const MessageSearchResult*)b)->rank;
+    return (rank_a > rank_b) - (rank_a < rank_b);
+}
+
+int search_messages_by_user_id_from_session_key(
+    char* session_key, const char* query, int offset, int limit,
+    MessageSearchResult** msgs, size_t* msgs_len)
+{
+    if (!session_key || !query || !msgs || !msgs_len) {
+        LogErr("Invalid input: session_key, query, msgs, or msgs_len is NULL.");
+        return EXIT_FAILURE;
+    }
+
+    int user_id = 0;
+    if (get_user_id_by_session_key(session_key, &user_id) != EXIT_SUCCESS) {
+        LogErr("Failed to retrieve user ID for session key: %s", session_key);
+        return EXIT_FAILURE;
+    }
+
+    char* match = build_fts_match_query(query);
+    if (!match) {
+        LogErr("Empty or unallocatable search query: '%s'", query);
+        return EXIT_FAILURE;
+    }
+
+    *msgs_len = 0;
+
+    size_t capacity = 10; // Initial capacity for the results array
+    *msgs = malloc(capacity * sizeof(MessageSearchResult));
+    if (!*msgs) {
+        LogErr("Memory allocation failed for search results array.");
+        free(match);
+        return EXIT_FAILURE;
+    }
+
+    // messages sent by user live in receivers shards, so every shard
+    // gives its best offset + limit matches and they are merged by rank;
+    // bm25 statistics are per shard, so merged order is approximate
+    for (int shard = 0; shard < DB_SHARDS; shard++) {
+        if (search_shard_messages(&shard_pools[shard], match, user_id, offset + limit, msgs, msgs_len, &capacity)) {
+            free_message_search_results(*msgs, *msgs_len);
+            *msgs = NULL;
+            *msgs_len = 0;
+            free(match);
+            return EXIT_FAILURE;
+        }
+    }
+    free(match);
+
+    qsort(*msgs, *msgs_len, sizeof(MessageSearchResult), compare_search_results_by_rank);
+
+    size_t skip = (size_t)offset < *msgs_len ? (size_t)offset : *msgs_len;
+    for (size_t i = 0; i < skip; i++) {
+        free((*msgs)[i].data);
+    }
+    memmove(*msgs, *msgs + skip, (*msgs_len - skip) * sizeof(MessageSearchResult));
+    *msgs_len -= skip;
+
+    if (*msgs_len > (size_t)limit) {
+        for (size_t i = limit; i < *msgs_len; i++) {
+            free((*msgs)[i].data);
+        }
+        *msgs_len = limit;
+    }
+
+    LogInfo("Found %zu messages for user ID %d and query '%s'.", *msgs_len, user_id, query);
+    return EXIT_SUCCESS;
+}
+
+void free_sync_messages(SyncMessage* msgs, size_t msgs_len)
+{
+    for (size_t i = 0; i < msgs_len; i++) {
+        free(msgs[i].data);
+    }
+    free(msgs);
+}
+
+// appends rows of prepared sync statement, max_rows < 0 means no limit,
+// more is set when rows were left after max_rows
+static int fetch_sync_messages(
+    sqlite3* db, sqlite3_stmt* stmt, int max_rows,
+    SyncMessage** msgs, size_t* msgs_len, size_t* capacity, long long* last_id, int* more)
+{
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (max_rows-- == 0) {
+            *more = 1;
+            break;
+        }
+
+        if (*msgs_len == *capacity) {
+            size_t new_capacity = *capacity * 2;
+            SyncMessage* new_msgs = realloc(*msgs, new_capacity * sizeof(SyncMessage));
+            if (!new_msgs) {
+                LogErr("Memory reallocation failed for sync messages array.");
+                return EXIT_FAILURE;
             }
-            free(*msgs);
-            sqlite3_finalize(stmt);
-            sqlite_release_connection(&conn_pool, db);
+            *msgs = new_msgs;
+            *capacity = new_capacity;
+        }
+
+        SyncMessage* current_msg = &(*msgs)[*msgs_len];
+        if (column_uuid(stmt, 1, current_msg->uuid)
+            || column_uuid(stmt, 2, current_msg->sender_uuid)
+            || column_uuid(stmt, 7, current_msg->receiver_uuid)) {
+            return EXIT_FAILURE;
+        }
+
+        current_msg->created_at = sqlite3_column_int64(stmt, 4);
+        current_msg->updated_at = sqlite3_column_int64(stmt, 5);
+        current_msg->deleted_at = sqlite3_column_int64(stmt, 6);
+        // text of deleted messages is not sent anymore
+        current_msg->data = strdup(current_msg->deleted_at ? "" : (const char*)sqlite3_column_text(stmt, 3));
+        if (!current_msg->data) {
+            LogErr("Memory allocation failed for message data.");
             return EXIT_FAILURE;
         }
 
+        current_msg->id = sqlite3_column_int64(stmt, 0);
+        if (last_id) {
+            *last_id = current_msg->id;
+        }
         (*msgs_len)++;
     }
 
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        LogErr("Failed to fetch sync messages: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// columns in order fetch_sync_messages reads them
+#define SYNC_MESSAGES_SELECT(schema)                                        \
+    "SELECT m.id, m.uuid, s.uuid, m.data, m.created_at, m.updated_at, "     \
+    "m.deleted_at, r.uuid FROM " schema ".messages m "                      \
+    "JOIN users s ON s.id = m.sender_id JOIN users r ON r.id = m.receiver_id "
+
+// already synced messages edited or deleted after cursor, unary +
+// keeps planner on updated_at index instead of walking all old ids;
+// archived months are read only, so only hot table can have changes
+static const char sync_changed_sql[] =
+    SYNC_MESSAGES_SELECT("main")
+    "WHERE m.receiver_id = ?1 AND +m.id <= ?2 AND m.updated_at >= ?3 AND m.id > ?4 "
+    "UNION ALL " SYNC_MESSAGES_SELECT("main")
+    "WHERE m.sender_id = ?1 AND m.receiver_id <> ?1 "
+    "AND +m.id <= ?2 AND m.updated_at >= ?3 AND m.id > ?4 "
+    "ORDER BY 1 LIMIT ?5;";
+
+// messages received or sent after cursor and below ?3, arms walk
+// their index in id order and are merged, so limit stops reading
+// early; messages to oneself come only from received arm; rows
+// created before ?4 are already archived and come from partitions
+static const char sync_new_sql[] =
+    SYNC_MESSAGES_SELECT("main")
+    "WHERE m.receiver_id = ?1 AND m.id > ?2 AND m.id < ?3 AND m.created_at >= ?4 "
+    "UNION ALL " SYNC_MESSAGES_SELECT("main")
+    "WHERE m.sender_id = ?1 AND m.receiver_id <> ?1 "
+    "AND m.id > ?2 AND m.id < ?3 AND m.created_at >= ?4 "
+    "ORDER BY 1 LIMIT ?5;";
+
+// same over attached partition, archived rows keep their hot table id
+static const char sync_archived_sql[] =
+    SYNC_MESSAGES_SELECT("part")
+    "WHERE m.receiver_id = ?1 AND m.id > ?2 AND m.id < ?3 "
+    "UNION ALL " SYNC_MESSAGES_SELECT("part")
+    "WHERE m.sender_id = ?1 AND m.receiver_id <> ?1 AND m.id > ?2 AND m.id < ?3 "
+    "ORDER BY 1 LIMIT ?4;";
+
+// changed pass over one shard, extra row over max_rows tells if there are more
+static int fetch_shard_changed_sync_messages(
+    SQLiteConnectionPool* pool, int user_id, long long after_id,
+    time_t changed_since, long long resume_id, int max_rows,
+    SyncMessage** msgs, size_t* msgs_len, size_t* capacity, long long* last_id, int* more)
+{
+    sqlite3* db = sqlite_get_connection(pool, SQLiteConnRead);
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sync_changed_sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        sqlite_release_connection(pool, db);
+        return EXIT_FAILURE;
+    }
+
+    sqlite3_bind_int(stmt, 1, user_id);
+    sqlite3_bind_int64(stmt, 2, after_id);
+    sqlite3_bind_int64(stmt, 3, changed_since);
+    sqlite3_bind_int64(stmt, 4, resume_id);
+    sqlite3_bind_int(stmt, 5, max_rows + 1);
+
+    int rc = fetch_sync_messages(db, stmt, max_rows, msgs, msgs_len, capacity, last_id, more);
+    sqlite3_finalize(stmt);
+    sqlite_release_connection(pool, db);
+    return rc;
+}
+
+static int compare_sync_message_ids(const void* a, const void* b)
+{
+    long long id_a = ((const SyncMessage*)a)->id;
+    long long id_b = ((const SyncMessage*)b)->id;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+// keeps lowest ids of rows appended since first, at most keep of them
+static void trim_sync_messages(SyncMessage* msgs, size_t first, size_t* msgs_len, size_t keep)
+{
+    qsort(msgs + first, *msgs_len - first, sizeof(SyncMessage), compare_sync_message_ids);
+    while (*msgs_len - first > keep) {
+        free(msgs[--(*msgs_len)].data);
+    }
+}
+
+// appends rows of one sync_new_sql or sync_archived_sql source, only
+// ones below lowest id already cut off by limit can still get in
+static int fetch_sync_source(
+    sqlite3* db, const char* sql, int user_id, long long after_id, time_t hot_from, int max_rows,
+    SyncMessage** msgs, size_t first, size_t* msgs_len, size_t* capacity)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    int param = 1;
+    sqlite3_bind_int(stmt, param++, user_id);
+    sqlite3_bind_int64(stmt, param++, after_id);
+    sqlite3_bind_int64(stmt, param++, *msgs_len - first > (size_t)max_rows ? (*msgs)[*msgs_len - 1].id : LLONG_MAX);
+    if (sql == sync_new_sql) {
+        sqlite3_bind_int64(stmt, param++, hot_from);
+    }
+    sqlite3_bind_int(stmt, param, max_rows + 1);
+
+    int more = 0;
+    int rc = fetch_sync_messages(db, stmt, -1, msgs, msgs_len, capacity, NULL, &more);
+    sqlite3_finalize(stmt);
+    if (rc == EXIT_SUCCESS) {
+        trim_sync_messages(*msgs, first, msgs_len, max_rows + 1);
+    }
+    return rc;
+}
+
+// new messages pass over one shard; cursor older than hot table means
+// some of them may be archived already, so archived months are read
+// too and merged with hot rows by id, every source capped at max_rows
+// plus one row which tells if there are more
+static int fetch_shard_new_sync_messages(
+    SQLiteConnectionPool* pool, int user_id, long long after_id, time_t changed_since, int max_rows,
+    SyncMessage** msgs, size_t* msgs_len, size_t* capacity, long long* last_id, int* more)
+{
+    sqlite3* db = sqlite_get_connection(pool, SQLiteConnRead);
+
+    MessagePartition* parts = NULL;
+    size_t parts_len = 0;
+    if (get_message_partitions(db, &parts, &parts_len)) {
+        sqlite_release_connection(pool, db);
+        return EXIT_FAILURE;
+    }
+
+    // messages above cursor were created after changed_since, which
+    // is 0 on full resync; rows older than hot_from may still wait for
+    // deletion in hot table after they were copied to archive
+    time_t hot_from = parts_len > 0 ? parts[parts_len - 1].ends_at : 0;
+    size_t archived_len = parts_len;
+    if (changed_since >= hot_from) {
+        archived_len = 0;
+        hot_from = 0;
+    }
+
+    size_t first = *msgs_len;
+    for (size_t i = 0; i < archived_len; i++) {
+        if (attach_message_partition(db, parts[i].path)) {
+            goto fail;
+        }
+
+        int rc = fetch_sync_source(db, sync_archived_sql, user_id, after_id, 0, max_rows, msgs, first, msgs_len, capacity);
+
+        if (detach_message_partition(db)) {
+            goto discard;
+        }
+        if (rc) {
+            goto fail;
+        }
+    }
+
+    if (fetch_sync_source(db, sync_new_sql, user_id, after_id, hot_from, max_rows, msgs, first, msgs_len, capacity)) {
+        goto fail;
+    }
+
+    if (*msgs_len - first > (size_t)max_rows) {
+        *more = 1;
+        trim_sync_messages(*msgs, first, msgs_len, max_rows);
+    }
+    if (*msgs_len > first) {
+        *last_id = (*msgs)[*msgs_len - 1].id;
+    }
+
+    free_message_partitions(parts, parts_len);
+    sqlite_release_connection(pool, db);
+    return EXIT_SUCCESS;
+
+fail:
+    free_message_partitions(parts, parts_len);
+    sqlite_release_connection(pool, db);
+    return EXIT_FAILURE;
+
+discard:
+    free_message_partitions(parts, parts_len);
+    sqlite_discard_connection(pool, db);
+    return EXIT_FAILURE;
+}
+
+int get_sync_messages_by_user_id_from_session_key(
+    char* session_key, SyncCursor* cursor, int limit,
+    SyncMessage** msgs, size_t* msgs_len, int* has_more)
+{
+    if (!session_key || !cursor || !msgs || !msgs_len || !has_more || limit <= 0
+        || cursor->changed_shard < 0 || cursor->changed_shard > DB_SHARDS) {
+        LogErr("Invalid input parameters.");
+        return EXIT_FAILURE;
+    }
+
+    int user_id = 0;
+    if (get_user_id_by_session_key(session_key, &user_id) != EXIT_SUCCESS) {
+        LogErr("Failed to retrieve user ID for session key: %s", session_key);
+        return EXIT_FAILURE;
+    }
+
+    *msgs_len = 0;
+    *has_more = 0;
+
+    size_t capacity = 16; // Initial capacity for the messages array
+    *msgs = malloc(capacity * sizeof(SyncMessage));
+    if (!*msgs) {
+        LogErr("Memory allocation failed for sync messages array.");
+        return EXIT_FAILURE;
+    }
+
+    // received messages live in user shard, sent ones in shards of
+    // their receivers; changes go first so new messages can't starve
+    // them, cursor moves only over what was returned
+    for (int shard = cursor->changed_shard; shard < DB_SHARDS && !*has_more; shard++) {
+        if (shard != cursor->changed_shard) {
+            cursor->changed_after_id = 0;
+        }
+        cursor->changed_shard = shard;
+        if (cursor->after_ids[shard] > 0
+            && fetch_shard_changed_sync_messages(
+                &shard_pools[shard], user_id, cursor->after_ids[shard], cursor->changed_since,
+                cursor->changed_after_id, limit - (int)*msgs_len,
+                msgs, msgs_len, &capacity, &cursor->changed_after_id, has_more)) {
+            goto fail;
+        }
+    }
+    if (*has_more) {
+        LogInfo("Synced %zu changed messages for user ID %d, more changes left.", *msgs_len, user_id);
+        return EXIT_SUCCESS;
+    }
+    cursor->changed_shard = DB_SHARDS;
+    cursor->changed_after_id = 0;
+
+    for (int shard = 0; shard < DB_SHARDS && !*has_more; shard++) {
+        if (fetch_shard_new_sync_messages(
+                &shard_pools[shard], user_id, cursor->after_ids[shard], cursor->changed_since,
+                limit - (int)*msgs_len, msgs, msgs_len, &capacity, &cursor->after_ids[shard], has_more)) {
+            goto fail;
+        }
+    }
+
+    LogInfo("Synced %zu messages for user ID %d.", *msgs_len, user_id);
+    return EXIT_SUCCESS;
+
+fail:
+    free_sync_messages(*msgs, *msgs_len);
+    *msgs = NULL;
+    *msgs_len = 0;
+    return EXIT_FAILURE;
+}
+
+int get_received_message_read_watermark(int user_id, const char* uuid, ReadWatermark* wm)
+{
+    if (!uuid || !wm) {
+        LogErr("Invalid input parameters.");
+        return EXIT_FAILURE;
+    }
+
+    // received message lives in the reader shard
+    SQLiteConnectionPool* pool = get_shard_pool_by_user_id(user_id);
+    sqlite3* db = sqlite_get_connection(pool, SQLiteConnRead);
+
+    const char* sql = "SELECT id, sender_id, created_at FROM messages WHERE uuid = ? AND receiver_id = ?;";
+    sqlite3_stmt* stmt;
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        sqlite_release_connection(pool, db);
+        return EXIT_FAILURE;
+    }
+
+    if (bind_uuid(stmt, 1, uuid)) {
+        sqlite3_finalize(stmt);
+        sqlite_release_connection(pool, db);
+        return EXIT_FAILURE;
+    }
+    sqlite3_bind_int(stmt, 2, user_id);
+
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        wm->user_id = user_id;
+        wm->peer_id = sqlite3_column_int(stmt, 1);
+        wm->message_id = sqlite3_column_int64(stmt, 0);
+        wm->message_created_at = sqlite3_column_int64(stmt, 2);
+        sqlite3_finalize(stmt);
+        sqlite_release_connection(pool, db);
+        return EXIT_SUCCESS;
+    } else if (rc == SQLITE_DONE) {
+        LogWarn("No message %s received by user ID %d.", uuid, user_id);
+    } else {
+        LogErr("Failed to execute SQL statement: %s", sqlite3_errmsg(db));
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite_release_connection(pool, db);
+    return EXIT_FAILURE;
+}
+
+static int save_read_watermark(sqlite3* db, const ReadWatermark* wm)
+{
+    // watermark never moves back, unread messages are counted
+    // through conversation index starting from watermark time
+    const char* sql = "UPDATE conversations SET "
+                      "last_read_message_id = ?3, "
+                      "unread_count = (SELECT COUNT(*) FROM messages "
+                      "WHERE receiver_id = ?1 AND sender_id = ?2 AND created_at >= ?4 "
+                      "AND id > ?3 AND deleted_at IS NULL) "
+                      "WHERE user_id = ?1 AND peer_id = ?2 AND last_read_message_id < ?3;";
+    sqlite3_stmt* stmt;
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    sqlite3_bind_int(stmt, 1, wm->user_id);
+    sqlite3_bind_int(stmt, 2, wm->peer_id);
+    sqlite3_bind_int64(stmt, 3, wm->message_id);
+    sqlite3_bind_int64(stmt, 4, wm->message_created_at);
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
     if (rc != SQLITE_DONE) {
-        LogErr("Failed to fetch message data: %s", sqlite3_errmsg(db));
-        for (size_t i = 0; i < *msgs_len; i++) {
-            free((*msgs)[i].data);
+        LogErr("Failed to save read watermark: %s", sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int save_read_watermarks(const ReadWatermark* wms, size_t wms_len)
+{
+    if (!wms) {
+        LogErr("Invalid input parameters.");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+
+    // conversation rows live in reader shards, one transaction per shard
+    for (int shard = 0; shard < DB_SHARDS; shard++) {
+        SQLiteConnectionPool* pool = &shard_pools[shard];
+        sqlite3* db = NULL;
+
+        for (size_t i = 0; i < wms_len; i++) {
+            if (get_shard_pool_by_user_id(wms[i].user_id) != pool) {
+                continue;
+            }
+
+            if (!db) {
+                db = sqlite_get_connection(pool, SQLiteConnWrite);
+                if (exec_sql(db, "BEGIN IMMEDIATE;")) {
+                    sqlite_release_connection(pool, db);
+                    db = NULL;
+                    failed = 1;
+                    break;
+                }
+            }
+
+            if (save_read_watermark(db, &wms[i])) {
+                failed = 1;
+            }
         }
-        free(*msgs);
+
+        if (db) {
+            if (exec_sql(db, "COMMIT;")) {
+                exec_sql(db, "ROLLBACK;");
+                failed = 1;
+            }
+            sqlite_release_connection(pool, db);
+        }
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int create_group_in_db(const Group* group, const int* member_ids, size_t member_ids_len)
+{
+    if (!group || !group->uuid || !group->name || (!member_ids && member_ids_len > 0)) {
+        LogErr("Invalid input parameters.");
+        return EXIT_FAILURE;
+    }
+
+    const char* group_sql = "INSERT INTO chat_groups (uuid, name, owner_id, created_at) VALUES (?, ?, ?, ?);";
+    // duplicates and owner listed among members are ignored
+    const char* member_sql = "INSERT OR IGNORE INTO group_members (group_id, user_id, joined_at) VALUES (?, ?, ?);";
+    sqlite3_stmt* stmt;
+    sqlite3_int64 group_id;
+
+    // groups are global like users, so they live in main.db
+    sqlite3* db = sqlite_get_connection(conn_pool, SQLiteConnWrite);
+    if (exec_sql(db, "BEGIN IMMEDIATE;")) {
+        sqlite_release_connection(conn_pool, db);
+        return EXIT_FAILURE;
+    }
+
+    if (sqlite3_prepare_v2(db, group_sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        goto fail;
+    }
+
+    if (bind_uuid(stmt, 1, group->uuid)) {
+        sqlite3_finalize(stmt);
+        goto fail;
+    }
+    sqlite3_bind_text(stmt, 2, group->name, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, group->owner_id);
+    sqlite3_bind_int64(stmt, 4, group->created_at);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        LogErr("Failed to insert group: %s", sqlite3_errmsg(db));
         sqlite3_finalize(stmt);
-        sqlite_release_connection(&conn_pool, db);
+        goto fail;
+    }
+    sqlite3_finalize(stmt);
+
+    group_id = sqlite3_last_insert_rowid(db);
+
+    if (sqlite3_prepare_v2(db, member_sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        goto fail;
+    }
+
+    for (size_t i = 0; i <= member_ids_len; i++) {
+        sqlite3_bind_int64(stmt, 1, group_id);
+        sqlite3_bind_int(stmt, 2, i < member_ids_len ? member_ids[i] : group->owner_id);
+        sqlite3_bind_int64(stmt, 3, group->created_at);
+
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            LogErr("Failed to insert group member: %s", sqlite3_errmsg(db));
+            sqlite3_finalize(stmt);
+            goto fail;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    if (exec_sql(db, "COMMIT;")) {
+        goto fail;
+    }
+
+    sqlite_release_connection(conn_pool, db);
+    return EXIT_SUCCESS;
+
+fail:
+    exec_sql(db, "ROLLBACK;");
+    sqlite_release_connection(conn_pool, db);
+    return EXIT_FAILURE;
+}
+
+int get_group_members_by_uuid(const char* group_uuid, int user_id, int* group_id, int** member_ids, size_t* member_ids_len)
+{
+    if (!group_uuid || !group_id || !member_ids || !member_ids_len) {
+        LogErr("Invalid input parameters.");
+        return EXIT_FAILURE;
+    }
+
+    *member_ids = NULL;
+    *member_ids_len = 0;
+
+    // primary key of group_members keeps them sorted by user_id
+    const char* sql = "SELECT g.id, gm.user_id FROM chat_groups g "
+                      "JOIN group_members gm ON gm.group_id = g.id "
+                      "WHERE g.uuid = ? ORDER BY gm.user_id;";
+
+    sqlite3* db = sqlite_get_connection(conn_pool, SQLiteConnRead);
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        sqlite_release_connection(conn_pool, db);
         return EXIT_FAILURE;
     }
 
+    if (bind_uuid(stmt, 1, group_uuid)) {
+        sqlite3_finalize(stmt);
+        sqlite_release_connection(conn_pool, db);
+        return EXIT_FAILURE;
+    }
+
+    size_t capacity = 0;
+    int is_member = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (*member_ids_len == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            int* new_ids = realloc(*member_ids, capacity * sizeof(int));
+            if (!new_ids) {
+                LogErr("Memory allocation failed for group members.");
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            *member_ids = new_ids;
+        }
+
+        *group_id = sqlite3_column_int(stmt, 0);
+        int member_id = sqlite3_column_int(stmt, 1);
+        is_member |= member_id == user_id;
+        (*member_ids)[(*member_ids_len)++] = member_id;
+    }
+
     sqlite3_finalize(stmt);
-    sqlite_release_connection(&conn_pool, db);
+    sqlite_release_connection(conn_pool, db);
+
+    // groups of which user is not a member look the same as missing ones
+    if (rc != SQLITE_DONE || !is_member) {
+        free(*member_ids);
+        *member_ids = NULL;
+        *member_ids_len = 0;
+        return EXIT_FAILURE;
+    }
 
-    LogInfo("Retrieved %zu messages for receiver ID %d and sender ID %d.", *msgs_len, receiver_user_id, sender_user_id);
     return EXIT_SUCCESS;
 }
 
+int add_group_message_to_db(const GroupMessage* message)
+{
+    if (!message || !message->uuid || !message->data) {
+        LogErr("Invalid input parameters.");
+        return EXIT_FAILURE;
+    }
+
+    const char* sql = "INSERT INTO group_messages (created_at, updated_at, uuid, group_id, sender_id, data) "
+                      "VALUES (?, ?, ?, ?, ?, ?);";
+
+    sqlite3* db = sqlite_get_connection(conn_pool, SQLiteConnWrite);
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        sqlite_release_connection(conn_pool, db);
+        return EXIT_FAILURE;
+    }
+
+    sqlite3_bind_int64(stmt, 1, message->created_at);
+    sqlite3_bind_int64(stmt, 2, message->updated_at);
+    if (bind_uuid(stmt, 3, message->uuid)) {
+        sqlite3_finalize(stmt);
+        sqlite_release_connection(conn_pool, db);
+        return EXIT_FAILURE;
+    }
+    sqlite3_bind_int(stmt, 4, message->group_id);
+    sqlite3_bind_int(stmt, 5, message->sender_id);
+    sqlite3_bind_text(stmt, 6, message->data, -1, SQLITE_STATIC);
+
+    int rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Failed to insert group message: %s", sqlite3_errmsg(db));
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite_release_connection(conn_pool, db);
+
+    return rc == SQLITE_DONE ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int get_group_messages_from_db(int group_id, int offset, int limit, GroupMessageWithSender** msgs, size_t* msgs_len)
+{
+    if (!msgs || !msgs_len) {
+        LogErr("Invalid input parameters.");
+        return EXIT_FAILURE;
+    }
+
+    *msgs = NULL;
+    *msgs_len = 0;
+
+    const char* sql = "SELECT m.uuid, u.uuid, m.data, m.created_at, m.updated_at "
+                      "FROM group_messages m JOIN users u ON u.id = m.sender_id "
+                      "WHERE m.group_id = ? ORDER BY m.id LIMIT ? OFFSET ?;";
+
+    sqlite3* db = sqlite_get_connection(conn_pool, SQLiteConnRead);
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        sqlite_release_connection(conn_pool, db);
+        return EXIT_FAILURE;
+    }
+
+    sqlite3_bind_int(stmt, 1, group_id);
+    sqlite3_bind_int(stmt, 2, limit);
+    sqlite3_bind_int(stmt, 3, offset);
+
+    size_t capacity = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (*msgs_len == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            GroupMessageWithSender* new_msgs = realloc(*msgs, capacity * sizeof(GroupMessageWithSender));
+            if (!new_msgs) {
+                LogErr("Memory allocation failed for group messages.");
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            *msgs = new_msgs;
+        }
+
+        GroupMessageWithSender* msg = &(*msgs)[*msgs_len];
+        if (column_uuid(stmt, 0, msg->uuid) || column_uuid(stmt, 1, msg->sender_uuid)) {
+            rc = SQLITE_CORRUPT;
+            break;
+        }
+        msg->data = strdup((const char*)sqlite3_column_text(stmt, 2));
+        if (!msg->data) {
+            rc = SQLITE_NOMEM;
+            break;
+        }
+        msg->created_at = sqlite3_column_int64(stmt, 3);
+        msg->updated_at = sqlite3_column_int64(stmt, 4);
+        (*msgs_len)++;
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite_release_connection(conn_pool, db);
+
+    if (rc != SQLITE_DONE) {
+        free_group_messages(*msgs, *msgs_len);
+        *msgs = NULL;
+        *msgs_len = 0;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void free_group_messages(GroupMessageWithSender* msgs, size_t msgs_len)
+{
+    for (size_t i = 0; i < msgs_len; i++) {
+        free(msgs[i].data);
+    }
+    free(msgs);
+}
@@ -2,6 +2,12 @@
 #define DB_H
 
 #include "time.h"
+#include "uuid4.h"
+#include <stddef.h>
+
+// DB_SHARDS, set by Makefile, is number of database files messages
+// are spread over by user id, changing it for existing database is
+// not supported
 
 typedef struct {
     char* uuid;
@@ -31,6 +37,8 @@ int add_user_to_db(const User* user);
 int get_user_password_hash_and_pow_and_id_by_nickname_from_db(const char* nickname, char* password_hash, char* password_hash_pow, int* id);
 
 int get_user_id_by_uuid(const char* uuid, int* user_id);
+// resolves all uuids in one query, fails if any of them is unknown
+int get_user_ids_by_uuids(const char** uuids, size_t uuids_len, int* user_ids);
 int get_user_uuid_by_id(int user_id, char* uuid);
 
 int add_session_to_db(const Session* session);
@@ -38,22 +46,127 @@ int get_sessions_id_by_user_id(int user_id, Session** sessions, size_t* sessions
 int get_user_id_by_session_key(const char* session_key, int* user_id);
 
 int add_message_to_db(const Message* message);
+// one transaction per receiver shard instead of one per message;
+// fails only when nothing was stored, otherwise stored (may be NULL)
+// gets non zero for every message whose shard committed
+int add_messages_to_db(const Message* messages, size_t messages_len, char* stored);
+// soft delete, only author of message can delete it, messages moved
+// to archive files are read only and not found here
+int delete_message_from_db(int sender_id, const char* uuid, time_t deleted_at);
+// replaces text of not deleted message of its author, bumps updated_at
+int edit_message_in_db(int sender_id, const char* uuid, const char* data, time_t updated_at, int* receiver_id);
 
 typedef struct {
     char* uuid;
     char* nickname;
+    time_t last_message_at;
+    int unread_count;
 } SenderUuidAndNickname;
 
 int get_all_senders_uuid_and_nicknames_by_user_id_from_session_key(char* session_key, SenderUuidAndNickname** senders, size_t* senders_len);
 
+// called for every row of a page in order, data is owned by sqlite and
+// valid only during the call; non zero return stops the walk as failed
+typedef int (*MessageRowHandler)(const char* data, time_t created_at, time_t updated_at, void* ctx);
+
+int for_each_message_by_reciever_user_id_from_session_key_and_sender_user_uuid(
+    char* session_key, char* sender_uuid, int offset, int limit,
+    MessageRowHandler handler, void* ctx);
+
 typedef struct {
+    char uuid[UUID4_LEN];
+    char sender_uuid[UUID4_LEN];
+    char receiver_uuid[UUID4_LEN];
     char* data;
     time_t created_at;
     time_t updated_at;
-} MessageWithTimeAndData;
+    double rank;
+} MessageSearchResult;
 
-int get_messages_by_reciever_user_id_from_session_key_and_sender_user_uuid(
-    char* session_key, char* sender_uuid, int offset, int limit,
-    MessageWithTimeAndData** msgs, size_t* msgs_len);
+// searches hot table only, archived messages have no fts entries
+int search_messages_by_user_id_from_session_key(
+    char* session_key, const char* query, int offset, int limit,
+    MessageSearchResult** msgs, size_t* msgs_len);
+void free_message_search_results(MessageSearchResult* msgs, size_t msgs_len);
+
+typedef struct {
+    char uuid[UUID4_LEN];
+    char sender_uuid[UUID4_LEN];
+    char receiver_uuid[UUID4_LEN];
+    char* data;
+    time_t created_at;
+    time_t updated_at;
+    time_t deleted_at; // 0 while message is not deleted
+    long long id; // orders archived and hot rows of one shard
+} SyncMessage;
+
+// position of client in its messages, shard ids are independent
+// sequences so each shard has own one
+typedef struct {
+    long long after_ids[DB_SHARDS];
+    time_t changed_since;
+    // changed pass cut by limit resumes after this shard and id,
+    // changed_shard is DB_SHARDS once it went through all shards
+    // and only new messages are left
+    int changed_shard;
+    long long changed_after_id;
+} SyncCursor;
+
+// sent and received messages of user, first older ones changed at or
+// after changed_since, then new ones above after_ids, at most limit
+// of both together; cursor is moved past returned messages, has_more
+// is set when limit cut either pass; new ones of cursor older than
+// hot table, full resync included, come from archived months too;
+// every pass and shard reads on its own connection, so they are not
+// one snapshot, client upserts repeated messages by uuid
+int get_sync_messages_by_user_id_from_session_key(
+    char* session_key, SyncCursor* cursor, int limit,
+    SyncMessage** msgs, size_t* msgs_len, int* has_more);
+void free_sync_messages(SyncMessage* msgs, size_t msgs_len);
+
+typedef struct {
+    int user_id; // reader
+    int peer_id; // sender of read messages
+    long long message_id;
+    time_t message_created_at;
+} ReadWatermark;
+
+// watermark at message uuid received by user_id
+int get_received_message_read_watermark(int user_id, const char* uuid, ReadWatermark* wm);
+// moves watermarks forward and recounts unread messages
+int save_read_watermarks(const ReadWatermark* wms, size_t wms_len);
+
+typedef struct {
+    char* uuid;
+    char* name;
+    int owner_id;
+    time_t created_at;
+} Group;
+
+typedef struct {
+    time_t created_at;
+    time_t updated_at;
+    char* uuid;
+    int group_id;
+    int sender_id;
+    char* data;
+} GroupMessage;
+
+typedef struct {
+    char uuid[UUID4_LEN];
+    char sender_uuid[UUID4_LEN];
+    char* data;
+    time_t created_at;
+    time_t updated_at;
+} GroupMessageWithSender;
+
+// owner becomes a member too
+int create_group_in_db(const Group* group, const int* member_ids, size_t member_ids_len);
+// member ids come sorted, fails if group is unknown or user_id is not its member
+int get_group_members_by_uuid(const char* group_uuid, int user_id, int* group_id, int** member_ids, size_t* member_ids_len);
+// one row per message whatever the size of group is
+int add_group_message_to_db(const GroupMessage* message);
+int get_group_messages_from_db(int group_id, int offset, int limit, GroupMessageWithSender** msgs, size_t* msgs_len);
+void free_group_messages(GroupMessageWithSender* msgs, size_t msgs_len);
 
 #endif
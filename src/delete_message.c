@@ -0,0 +1,43 @@
+#include "delete_message.h"
+#include "db.h"
+#include "json_reader.h"
+#include "log.h"
+#include <stdlib.h>
+
+#define DELETE_MESSAGE_INPUT_FIELDS(FIELD) \
+    FIELD(DeleteMessageInput, session_key, string) \
+    FIELD(DeleteMessageInput, uuid, string)
+
+JSON_DECODER(parse_json_to_delete_message_input, DeleteMessageInput, DELETE_MESSAGE_INPUT_FIELDS)
+
+int delete_message_route(HttpRequest* req, HttpResponse* res)
+{
+    LogInfo("delete_message_route executed");
+
+    DeleteMessageInput input;
+    if (parse_json_to_delete_message_input(req->body_len, req->body, &input)) {
+        LogErr("Incorrect Json on Input: %zu bytes", req->body_len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    int user_id;
+    if (get_user_id_by_session_key(input.session_key, &user_id)) {
+        LogErr("Cant find such session key in db: session_key = '%s'", input.session_key);
+        create_http_response(res, "403", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    // messages already moved to archive files are not found here
+    if (delete_message_from_db(user_id, input.uuid, time(NULL))) {
+        LogErr("Cant delete message: uuid = '%s'", input.uuid);
+        create_http_response(res, "404", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    create_http_response_static_body(res, "200", NULL, 0, HTTP_LITERAL_BODY("message deleted"));
+
+    LogInfo("message deleted successfully");
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef DELETE_MESSAGE_H
+#define DELETE_MESSAGE_H
+
+#include "http.h"
+
+// fields point into json parsed by parse_json_to_delete_message_input,
+// valid as long as it is and never freed
+typedef struct {
+    char* session_key;
+    char* uuid;
+} DeleteMessageInput;
+
+// parses json in place, see json_read_insitu
+int parse_json_to_delete_message_input(size_t json_len, char json[json_len], DeleteMessageInput* model);
+
+int delete_message_route(HttpRequest* req, HttpResponse* res);
+
+#endif
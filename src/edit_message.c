@@ -0,0 +1,63 @@
+#include "edit_message.h"
+#include "db.h"
+#include "event_bus.h"
+#include "events.h"
+#include "json_reader.h"
+#include "log.h"
+#include <stdlib.h>
+
+#define EDIT_MESSAGE_INPUT_FIELDS(FIELD) \
+    FIELD(EditMessageInput, session_key, string) \
+    FIELD(EditMessageInput, uuid, string) \
+    FIELD(EditMessageInput, msg, string)
+
+JSON_DECODER(parse_json_to_edit_message_input, EditMessageInput, EDIT_MESSAGE_INPUT_FIELDS)
+
+int edit_message_route(HttpRequest* req, HttpResponse* res)
+{
+    LogInfo("edit_message_route executed");
+
+    EditMessageInput input;
+    if (parse_json_to_edit_message_input(req->body_len, req->body, &input)) {
+        LogErr("Incorrect Json on Input: %zu bytes", req->body_len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    int user_id;
+    if (get_user_id_by_session_key(input.session_key, &user_id)) {
+        LogErr("Cant find such session key in db: session_key = '%s'", input.session_key);
+        create_http_response(res, "403", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    time_t current_time = time(NULL);
+
+    // messages already moved to archive files are not found here
+    int receiver_id;
+    if (edit_message_in_db(user_id, input.uuid, input.msg, current_time, &receiver_id)) {
+        LogErr("Cant edit message: uuid = '%s'", input.uuid);
+        create_http_response(res, "404", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    // receiver gets only the changed fields, not the conversation page
+    EventMessageEdited ev;
+    if (create_event_message_edited(&ev, input.uuid, input.msg, current_time)) {
+        LogErr("Cant create message edited event");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    if (add_new_event_to_queue_by_user_id(global_event_bus, receiver_id, (EventBase*)&ev)) {
+        LogWarn("Cant send message edited event to bus");
+    }
+    // bus queues own copies of the event
+    free_event_message_edited(&ev);
+
+    create_http_response_static_body(res, "200", NULL, 0, HTTP_LITERAL_BODY("message edited"));
+
+    LogInfo("message edited successfully");
+
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef EDIT_MESSAGE_H
+#define EDIT_MESSAGE_H
+
+#include "http.h"
+
+// fields point into json parsed by parse_json_to_edit_message_input,
+// valid as long as it is and never freed
+typedef struct {
+    char* session_key;
+    char* uuid;
+    char* msg;
+} EditMessageInput;
+
+// parses json in place, see json_read_insitu
+int parse_json_to_edit_message_input(size_t json_len, char json[json_len], EditMessageInput* model);
+
+int edit_message_route(HttpRequest* req, HttpResponse* res);
+
+#endif
@@ -49,13 +49,13 @@ int add_new_user_id_with_queue_to_event_bus(EventBus* eb, int user_id)
 
     // Check if we need to add a new user or reuse an existing one
     for (size_t i = 0; i < eb->user_queues_len && eb->user_queues_len > 0; ++i) {
-        if (eb->user_queues[i].connected == 0) {
+        if (eb->user_queues[i]->connected == 0) {
             LogTrace("Reusing existing slot for user ID: %d at index: %zu.", user_id, i);
-            eb->user_queues[i].user_id = user_id;
-            eb->user_queues[i].event_queue = createQueue();
-            eb->user_queues[i].connected = 1;
-            pthread_mutex_init(&eb->user_queues[i].mutex, NULL);
-            pthread_cond_init(&eb->user_queues[i].cond, NULL);
+            eb->user_queues[i]->user_id = user_id;
+            eb->user_queues[i]->event_queue = createQueue();
+            eb->user_queues[i]->connected = 1;
+            pthread_mutex_init(&eb->user_queues[i]->mutex, NULL);
+            pthread_cond_init(&eb->user_queues[i]->cond, NULL);
 
             pthread_mutex_unlock(&eb->mutex);
             return i;
@@ -65,18 +65,26 @@ int add_new_user_id_with_queue_to_event_bus(EventBus* eb, int user_id)
     // Add a new user id with a new queue
     size_t new_len = eb->user_queues_len + 1;
     LogTrace("Adding new slot for user ID: %d. New length: %zu.", user_id, new_len);
-    eb->user_queues = realloc(eb->user_queues, new_len * sizeof(UserIdWithQueue));
-    if (!eb->user_queues) {
+    UserIdWithQueue** user_queues = realloc(eb->user_queues, new_len * sizeof(UserIdWithQueue*));
+    if (!user_queues) {
+        LogErr("Failed to allocate memory for new user queue.");
+        pthread_mutex_unlock(&eb->mutex);
+        return -1;
+    }
+    eb->user_queues = user_queues;
+
+    eb->user_queues[new_len - 1] = malloc(sizeof(UserIdWithQueue));
+    if (!eb->user_queues[new_len - 1]) {
         LogErr("Failed to allocate memory for new user queue.");
         pthread_mutex_unlock(&eb->mutex);
         return -1;
     }
 
-    eb->user_queues[new_len - 1].user_id = user_id;
-    eb->user_queues[new_len - 1].event_queue = createQueue();
-    eb->user_queues[new_len - 1].connected = 1;
-    pthread_mutex_init(&eb->user_queues[new_len - 1].mutex, NULL);
-    pthread_cond_init(&eb->user_queues[new_len - 1].cond, NULL);
+    eb->user_queues[new_len - 1]->user_id = user_id;
+    eb->user_queues[new_len - 1]->event_queue = createQueue();
+    eb->user_queues[new_len - 1]->connected = 1;
+    pthread_mutex_init(&eb->user_queues[new_len - 1]->mutex, NULL);
+    pthread_cond_init(&eb->user_queues[new_len - 1]->cond, NULL);
 
     eb->user_queues_len = new_len;
 
@@ -91,20 +99,23 @@ int add_new_event_to_queue_by_user_id(EventBus* eb, int user_id, EventBase* ev)
 {
     LogTrace("Adding new event for user ID: %d.", user_id);
 
-    // Find the corresponding user queue
+    // Find the corresponding user queue, bus lock keeps subscriber
+    // from disconnecting and freeing its queue under us
     int found = 0;
+    pthread_mutex_lock(&eb->mutex);
     for (size_t i = 0; i < eb->user_queues_len; ++i) {
-        if (eb->user_queues[i].connected && eb->user_queues[i].user_id == user_id) {
+        if (eb->user_queues[i]->connected && eb->user_queues[i]->user_id == user_id) {
             LogTrace("Found user ID: %d at index: %zu. Adding event to queue.", user_id, i);
-            pthread_mutex_lock(&eb->user_queues[i].mutex);
+            pthread_mutex_lock(&eb->user_queues[i]->mutex);
             EventBase* ev_copy = NULL;
             copy_event_base(ev, &ev_copy);
-            enqueue(eb->user_queues[i].event_queue, ev_copy);
-            pthread_cond_signal(&eb->user_queues[i].cond); // Notify the user of the new event
-            pthread_mutex_unlock(&eb->user_queues[i].mutex);
+            enqueue(eb->user_queues[i]->event_queue, ev_copy);
+            pthread_cond_signal(&eb->user_queues[i]->cond); // Notify the user of the new event
+            pthread_mutex_unlock(&eb->user_queues[i]->mutex);
             found = 1;
         }
     }
+    pthread_mutex_unlock(&eb->mutex);
 
     if (!found) {
         LogWarn("User ID: %d not found or not connected.", user_id);
@@ -115,25 +126,96 @@ int add_new_event_to_queue_by_user_id(EventBus* eb, int user_id, EventBase* ev)
     return 0;
 }
 
+static int compare_user_ids(const void* a, const void* b)
+{
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Add an event to the queues of all users from sorted user_ids,
+// lookup is done per connected queue instead of per receiver
+// Returns number of queues the event was added to
+int add_new_event_to_queues_by_user_ids(EventBus* eb, const int* user_ids, size_t user_ids_len, EventBase* ev)
+{
+    LogTrace("Adding new event for %zu users.", user_ids_len);
+
+    int added = 0;
+    pthread_mutex_lock(&eb->mutex);
+    for (size_t i = 0; i < eb->user_queues_len; ++i) {
+        UserIdWithQueue* uq = eb->user_queues[i];
+        if (!uq->connected || !bsearch(&uq->user_id, user_ids, user_ids_len, sizeof(int), compare_user_ids)) {
+            continue;
+        }
+
+        EventBase* ev_copy = NULL;
+        if (copy_event_base(ev, &ev_copy)) {
+            LogErr("Failed to copy event for user ID: %d.", uq->user_id);
+            continue;
+        }
+
+        pthread_mutex_lock(&uq->mutex);
+        enqueue(uq->event_queue, ev_copy);
+        pthread_cond_signal(&uq->cond);
+        pthread_mutex_unlock(&uq->mutex);
+        added++;
+    }
+    pthread_mutex_unlock(&eb->mutex);
+
+    LogTrace("Event added to %d queues.", added);
+    return added;
+}
+
+// Fill online[i] for every user_ids[i] from connected slots of the event bus
+void get_users_presence(EventBus* eb, const int* user_ids, size_t user_ids_len, int* online)
+{
+    LogTrace("Getting presence of %zu users.", user_ids_len);
+    memset(online, 0, user_ids_len * sizeof(*online));
+
+    pthread_mutex_lock(&eb->mutex);
+    for (size_t i = 0; i < eb->user_queues_len; ++i) {
+        if (!eb->user_queues[i]->connected) {
+            continue;
+        }
+        for (size_t j = 0; j < user_ids_len; ++j) {
+            if (user_ids[j] == eb->user_queues[i]->user_id) {
+                online[j] = 1;
+            }
+        }
+    }
+    pthread_mutex_unlock(&eb->mutex);
+}
+
+int is_user_connected_to_event_bus(EventBus* eb, int user_id)
+{
+    int online;
+    get_users_presence(eb, &user_id, 1, &online);
+    return online;
+}
+
 // Disconnect a user by its index in the event bus
 void disconnect_from_queue_by_index(EventBus* eb, size_t index)
 {
     LogTrace("Disconnecting user at index: %zu.", index);
     pthread_mutex_lock(&eb->mutex);
 
-    if (index < eb->user_queues_len && eb->user_queues[index].connected) {
+    if (index < eb->user_queues_len && eb->user_queues[index]->connected) {
         LogTrace("User at index: %zu is connected. Proceeding with disconnection.", index);
         // Disconnect the user
-        eb->user_queues[index].connected = 0;
+        eb->user_queues[index]->connected = 0;
 
-        // Free the queue resources
-        Queue* event_queue = eb->user_queues[index].event_queue;
+        // Free the queue resources, events published after
+        // subscriber's last read are dropped with it
+        Queue* event_queue = eb->user_queues[index]->event_queue;
+        while (!isEmpty(event_queue)) {
+            free_event_base(dequeue(event_queue));
+        }
         free(event_queue);
-        eb->user_queues[index].event_queue = NULL;
+        eb->user_queues[index]->event_queue = NULL;
 
         // Optionally, free mutex and condition variable resources
-        pthread_mutex_destroy(&eb->user_queues[index].mutex);
-        pthread_cond_destroy(&eb->user_queues[index].cond);
+        pthread_mutex_destroy(&eb->user_queues[index]->mutex);
+        pthread_cond_destroy(&eb->user_queues[index]->cond);
     } else {
         LogWarn("Invalid index or user already disconnected: %zu.", index);
     }
@@ -142,27 +224,65 @@ void disconnect_from_queue_by_index(EventBus* eb, size_t index)
     LogTrace("User at index: %zu disconnected successfully.", index);
 }
 
+// array is looked up under bus lock, adding a user may realloc it;
+// slots themselves never move or get freed, so the one returned
+// stays valid after unlock for the subscriber owning the index
+static UserIdWithQueue* get_connected_slot(EventBus* eb, size_t index)
+{
+    UserIdWithQueue* uq = NULL;
+    pthread_mutex_lock(&eb->mutex);
+    if (index < eb->user_queues_len && eb->user_queues[index]->connected) {
+        uq = eb->user_queues[index];
+    }
+    pthread_mutex_unlock(&eb->mutex);
+
+    if (!uq) {
+        LogWarn("Invalid index or disconnected user at index: %zu.", index);
+    }
+    return uq;
+}
+
 // Wait for a new event in a user's queue and retrieve it by its index
 // Returns 0 if an event is successfully retrieved, < 0 on error
 int get_or_wait_for_new_event_in_queue_by_index(EventBus* eb, size_t index, EventBase** ev)
 {
     LogTrace("Waiting for new event in queue at index: %zu.", index);
 
-    if (index >= eb->user_queues_len || !eb->user_queues[index].connected) {
-        LogWarn("Invalid index or disconnected user at index: %zu.", index);
+    UserIdWithQueue* uq = get_connected_slot(eb, index);
+    if (!uq) {
         return -1; // Invalid index or disconnected user
     }
 
-    pthread_mutex_lock(&eb->user_queues[index].mutex);
+    pthread_mutex_lock(&uq->mutex);
 
-    while (isEmpty(eb->user_queues[index].event_queue)) {
+    while (isEmpty(uq->event_queue)) {
         LogTrace("Queue at index: %zu is empty. Waiting for event.", index);
-        pthread_cond_wait(&eb->user_queues[index].cond, &eb->user_queues[index].mutex);
+        pthread_cond_wait(&uq->cond, &uq->mutex);
     }
 
-    *ev = dequeue(eb->user_queues[index].event_queue); // Retrieve the event
+    *ev = dequeue(uq->event_queue); // Retrieve the event
     LogTrace("Event retrieved successfully from queue at index: %zu.", index);
 
-    pthread_mutex_unlock(&eb->user_queues[index].mutex);
+    pthread_mutex_unlock(&uq->mutex);
+    return 0;
+}
+
+int try_get_new_event_in_queue_by_index(EventBus* eb, size_t index, EventBase** ev)
+{
+    UserIdWithQueue* uq = get_connected_slot(eb, index);
+    if (!uq) {
+        return -1; // Invalid index or disconnected user
+    }
+
+    pthread_mutex_lock(&uq->mutex);
+
+    if (isEmpty(uq->event_queue)) {
+        pthread_mutex_unlock(&uq->mutex);
+        return 1;
+    }
+
+    *ev = dequeue(uq->event_queue);
+
+    pthread_mutex_unlock(&uq->mutex);
     return 0;
 }
@@ -15,7 +15,9 @@ typedef struct {
 
 typedef struct {
     size_t user_queues_len;
-    UserIdWithQueue* user_queues;
+    // slots are allocated one by one, so mutex and cond which
+    // subscribers wait on do not move when array grows
+    UserIdWithQueue** user_queues;
     pthread_mutex_t mutex;
 } EventBus;
 
@@ -31,9 +33,21 @@ int add_new_user_id_with_queue_to_event_bus(EventBus* eb, int user_id);
 // if all connected add new to array
 int add_new_event_to_queue_by_user_id(EventBus* eb, int user_id, EventBase* ev);
 
+// one pass over connected queues for many receivers,
+// user_ids must be sorted; returns number of queues event was put into
+int add_new_event_to_queues_by_user_ids(EventBus* eb, const int* user_ids, size_t user_ids_len, EventBase* ev);
+
+// presence is derived from connected event streams,
+// online[i] is 1 if user_ids[i] has at least one of them
+void get_users_presence(EventBus* eb, const int* user_ids, size_t user_ids_len, int* online);
+
+int is_user_connected_to_event_bus(EventBus* eb, int user_id);
+
 void disconnect_from_queue_by_index(EventBus* eb, size_t index);
 
 int get_or_wait_for_new_event_in_queue_by_index(EventBus* eb, size_t index, EventBase** ev);
+// like above but returns 1 instead of waiting when queue is empty
+int try_get_new_event_in_queue_by_index(EventBus* eb, size_t index, EventBase** ev);
 
 extern EventBus* global_event_bus;
 
@@ -1,14 +1,81 @@
 #include "event_subcribe.h"
+#include "compression.h"
 #include "db.h"
 #include "event_bus.h"
 #include "events.h"
 #include "http.h"
 #include "log.h"
 #include "utils.h"
+#include <stdio.h>
 #include <string.h>
 #include <sys/socket.h> // for socket
 #include <unistd.h>
 
+typedef struct {
+    int socket;
+    WireFormat format;
+    int compressed;
+    CompressStream cs;
+} EventStream;
+
+static int write_event_stream_output(const char* data, size_t len, void* ctx)
+{
+    EventStream* es = ctx;
+    return http_write_to_socket(es->socket, data, len);
+}
+
+static int write_event_stream_bytes(EventStream* es, const char* data, size_t len)
+{
+    return es->compressed
+        ? compress_stream_write(&es->cs, data, len)
+        : http_write_to_socket(es->socket, data, len);
+}
+
+// event which fails to encode is skipped, only socket errors end stream
+static int write_event(EventStream* es, EventBase* ev)
+{
+    size_t ev_data_len = 0;
+    char* ev_data = encode_event_base(ev, es->format, &ev_data_len);
+    if (!ev_data) {
+        LogErr("Failed to encode event");
+        return 0;
+    }
+
+    LogTrace("Event encoded: %zu bytes", ev_data_len);
+
+    int rc;
+    if (es->format != WireFormatJson) {
+        rc = write_event_stream_bytes(es, ev_data, ev_data_len);
+    } else if (!es->compressed) {
+        rc = http_write_event_stream_frame_to_socket(es->socket, event_type_strs[ev->event_type], ev_data, ev_data_len);
+    } else {
+        char event_line[64];
+        int event_line_len = snprintf(event_line, sizeof(event_line), HTTP_EVENT_STREAM_FRAME_HEAD, event_type_strs[ev->event_type]);
+        rc = write_event_stream_bytes(es, event_line, event_line_len)
+            || write_event_stream_bytes(es, ev_data, ev_data_len)
+            || write_event_stream_bytes(es, HTTP_EVENT_STREAM_FRAME_TAIL, sizeof(HTTP_EVENT_STREAM_FRAME_TAIL) - 1);
+    }
+
+    if (rc == 0) {
+        LogTrace("Event sent to client: %zu bytes", ev_data_len);
+    }
+
+    free(ev_data);
+    return rc;
+}
+
+static void close_event_stream(EventStream* es, int queue_index)
+{
+    if (es->compressed) {
+        compress_stream_close(&es->cs);
+    }
+
+    LogTrace("trying to disconnect from message queue");
+    disconnect_from_queue_by_index(global_event_bus, queue_index);
+
+    LogTrace("disconnected from message queue");
+}
+
 int event_subcribe_route(HttpRequest* req, HttpResponse* _)
 {
     LogTrace("Starting event_subscribe_route");
@@ -21,10 +88,15 @@ int event_subcribe_route(HttpRequest* req, HttpResponse* _)
 
     LogTrace("HttpResponse allocated successfully");
 
-    char* session_key = xsprintf("%.*s", (int)req->body_len, req->body);
+    // body is raw session key, nul inside would silently cut it;
+    // empty body has no buffer at all
+    char* session_key = NULL;
+    if (req->body_len > 0 && !memchr(req->body, '\0', req->body_len)) {
+        session_key = xsprintf("%.*s", (int)req->body_len, req->body);
+    }
     if (!session_key) {
         LogErr("Failed to parse session key from request body");
-        create_http_response(res, "400", NULL, 0, NULL);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
         http_response_write_to_socket(req->socket, res);
         free_http_response(res);
         return 0;
@@ -36,7 +108,7 @@ int event_subcribe_route(HttpRequest* req, HttpResponse* _)
     if (get_user_id_by_session_key(session_key, &user_id)) {
         LogErr("Failed to get user ID for session key: %s", session_key);
         free(session_key);
-        create_http_response(res, "403", NULL, 0, NULL);
+        create_http_response(res, "403", NULL, 0, NULL, 0);
         http_response_write_to_socket(req->socket, res);
         free_http_response(res);
         return 0;
@@ -48,7 +120,7 @@ int event_subcribe_route(HttpRequest* req, HttpResponse* _)
     int queue_index = add_new_user_id_with_queue_to_event_bus(global_event_bus, user_id);
     if (queue_index < 0) {
         LogErr("Failed to add user ID %d to event bus", user_id);
-        create_http_response(res, "500", NULL, 0, NULL);
+        create_http_response(res, "500", NULL, 0, NULL, 0);
         http_response_write_to_socket(req->socket, res);
         free_http_response(res);
         return 0;
@@ -56,21 +128,39 @@ int event_subcribe_route(HttpRequest* req, HttpResponse* _)
 
     LogTrace("User ID %d added to event bus with queue index %d", user_id, queue_index);
 
+    // binary formats are served as bare sequence of encoded
+    // {type, data} maps, sse text framing can't carry them
+    EventStream es = {
+        .socket = req->socket,
+        .format = wire_format_from_accept(http_request_get_header(req, "Accept")),
+    };
+    ContentEncoding encoding = content_encoding_from_accept(http_request_get_header(req, "Accept-Encoding"));
+    if (encoding != ContentEncodingIdentity
+        && compress_stream_open(&es.cs, encoding, write_event_stream_output, &es) == 0) {
+        es.compressed = 1;
+    } else {
+        encoding = ContentEncodingIdentity;
+    }
+
     create_http_response(
         res, "200",
         (const char*[]) {
             "X-Accel-Buffering: no",
-            "Content-Type: text/event-stream",
+            wire_format_stream_content_type_header(es.format),
             "Cache-Control: no-cache",
+            WIRE_FORMAT_VARY_HEADER,
+            "Vary: Accept-Encoding",
+            content_encoding_header(encoding),
         },
-        3,
-        NULL);
+        es.compressed ? 6 : 5,
+        NULL, 0);
 
     LogTrace("HTTP response for event stream created");
 
     if (http_response_write_to_socket(req->socket, res) < 0) {
         LogErr("Failed to write HTTP response to socket");
         free_http_response(res);
+        close_event_stream(&es, queue_index);
         return 0;
     }
 
@@ -86,39 +176,25 @@ int event_subcribe_route(HttpRequest* req, HttpResponse* _)
             continue;
         }
 
-        LogTrace("Event retrieved from queue index %d", queue_index);
-
-        char* ev_json = convert_event_base_to_json(ev);
-        if (!ev_json) {
-            LogErr("Failed to convert event to JSON");
+        // compressed stream takes whatever else is already queued and
+        // sync flushes once after, so a burst costs one flush
+        int batched = 0;
+        int rc;
+        do {
+            LogTrace("Event retrieved from queue index %d", queue_index);
+            rc = write_event(&es, ev);
             free_event_base(ev);
-            continue;
-        }
+        } while (rc == 0 && es.compressed && ++batched < EVENT_STREAM_MAX_BATCH
+            && try_get_new_event_in_queue_by_index(global_event_bus, queue_index, &ev) == 0);
 
-        LogTrace("Event converted to JSON: %s", ev_json);
-
-        char* sse_data = xsprintf("event: %s\ndata: %s\n\n", event_type_strs[ev->event_type], ev_json);
-
-        if (send(req->socket, sse_data, strlen(sse_data), 0) <= 0) {
+        if (rc == 0 && es.compressed) {
+            rc = compress_stream_flush(&es.cs);
+        }
+        if (rc) {
             perror("Cant write to event stream socket");
-            LogErr("Failed to write event JSON to socket");
-            free(ev_json);
-            free(sse_data);
-            free_event_base(ev);
-
-            LogTrace("trying to disconnect from message queue");
-            disconnect_from_queue_by_index(global_event_bus, queue_index);
-
-            LogTrace("disconnected from message queue");
+            LogErr("Failed to write event to socket");
+            close_event_stream(&es, queue_index);
             return 0;
         }
-
-        LogTrace("Event JSON sent to client: %s", ev_json);
-
-        free(ev_json);
-        free(sse_data);
-        free_event_base(ev);
     }
-
-    return 0;
 }
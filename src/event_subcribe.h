@@ -3,6 +3,10 @@
 
 #include "http.h"
 
+// events written to compressed stream before it is sync flushed,
+// bounds delay of first one when queue keeps refilling
+#define EVENT_STREAM_MAX_BATCH 64
+
 int event_subcribe_route(HttpRequest* req, HttpResponse* res);
 
 #endif
@@ -1,12 +1,104 @@
 #include "events.h"
+#include "json_writer.h"
 #include "utils.h"
 #include <stdlib.h>
 #include <string.h>
 
 const char* event_type_strs[] = {
     [NewMessageEventType] = "new_message",
+    [MessageEditedEventType] = "message_edited",
+    [ReadReceiptEventType] = "read_receipt",
+    [TypingEventType] = "typing",
+    [GroupMessageEventType] = "group_message",
 };
 
+// value writers shared by every wire format
+static void write_msg_with_meta_info(JsonWriter* w, const MsgWithMetaInfo* msg)
+{
+    json_writer_begin_object(w);
+    json_writer_key(w, "uuid");
+    json_writer_string(w, msg->uuid);
+    json_writer_key(w, "data");
+    json_writer_string(w, msg->data);
+    json_writer_key(w, "creation_date");
+    json_writer_int(w, msg->creation_date);
+    json_writer_end_object(w);
+}
+
+static void write_event_new_message(JsonWriter* w, const EventNewMessage* ev)
+{
+    json_writer_begin_object(w);
+    json_writer_key(w, "event_type");
+    json_writer_int(w, ev->base.event_type);
+    json_writer_key(w, "msgs");
+    json_writer_begin_array(w);
+    for (size_t i = 0; i < ev->msgs_len; ++i) {
+        write_msg_with_meta_info(w, &ev->msgs[i]);
+    }
+    json_writer_end_array(w);
+    json_writer_end_object(w);
+}
+
+static void write_event_message_edited(JsonWriter* w, const EventMessageEdited* ev)
+{
+    json_writer_begin_object(w);
+    json_writer_key(w, "event_type");
+    json_writer_int(w, ev->base.event_type);
+    json_writer_key(w, "uuid");
+    json_writer_string(w, ev->uuid);
+    json_writer_key(w, "data");
+    json_writer_string(w, ev->data);
+    json_writer_key(w, "updated_at");
+    json_writer_int(w, ev->updated_at);
+    json_writer_end_object(w);
+}
+
+static void write_event_read_receipt(JsonWriter* w, const EventReadReceipt* ev)
+{
+    json_writer_begin_object(w);
+    json_writer_key(w, "event_type");
+    json_writer_int(w, ev->base.event_type);
+    json_writer_key(w, "reader_uuid");
+    json_writer_string(w, ev->reader_uuid);
+    json_writer_key(w, "message_uuid");
+    json_writer_string(w, ev->message_uuid);
+    json_writer_key(w, "read_at");
+    json_writer_int(w, ev->read_at);
+    json_writer_end_object(w);
+}
+
+static void write_event_typing(JsonWriter* w, const EventTyping* ev)
+{
+    json_writer_begin_object(w);
+    json_writer_key(w, "event_type");
+    json_writer_int(w, ev->base.event_type);
+    json_writer_key(w, "sender_uuid");
+    json_writer_string(w, ev->sender_uuid);
+    json_writer_key(w, "typing_at");
+    json_writer_int(w, ev->typing_at);
+    json_writer_end_object(w);
+}
+
+static void write_event_group_message(
+    JsonWriter* w, const char* group_uuid, const char* uuid,
+    const char* sender_uuid, const char* data, time_t created_at)
+{
+    json_writer_begin_object(w);
+    json_writer_key(w, "event_type");
+    json_writer_int(w, GroupMessageEventType);
+    json_writer_key(w, "group_uuid");
+    json_writer_string(w, group_uuid);
+    json_writer_key(w, "uuid");
+    json_writer_string(w, uuid);
+    json_writer_key(w, "sender_uuid");
+    json_writer_string(w, sender_uuid);
+    json_writer_key(w, "data");
+    json_writer_string(w, data);
+    json_writer_key(w, "created_at");
+    json_writer_int(w, created_at);
+    json_writer_end_object(w);
+}
+
 // Function to create MsgWithMetaInfo structure
 int create_msg_with_meta_info(MsgWithMetaInfo* msg, char* uuid, char* data, time_t creation_date)
 {
@@ -27,6 +119,17 @@ int create_msg_with_meta_info(MsgWithMetaInfo* msg, char* uuid, char* data, time
     // Set creation date
     msg->creation_date = creation_date;
 
+    JsonWriter w;
+    json_writer_init(&w, 96 + strlen(data));
+    write_msg_with_meta_info(&w, msg);
+
+    msg->json = json_writer_finish(&w, &msg->json_len);
+    if (!msg->json) {
+        free(msg->data);
+        msg->data = NULL;
+        return -1; // Memory allocation failure
+    }
+
     return 0; // Success
 }
 
@@ -35,6 +138,7 @@ void free_message_with_metainfo(MsgWithMetaInfo* msg)
 {
     if (msg) {
         free(msg->data); // Free the dynamically allocated data
+        free(msg->json);
     }
 }
 
@@ -61,65 +165,231 @@ int create_event_new_message(EventNewMessage* ev, MsgWithMetaInfo* msg)
     return 0; // Success
 }
 
+int create_event_new_messages(EventNewMessage* ev, MsgWithMetaInfo* msgs, size_t msgs_len)
+{
+    if (!ev || !msgs) {
+        return -1; // Invalid arguments
+    }
+
+    ev->base.event_type = NewMessageEventType;
+    ev->msgs_len = msgs_len;
+    ev->msgs = msgs;
+
+    return 0; // Success
+}
+
+int create_event_message_edited(EventMessageEdited* ev, const char* uuid, const char* data, time_t updated_at)
+{
+    if (!ev || !uuid || !data) {
+        return -1; // Invalid arguments
+    }
+
+    ev->base.event_type = MessageEditedEventType;
+
+    strncpy(ev->uuid, uuid, UUID4_LEN);
+    ev->uuid[UUID4_LEN - 1] = '\0';
+
+    ev->data = strdup(data);
+    if (!ev->data) {
+        return -1; // Memory allocation failure
+    }
+
+    ev->updated_at = updated_at;
+
+    return 0; // Success
+}
+
+int create_event_read_receipt(EventReadReceipt* ev, const char* reader_uuid, const char* message_uuid, time_t read_at)
+{
+    if (!ev || !reader_uuid || !message_uuid) {
+        return -1; // Invalid arguments
+    }
+
+    ev->base.event_type = ReadReceiptEventType;
+
+    strncpy(ev->reader_uuid, reader_uuid, UUID4_LEN);
+    ev->reader_uuid[UUID4_LEN - 1] = '\0';
+    strncpy(ev->message_uuid, message_uuid, UUID4_LEN);
+    ev->message_uuid[UUID4_LEN - 1] = '\0';
+
+    ev->read_at = read_at;
+
+    return 0; // Success
+}
+
+int create_event_typing(EventTyping* ev, const char* sender_uuid, time_t typing_at)
+{
+    if (!ev || !sender_uuid) {
+        return -1; // Invalid arguments
+    }
+
+    ev->base.event_type = TypingEventType;
+
+    strncpy(ev->sender_uuid, sender_uuid, UUID4_LEN);
+    ev->sender_uuid[UUID4_LEN - 1] = '\0';
+
+    ev->typing_at = typing_at;
+
+    return 0; // Success
+}
+
+int create_event_group_message(
+    EventGroupMessage* ev, const char* group_uuid, const char* uuid,
+    const char* sender_uuid, const char* data, time_t created_at)
+{
+    if (!ev || !group_uuid || !uuid || !sender_uuid || !data) {
+        return -1; // Invalid arguments
+    }
+
+    ev->base.event_type = GroupMessageEventType;
+
+    JsonWriter w;
+    json_writer_init(&w, 192);
+    write_event_group_message(&w, group_uuid, uuid, sender_uuid, data, created_at);
+
+    size_t json_len;
+    char* json = json_writer_finish(&w, &json_len);
+    if (!json) {
+        return -1; // Memory allocation failure
+    }
+
+    // data is kept right after json in the same block
+    size_t data_len = strlen(data);
+    ev->shared = malloc(sizeof(SharedEventJson) + json_len + 1 + data_len + 1);
+    if (!ev->shared) {
+        free(json);
+        return -1; // Memory allocation failure
+    }
+
+    SharedEventJson* shared = ev->shared;
+    shared->refs = 1;
+    strncpy(shared->group_uuid, group_uuid, UUID4_LEN);
+    shared->group_uuid[UUID4_LEN - 1] = '\0';
+    strncpy(shared->uuid, uuid, UUID4_LEN);
+    shared->uuid[UUID4_LEN - 1] = '\0';
+    strncpy(shared->sender_uuid, sender_uuid, UUID4_LEN);
+    shared->sender_uuid[UUID4_LEN - 1] = '\0';
+    shared->created_at = created_at;
+    shared->json_len = json_len;
+    memcpy(shared->json, json, json_len + 1);
+    shared->data = shared->json + json_len + 1;
+    memcpy(shared->data, data, data_len + 1);
+    free(json);
+
+    return 0; // Success
+}
+
 int copy_event_new_message(EventNewMessage* ev1, EventNewMessage** ev2)
 {
     if (ev1 == NULL) {
         return -1; // Error: Invalid input
     }
 
-    // Allocate memory for the new event
-    *ev2 = (EventNewMessage*)malloc(sizeof(EventNewMessage));
+    // messages array, their data and json fragments go into
+    // the same block as event, so a copy is one malloc and one free
+    size_t size = sizeof(EventNewMessage) + ev1->msgs_len * sizeof(MsgWithMetaInfo);
+    for (size_t i = 0; i < ev1->msgs_len; i++) {
+        MsgWithMetaInfo* src = &ev1->msgs[i];
+        size += (src->data ? strlen(src->data) + 1 : 0) + (src->json ? src->json_len + 1 : 0);
+    }
+
+    *ev2 = (EventNewMessage*)malloc(size);
     if (*ev2 == NULL) {
         return -1; // Error: Memory allocation failed
     }
 
-    // Copy the base event type
     (*ev2)->base.event_type = ev1->base.event_type;
-
-    // Copy the number of messages
     (*ev2)->msgs_len = ev1->msgs_len;
-
-    // Allocate memory for the messages array
-    if (ev1->msgs_len > 0) {
-        (*ev2)->msgs = (MsgWithMetaInfo*)malloc(ev1->msgs_len * sizeof(MsgWithMetaInfo));
-        if ((*ev2)->msgs == NULL) {
-            free(*ev2);
-            *ev2 = NULL;
-            return -1; // Error: Memory allocation failed
+    (*ev2)->msgs = ev1->msgs_len ? (MsgWithMetaInfo*)(*ev2 + 1) : NULL;
+
+    char* payload = (char*)(*ev2 + 1) + ev1->msgs_len * sizeof(MsgWithMetaInfo);
+    for (size_t i = 0; i < ev1->msgs_len; i++) {
+        MsgWithMetaInfo* src = &ev1->msgs[i];
+        MsgWithMetaInfo* dst = &(*ev2)->msgs[i];
+        *dst = *src;
+        if (src->data) {
+            size_t data_len = strlen(src->data);
+            dst->data = memcpy(payload, src->data, data_len + 1);
+            payload += data_len + 1;
         }
-
-        // Copy each message
-        for (size_t i = 0; i < ev1->msgs_len; i++) {
-            // Copy the UUID
-            strncpy((*ev2)->msgs[i].uuid, ev1->msgs[i].uuid, UUID4_LEN);
-
-            // Copy the data string
-            if (ev1->msgs[i].data != NULL) {
-                (*ev2)->msgs[i].data = strdup(ev1->msgs[i].data);
-                if ((*ev2)->msgs[i].data == NULL) {
-                    // Cleanup and return on error
-                    for (size_t j = 0; j < i; j++) {
-                        free((*ev2)->msgs[j].data);
-                    }
-                    free((*ev2)->msgs);
-                    free(*ev2);
-                    *ev2 = NULL;
-                    return -1; // Error: Memory allocation failed
-                }
-            } else {
-                (*ev2)->msgs[i].data = NULL;
-            }
-
-            // Copy the creation date
-            (*ev2)->msgs[i].creation_date = ev1->msgs[i].creation_date;
+        if (src->json) {
+            dst->json = memcpy(payload, src->json, src->json_len + 1);
+            payload += src->json_len + 1;
         }
-    } else {
-        (*ev2)->msgs = NULL;
     }
 
     return 0; // Success
 }
 
+int copy_event_message_edited(EventMessageEdited* ev1, EventMessageEdited** ev2)
+{
+    if (ev1 == NULL || ev1->data == NULL) {
+        return -1; // Error: Invalid input
+    }
+
+    // data is kept right after event in the same block
+    size_t data_len = strlen(ev1->data);
+    *ev2 = (EventMessageEdited*)malloc(sizeof(EventMessageEdited) + data_len + 1);
+    if (*ev2 == NULL) {
+        return -1; // Error: Memory allocation failed
+    }
+
+    **ev2 = *ev1;
+    (*ev2)->data = memcpy(*ev2 + 1, ev1->data, data_len + 1);
+
+    return 0; // Success
+}
+
+int copy_event_read_receipt(EventReadReceipt* ev1, EventReadReceipt** ev2)
+{
+    if (ev1 == NULL) {
+        return -1; // Error: Invalid input
+    }
+
+    *ev2 = (EventReadReceipt*)malloc(sizeof(EventReadReceipt));
+    if (*ev2 == NULL) {
+        return -1; // Error: Memory allocation failed
+    }
+
+    **ev2 = *ev1;
+
+    return 0; // Success
+}
+
+int copy_event_typing(EventTyping* ev1, EventTyping** ev2)
+{
+    if (ev1 == NULL) {
+        return -1; // Error: Invalid input
+    }
+
+    *ev2 = (EventTyping*)malloc(sizeof(EventTyping));
+    if (*ev2 == NULL) {
+        return -1; // Error: Memory allocation failed
+    }
+
+    **ev2 = *ev1;
+
+    return 0; // Success
+}
+
+int copy_event_group_message(EventGroupMessage* ev1, EventGroupMessage** ev2)
+{
+    if (ev1 == NULL) {
+        return -1; // Error: Invalid input
+    }
+
+    *ev2 = (EventGroupMessage*)malloc(sizeof(EventGroupMessage));
+    if (*ev2 == NULL) {
+        return -1; // Error: Memory allocation failed
+    }
+
+    // copies are freed by subscriber threads, so refs are atomic
+    __atomic_add_fetch(&ev1->shared->refs, 1, __ATOMIC_RELAXED);
+    **ev2 = *ev1;
+
+    return 0; // Success
+}
+
 int copy_event_base(EventBase* ev1, EventBase** ev2)
 {
     if (ev1 == NULL)
@@ -128,76 +398,181 @@ int copy_event_base(EventBase* ev1, EventBase** ev2)
     switch (ev1->event_type) {
     case NewMessageEventType:
         return copy_event_new_message((EventNewMessage*)ev1, (EventNewMessage**)ev2);
+    case MessageEditedEventType:
+        return copy_event_message_edited((EventMessageEdited*)ev1, (EventMessageEdited**)ev2);
+    case ReadReceiptEventType:
+        return copy_event_read_receipt((EventReadReceipt*)ev1, (EventReadReceipt**)ev2);
+    case TypingEventType:
+        return copy_event_typing((EventTyping*)ev1, (EventTyping**)ev2);
+    case GroupMessageEventType:
+        return copy_event_group_message((EventGroupMessage*)ev1, (EventGroupMessage**)ev2);
     default:
         return -1;
     }
 }
 
-char* convert_event_new_message_to_json(EventNewMessage* ev)
+char* convert_event_new_message_to_json(EventNewMessage* ev, size_t* len)
 {
     if (!ev) {
         return NULL; // Return error if input is invalid
     }
 
-    char* json = NULL;
-    char* temp = NULL;
+    // fragments are ready, so buffer is sized exactly
+    // once and messages are only concatenated into it
+    size_t json_len = 64 + ev->msgs_len;
+    for (size_t i = 0; i < ev->msgs_len; ++i) {
+        json_len += ev->msgs[i].json_len;
+    }
 
-    // Start the JSON string
-    json = xsprintf("{\"event_type\":%d,\"msgs\":[",
-        ev->base.event_type);
+    JsonWriter w;
+    json_writer_init(&w, json_len);
+    json_writer_begin_object(&w);
+    json_writer_key(&w, "event_type");
+    json_writer_int(&w, ev->base.event_type);
+    json_writer_key(&w, "msgs");
+    json_writer_begin_array(&w);
+    for (size_t i = 0; i < ev->msgs_len; ++i) {
+        json_writer_raw(&w, ev->msgs[i].json, ev->msgs[i].json_len);
+    }
+    json_writer_end_array(&w);
+    json_writer_end_object(&w);
 
-    if (!json) {
-        return NULL; // Memory allocation or formatting failed
+    return json_writer_finish(&w, len); // NULL if memory allocation failed
+}
+
+char* convert_event_message_edited_to_json(EventMessageEdited* ev, size_t* len)
+{
+    if (!ev) {
+        return NULL; // Return error if input is invalid
     }
 
-    // Loop through the messages and append their JSON representation
-    for (size_t i = 0; i < ev->msgs_len; ++i) {
-        MsgWithMetaInfo* msg = &ev->msgs[i];
-
-        // Format the message as JSON
-        temp = xsprintf("{\"uuid\":\"%s\",\"data\":\"%s\",\"creation_date\":%ld}",
-            msg->uuid,
-            msg->data ? msg->data : "",
-            msg->creation_date);
-        if (!temp) {
-            free(json); // Cleanup on failure
-            return NULL;
-        }
+    JsonWriter w;
+    json_writer_init(&w, 128);
+    write_event_message_edited(&w, ev);
 
-        // Append the formatted message to the JSON string
-        char* new_json = xsprintf("%s%s%s", json, (i > 0 ? "," : ""), temp);
-        free(temp); // Free temp buffer after appending
-        free(json); // Free old json before assigning the new one
+    return json_writer_finish(&w, len); // NULL if memory allocation failed
+}
 
-        if (!new_json) {
-            return NULL; // Memory allocation failed
-        }
+char* convert_event_read_receipt_to_json(EventReadReceipt* ev, size_t* len)
+{
+    if (!ev) {
+        return NULL; // Return error if input is invalid
+    }
 
-        json = new_json;
+    char* json = xsprintf("{\"event_type\":%d,\"reader_uuid\":\"%s\",\"message_uuid\":\"%s\",\"read_at\":%ld}",
+        ev->base.event_type,
+        ev->reader_uuid,
+        ev->message_uuid,
+        ev->read_at);
+    if (json && len) {
+        *len = strlen(json);
     }
 
-    // Close the JSON array and object
-    temp = xsprintf("%s]}", json);
-    free(json); // Free the old json buffer
+    return json;
+}
+
+char* convert_event_typing_to_json(EventTyping* ev, size_t* len)
+{
+    if (!ev) {
+        return NULL; // Return error if input is invalid
+    }
+
+    char* json = xsprintf("{\"event_type\":%d,\"sender_uuid\":\"%s\",\"typing_at\":%ld}",
+        ev->base.event_type,
+        ev->sender_uuid,
+        ev->typing_at);
+    if (json && len) {
+        *len = strlen(json);
+    }
+
+    return json;
+}
+
+char* convert_event_group_message_to_json(EventGroupMessage* ev, size_t* len)
+{
+    if (!ev) {
+        return NULL; // Return error if input is invalid
+    }
 
-    if (!temp) {
+    char* json = malloc(ev->shared->json_len + 1);
+    if (!json) {
         return NULL; // Memory allocation failed
     }
+    memcpy(json, ev->shared->json, ev->shared->json_len + 1);
+    if (len) {
+        *len = ev->shared->json_len;
+    }
 
-    return temp; // Return the complete JSON string
+    return json;
 }
 
-char* convert_event_base_to_json(EventBase* ev)
+char* convert_event_base_to_json(EventBase* ev, size_t* len)
 {
     if (ev == NULL)
         return NULL;
 
     switch (ev->event_type) {
     case NewMessageEventType:
-        return convert_event_new_message_to_json((EventNewMessage*)ev);
+        return convert_event_new_message_to_json((EventNewMessage*)ev, len);
+    case MessageEditedEventType:
+        return convert_event_message_edited_to_json((EventMessageEdited*)ev, len);
+    case ReadReceiptEventType:
+        return convert_event_read_receipt_to_json((EventReadReceipt*)ev, len);
+    case TypingEventType:
+        return convert_event_typing_to_json((EventTyping*)ev, len);
+    case GroupMessageEventType:
+        return convert_event_group_message_to_json((EventGroupMessage*)ev, len);
+    default:
+        return NULL;
+    }
+}
+
+char* encode_event_base(EventBase* ev, WireFormat format, size_t* len)
+{
+    // json has its own converters using fragments serialized ahead
+    if (format == WireFormatJson) {
+        return convert_event_base_to_json(ev, len);
+    }
+    if (ev == NULL || ev->event_type < 0 || ev->event_type > GroupMessageEventType) {
+        return NULL;
+    }
+
+    // sse carries event name in its own line, binary
+    // frames keep it next to payload instead
+    JsonWriter w;
+    json_writer_init_format(&w, 128, format);
+    json_writer_begin_object(&w);
+    json_writer_key(&w, "type");
+    json_writer_string(&w, event_type_strs[ev->event_type]);
+    json_writer_key(&w, "data");
+
+    switch (ev->event_type) {
+    case NewMessageEventType:
+        write_event_new_message(&w, (EventNewMessage*)ev);
+        break;
+    case MessageEditedEventType:
+        write_event_message_edited(&w, (EventMessageEdited*)ev);
+        break;
+    case ReadReceiptEventType:
+        write_event_read_receipt(&w, (EventReadReceipt*)ev);
+        break;
+    case TypingEventType:
+        write_event_typing(&w, (EventTyping*)ev);
+        break;
+    case GroupMessageEventType: {
+        SharedEventJson* shared = ((EventGroupMessage*)ev)->shared;
+        write_event_group_message(
+            &w, shared->group_uuid, shared->uuid, shared->sender_uuid,
+            shared->data, shared->created_at);
+        break;
+    }
     default:
+        json_writer_free(&w);
         return NULL;
     }
+    json_writer_end_object(&w);
+
+    return json_writer_finish(&w, len); // NULL if memory allocation failed
 }
 
 // Function to free EventNewMessage structure
@@ -212,21 +587,29 @@ void free_event_new_message(EventNewMessage* ev)
     }
 }
 
+void free_event_message_edited(EventMessageEdited* ev)
+{
+    if (ev) {
+        free(ev->data);
+    }
+}
+
+void free_event_group_message(EventGroupMessage* ev)
+{
+    if (ev && __atomic_sub_fetch(&ev->shared->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(ev->shared);
+    }
+}
+
 void free_event_base(EventBase* ev)
 {
     if (ev == NULL)
         return; // Check for null pointer
 
-    switch (ev->event_type) {
-    case NewMessageEventType:
-        // Cast to the specific event type (EventNewMessage) and call the appropriate free function
-        free_event_new_message((EventNewMessage*)ev);
-        break;
-
-    // Add cases for other event types as needed in the future
-    default:
-        // Handle unknown event types, if necessary
-        free(ev);
-        break;
+    // copies keep their payload in the same block, only
+    // group messages hold a reference to memory outside it
+    if (ev->event_type == GroupMessageEventType) {
+        free_event_group_message((EventGroupMessage*)ev);
     }
+    free(ev);
 }
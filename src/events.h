@@ -1,11 +1,16 @@
 #ifndef EVENTS_H
 #define EVENTS_H
 
+#include "json_writer.h"
 #include "uuid4.h"
 #include <time.h>
 
 enum {
-    NewMessageEventType
+    NewMessageEventType,
+    MessageEditedEventType,
+    ReadReceiptEventType,
+    TypingEventType,
+    GroupMessageEventType
 };
 
 extern const char* event_type_strs[];
@@ -18,6 +23,10 @@ typedef struct {
     char uuid[UUID4_LEN];
     char* data;
     time_t creation_date;
+    // {"uuid":..} fragment serialized once at creation,
+    // events holding many messages are assembled from these
+    char* json;
+    size_t json_len;
 } MsgWithMetaInfo;
 
 int create_msg_with_meta_info(MsgWithMetaInfo* msg, char* uuid, char* data, time_t creation_date);
@@ -30,15 +39,87 @@ typedef struct {
 } EventNewMessage;
 
 int create_event_new_message(EventNewMessage* ev, MsgWithMetaInfo* msg);
+// takes ownership of msgs array
+int create_event_new_messages(EventNewMessage* ev, MsgWithMetaInfo* msgs, size_t msgs_len);
 
+// delta of edited message, clients patch it in place
+typedef struct {
+    EventBase base;
+    char uuid[UUID4_LEN];
+    char* data;
+    time_t updated_at;
+} EventMessageEdited;
+
+int create_event_message_edited(EventMessageEdited* ev, const char* uuid, const char* data, time_t updated_at);
+
+// tells sender that reader has read messages up to message_uuid
+typedef struct {
+    EventBase base;
+    char reader_uuid[UUID4_LEN];
+    char message_uuid[UUID4_LEN];
+    time_t read_at;
+} EventReadReceipt;
+
+int create_event_read_receipt(EventReadReceipt* ev, const char* reader_uuid, const char* message_uuid, time_t read_at);
+
+// ephemeral, never stored: sender is typing to receiver right now
+typedef struct {
+    EventBase base;
+    char sender_uuid[UUID4_LEN];
+    time_t typing_at;
+} EventTyping;
+
+int create_event_typing(EventTyping* ev, const char* sender_uuid, time_t typing_at);
+
+// json of event serialized once and shared by every queue it
+// is fanned out to, freed when last copy of event is freed;
+// fields are kept too for subscribers of binary formats
+typedef struct {
+    int refs;
+    char group_uuid[UUID4_LEN];
+    char uuid[UUID4_LEN];
+    char sender_uuid[UUID4_LEN];
+    time_t created_at;
+    char* data; // points into the same block, after json
+    size_t json_len;
+    char json[];
+} SharedEventJson;
+
+typedef struct {
+    EventBase base;
+    SharedEventJson* shared;
+} EventGroupMessage;
+
+int create_event_group_message(
+    EventGroupMessage* ev, const char* group_uuid, const char* uuid,
+    const char* sender_uuid, const char* data, time_t created_at);
+
+// copies are single blocks with their payload, one per subscriber
 int copy_event_new_message(EventNewMessage* ev1, EventNewMessage** ev2);
+int copy_event_message_edited(EventMessageEdited* ev1, EventMessageEdited** ev2);
+int copy_event_read_receipt(EventReadReceipt* ev1, EventReadReceipt** ev2);
+int copy_event_typing(EventTyping* ev1, EventTyping** ev2);
+// copies share json with ev1
+int copy_event_group_message(EventGroupMessage* ev1, EventGroupMessage** ev2);
 int copy_event_base(EventBase* ev1, EventBase** ev2);
 
-char* convert_event_new_message_to_json(EventNewMessage* ev);
+char* convert_event_new_message_to_json(EventNewMessage* ev, size_t* len);
+char* convert_event_message_edited_to_json(EventMessageEdited* ev, size_t* len);
+char* convert_event_read_receipt_to_json(EventReadReceipt* ev, size_t* len);
+char* convert_event_typing_to_json(EventTyping* ev, size_t* len);
+char* convert_event_group_message_to_json(EventGroupMessage* ev, size_t* len);
 
-char* convert_event_base_to_json(EventBase* ev);
+// len, when not NULL, receives length of returned json
+char* convert_event_base_to_json(EventBase* ev, size_t* len);
+// event in any wire format, json goes through converters above
+char* encode_event_base(EventBase* ev, WireFormat format, size_t* len);
 
 void free_event_new_message(EventNewMessage* ev);
+void free_event_message_edited(EventMessageEdited* ev);
+// drops reference to shared json
+void free_event_group_message(EventGroupMessage* ev);
+// frees event made by copy_event_base, events built by create_event_*
+// are freed by free_event_<type> and their owner instead
 void free_event_base(EventBase* ev);
 
 #endif
@@ -1,35 +1,15 @@
 #include "get_contacts.h"
 #include "db.h"
+#include "json_writer.h"
+#include "json_reader.h"
 #include "log.h"
-#include "yyjson.h"
+#include <stdio.h>
 #include <stdlib.h>
 
-int parse_json_to_get_contacts_input(size_t json_len, char json[json_len], GetContactsInput* model) {
-    if (!json || !model) {
-        return -1; // Error: Invalid input
-    }
-
-    yyjson_doc* doc = yyjson_read(json, json_len, 0);
-    if (!doc) {
-        return -2; // Error: Failed to parse JSON
-    }
+#define GET_CONTACTS_INPUT_FIELDS(FIELD) \
+    FIELD(GetContactsInput, session_key, string)
 
-    yyjson_val* root = yyjson_doc_get_root(doc);
-    yyjson_val* session_key_val = yyjson_obj_get(root, "session_key");
-    if (!yyjson_is_str(session_key_val)) {
-        yyjson_doc_free(doc);
-        return -3; // Error: Missing or invalid session_key
-    }
-
-    model->session_key = strdup(yyjson_get_str(session_key_val));
-    yyjson_doc_free(doc);
-
-    if (!model->session_key) {
-        return -4; // Error: Memory allocation failed
-    }
-
-    return 0; // Success
-}
+JSON_DECODER(parse_json_to_get_contacts_input, GetContactsInput, GET_CONTACTS_INPUT_FIELDS)
 
 int get_contacts_route(HttpRequest* req, HttpResponse* res) {
     LogInfo("get_contacts_route executed");
@@ -37,7 +17,7 @@ int get_contacts_route(HttpRequest* req, HttpResponse* res) {
     // Parse the session_key from the request body
     GetContactsInput input;
     if (parse_json_to_get_contacts_input(req->body_len, req->body, &input) != 0) {
-        create_http_response(res, "400", NULL, 0, "Invalid request: missing or invalid session_key");
+        create_http_response_static_body(res, "400", NULL, 0, HTTP_LITERAL_BODY("Invalid request: missing or invalid session_key"));
         LogErr("Failed to parse JSON body");
         return 0;
     }
@@ -46,48 +26,47 @@ int get_contacts_route(HttpRequest* req, HttpResponse* res) {
     SenderUuidAndNickname* senders = NULL;
     size_t senders_len = 0;
     if (get_all_senders_uuid_and_nicknames_by_user_id_from_session_key(input.session_key, &senders, &senders_len) != 0) {
-        create_http_response(res, "404", NULL, 0, "Session not found or database error");
+        create_http_response_static_body(res, "404", NULL, 0, HTTP_LITERAL_BODY("Session not found or database error"));
         LogWarn("Failed to retrieve senders for session key: %s", input.session_key);
-        free(input.session_key);
         return 0;
     }
 
-    free(input.session_key);
-
-    // Serialize the response JSON
-    size_t buffer_size = 3; // Initial size for "[" and "]" and "\0"
+    // Serialize the response in negotiated format
+    WireFormat format = wire_format_from_accept(http_request_get_header(req, "Accept"));
+    JsonWriter w;
+    json_writer_init_format(&w, 64 + senders_len * 128, format);
+    json_writer_begin_array(&w);
     for (size_t i = 0; i < senders_len; ++i) {
-        buffer_size += strlen(senders[i].uuid) + strlen(senders[i].nickname) + 40; // UUID, nickname, quotes, braces, and commas
-    }
+        json_writer_begin_object(&w);
+        json_writer_key(&w, "uuid");
+        json_writer_string(&w, senders[i].uuid);
+        json_writer_key(&w, "nickname");
+        json_writer_string(&w, senders[i].nickname);
+        json_writer_key(&w, "last_message_at");
+        json_writer_int(&w, senders[i].last_message_at);
+        json_writer_key(&w, "unread_count");
+        json_writer_int(&w, senders[i].unread_count);
+        json_writer_end_object(&w);
 
-    char* json_response = malloc(buffer_size);
-    if (!json_response) {
-        create_http_response(res, "500", NULL, 0, "Internal server error");
-        LogErr("Failed to allocate memory for JSON response");
-        for (size_t i = 0; i < senders_len; ++i) {
-            free(senders[i].uuid);
-            free(senders[i].nickname);
-        }
-        free(senders);
-        return 0;
-    }
-
-    char* cursor = json_response;
-    cursor += sprintf(cursor, "[");
-    for (size_t i = 0; i < senders_len; ++i) {
-        cursor += sprintf(cursor, "{\"uuid\":\"%s\",\"nickname\":\"%s\"}%s",
-                          senders[i].uuid, senders[i].nickname, i < senders_len - 1 ? "," : "");
         free(senders[i].uuid);
         free(senders[i].nickname);
     }
-    cursor[0] = ']';
-    cursor[1] = '\0';
+    json_writer_end_array(&w);
 
     free(senders);
 
+    size_t json_len = 0;
+    char* json_response = json_writer_finish(&w, &json_len);
+    if (!json_response) {
+        create_http_response_static_body(res, "500", NULL, 0, HTTP_LITERAL_BODY("Internal server error"));
+        LogErr("Failed to allocate memory for JSON response");
+        return 0;
+    }
+
     // Create the HTTP response
-    create_http_response(res, "200", NULL, 0, json_response);
-    free(json_response);
+    create_http_response_adopt_body(
+        res, "200", (const char*[]) { wire_format_content_type_header(format), WIRE_FORMAT_VARY_HEADER }, 2,
+        json_response, json_len);
 
     LogInfo("Successfully retrieved and serialized contacts");
     return 0;
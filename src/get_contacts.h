@@ -3,10 +3,13 @@
 
 #include "http.h"
 
+// fields point into json parsed by parse_json_to_get_contacts_input,
+// valid as long as it is and never freed
 typedef struct {
     char* session_key;
 } GetContactsInput;
 
+// parses json in place, see json_read_insitu
 int parse_json_to_get_contacts_input(size_t json_len, char json[json_len], GetContactsInput* model);
 int get_contacts_route(HttpRequest* req, HttpResponse* res);
 
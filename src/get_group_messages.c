@@ -0,0 +1,91 @@
+#include "get_group_messages.h"
+#include "db.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "log.h"
+#include <stdlib.h>
+
+#define GET_GROUP_MESSAGES_INPUT_FIELDS(FIELD) \
+    FIELD(GetGroupMessagesInput, session_key, string) \
+    FIELD(GetGroupMessagesInput, group_uuid, string) \
+    FIELD(GetGroupMessagesInput, offset, int) \
+    FIELD(GetGroupMessagesInput, limit, int)
+
+JSON_DECODER(parse_json_to_get_group_messages_input, GetGroupMessagesInput, GET_GROUP_MESSAGES_INPUT_FIELDS)
+
+int get_group_messages_route(HttpRequest* req, HttpResponse* res)
+{
+    LogInfo("get_group_messages_route executed");
+
+    GetGroupMessagesInput input;
+    if (parse_json_to_get_group_messages_input(req->body_len, req->body, &input)) {
+        LogErr("Incorrect Json on Input: %zu bytes", req->body_len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    if (input.offset < 0 || input.limit <= 0 || input.limit > GROUP_MESSAGES_MAX_LIMIT) {
+        LogErr("Group messages page out of range: offset = %d; limit = %d", input.offset, input.limit);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    int user_id;
+    if (get_user_id_by_session_key(input.session_key, &user_id)) {
+        LogErr("Cant find such session key in db: session_key = '%s'", input.session_key);
+        create_http_response(res, "403", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    // membership check, member list itself is not needed here
+    int group_id;
+    int* member_ids;
+    size_t member_ids_len;
+    if (get_group_members_by_uuid(input.group_uuid, user_id, &group_id, &member_ids, &member_ids_len)) {
+        LogErr("Cant find such group of user: group_uuid = '%s'", input.group_uuid);
+        create_http_response(res, "404", NULL, 0, NULL, 0);
+        return 0;
+    }
+    free(member_ids);
+
+    GroupMessageWithSender* msgs;
+    size_t msgs_len;
+    if (get_group_messages_from_db(group_id, input.offset, input.limit, &msgs, &msgs_len)) {
+        LogErr("Cant get group messages from db");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    JsonWriter w;
+    json_writer_init(&w, 64 + msgs_len * 160);
+    json_writer_begin_array(&w);
+    for (size_t i = 0; i < msgs_len; i++) {
+        json_writer_begin_object(&w);
+        json_writer_key(&w, "uuid");
+        json_writer_string(&w, msgs[i].uuid);
+        json_writer_key(&w, "sender_uuid");
+        json_writer_string(&w, msgs[i].sender_uuid);
+        json_writer_key(&w, "data");
+        json_writer_string(&w, msgs[i].data);
+        json_writer_key(&w, "created_at");
+        json_writer_int(&w, msgs[i].created_at);
+        json_writer_key(&w, "updated_at");
+        json_writer_int(&w, msgs[i].updated_at);
+        json_writer_end_object(&w);
+    }
+    json_writer_end_array(&w);
+
+    free_group_messages(msgs, msgs_len);
+
+    size_t json_len = 0;
+    char* json_response = json_writer_finish(&w, &json_len);
+    if (!json_response) {
+        LogErr("Cant alloc memory for group messages json");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    create_http_response_adopt_body(res, "200", NULL, 0, json_response, json_len);
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef GET_GROUP_MESSAGES_H
+#define GET_GROUP_MESSAGES_H
+
+#include "http.h"
+
+// upper bound of messages in one /groups/messages page
+#define GROUP_MESSAGES_MAX_LIMIT 1000
+
+// fields point into json parsed by parse_json_to_get_group_messages_input,
+// valid as long as it is and never freed
+typedef struct {
+    char* session_key;
+    char* group_uuid;
+    int offset;
+    int limit;
+} GetGroupMessagesInput;
+
+// parses json in place, see json_read_insitu
+int parse_json_to_get_group_messages_input(size_t json_len, char json[json_len], GetGroupMessagesInput* model);
+
+int get_group_messages_route(HttpRequest* req, HttpResponse* res);
+
+#endif
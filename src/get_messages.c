@@ -1,6 +1,8 @@
 #include "get_messages.h"
+#include "compression.h"
 #include "log.h"
 #include "db.h"
+#include "json_writer.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -81,85 +83,161 @@ int parse_url_params_to_get_messages_input(const char* path, GetMessagesInput* m
     return 0; // Success
 }
 
+typedef struct {
+    int socket;
+    HttpResponse* res;
+    JsonWriter w;
+    int streaming;
+    ContentEncoding encoding;
+    CompressStream cs;
+} MessagesPageWriter;
+
+static int write_messages_page_chunk(const char* data, size_t len, void* ctx)
+{
+    MessagesPageWriter* pw = ctx;
+    if (http_write_chunk_to_socket(pw->socket, data, len)) {
+        LogErr("Failed to write messages chunk to socket");
+        return -1;
+    }
+    return 0;
+}
+
+// first flush commits to a chunked 200, status can't change after it
+static int flush_messages_page_chunk(MessagesPageWriter* pw)
+{
+    if (pw->w.failed) {
+        return -1;
+    }
+
+    if (!pw->streaming) {
+        pw->streaming = 1;
+        int compressed = pw->encoding != ContentEncodingIdentity;
+        create_http_response(
+            pw->res, "200",
+            (const char*[]) {
+                "Transfer-Encoding: chunked",
+                wire_format_content_type_header(pw->w.format),
+                WIRE_FORMAT_VARY_HEADER,
+                "Vary: Accept-Encoding",
+                content_encoding_header(pw->encoding),
+            },
+            compressed ? 5 : 3, NULL, 0);
+        if (http_response_add_cors_headers(pw->res)
+            || http_response_write_head_to_socket(pw->socket, pw->res)) {
+            LogErr("Failed to write chunked response head to socket");
+            return -1;
+        }
+        if (compressed && compress_stream_begin(&pw->cs, pw->encoding, write_messages_page_chunk, pw)) {
+            LogErr("Failed to start messages page compression");
+            return -1;
+        }
+    }
+
+    int rc = pw->encoding != ContentEncodingIdentity
+        ? compress_stream_write(&pw->cs, pw->w.buf, pw->w.len)
+        : write_messages_page_chunk(pw->w.buf, pw->w.len, pw);
+    if (rc) {
+        return -1;
+    }
+
+    json_writer_drain(&pw->w);
+    return 0;
+}
+
+static int write_message_row(const char* data, time_t created_at, time_t updated_at, void* ctx)
+{
+    MessagesPageWriter* pw = ctx;
+
+    json_writer_begin_object(&pw->w);
+    json_writer_key(&pw->w, "data");
+    json_writer_string(&pw->w, data);
+    json_writer_key(&pw->w, "created_at");
+    json_writer_int(&pw->w, created_at);
+    json_writer_key(&pw->w, "updated_at");
+    json_writer_int(&pw->w, updated_at);
+    json_writer_end_object(&pw->w);
+
+    if (pw->w.len < GET_MESSAGES_CHUNK_SIZE) {
+        return pw->w.failed ? -1 : 0;
+    }
+    return flush_messages_page_chunk(pw);
+}
+
 int get_messages_route(HttpRequest* req, HttpResponse* res) {
     GetMessagesInput input = {0};
-    if (parse_url_params_to_get_messages_input(req->path, &input)) { 
-        LogErr("Incorrect Url params on Input: URL = '%s'", req->path);
-        create_http_response(res, "400", NULL, 0, NULL);
-        return 0;
-    }
+    MessagesPageWriter pw = {
+        .socket = req->socket,
+        .res = res,
+        .encoding = content_encoding_from_accept(http_request_get_header(req, "Accept-Encoding")),
+    };
+    char* json_response = NULL;
+    size_t json_len = 0;
+    WireFormat format = wire_format_from_accept(http_request_get_header(req, "Accept"));
+    // msgpack has no open ended arrays, so its page is a sequence
+    // of message maps instead of an array whose count comes last
+    int sequence = format == WireFormatMsgPack;
 
-    // Parse the URL parameters
     if (parse_url_params_to_get_messages_input(req->path, &input)) {
         LogErr("Incorrect URL params on Input: URL = '%s'", req->path);
-        create_http_response(res, "400", NULL, 0, NULL);
-        return 0;
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        goto cleanup;
     }
 
     // Validate essential parameters
     if (!input.session_key || !input.user_uuid || input.limit <= 0 || input.offset < 0) {
         LogErr("Invalid input parameters: session_key = '%s', user_uuid = '%s', limit = %d, offset = %d",
                input.session_key, input.user_uuid, input.limit, input.offset);
-        create_http_response(res, "400", NULL, 0, NULL);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
         goto cleanup;
     }
 
-    // Retrieve messages from the database
-    MessageWithTimeAndData* msgs = NULL;
-    size_t msgs_len = 0;
-    if (get_messages_by_reciever_user_id_from_session_key_and_sender_user_uuid(
-            input.session_key, input.user_uuid, input.offset, input.limit, &msgs, &msgs_len) != EXIT_SUCCESS) {
+    // rows are serialized as sqlite steps over them, memory
+    // stays at one chunk of json whatever the limit is
+    json_writer_init_format(&pw.w, GET_MESSAGES_CHUNK_SIZE + 1024, format);
+    if (!sequence) {
+        json_writer_begin_array(&pw.w);
+    }
+
+    if (for_each_message_by_reciever_user_id_from_session_key_and_sender_user_uuid(
+            input.session_key, input.user_uuid, input.offset, input.limit,
+            write_message_row, &pw) != EXIT_SUCCESS) {
         LogErr("Failed to retrieve messages from database.");
-        create_http_response(res, "500", NULL, 0, NULL);
+        if (pw.streaming) {
+            // status is already sent, dropping connection without
+            // last chunk lets client see body as truncated
+            res->streamed = 1;
+        } else {
+            create_http_response(res, "500", NULL, 0, NULL, 0);
+        }
+        json_writer_free(&pw.w);
         goto cleanup;
     }
 
-    // Calculate the total size for the JSON response
-    size_t json_size = 2; // For the opening and closing brackets of the JSON array
-    for (size_t i = 0; i < msgs_len; i++) {
-        json_size += snprintf(NULL, 0, 
-            "{\"data\":\"%s\",\"created_at\":%ld,\"updated_at\":%ld},",
-            msgs[i].data, (long)msgs[i].created_at, (long)msgs[i].updated_at);
+    if (!sequence) {
+        json_writer_end_array(&pw.w);
     }
 
-    if (msgs_len > 0) {
-        json_size -= 1; // Remove the trailing comma
+    if (pw.streaming) {
+        res->streamed = 1;
+        if (flush_messages_page_chunk(&pw) == 0
+            && (pw.encoding == ContentEncodingIdentity || compress_stream_finish(&pw.cs) == 0)) {
+            http_write_last_chunk_to_socket(req->socket);
+        }
+        json_writer_free(&pw.w);
+        goto cleanup;
     }
 
-    char* json_response = malloc(json_size + 1);
+    json_response = json_writer_finish(&pw.w, &json_len);
     if (!json_response) {
         LogErr("Memory allocation for JSON response failed.");
-        create_http_response(res, "500", NULL, 0, NULL);
-        goto cleanup_msgs;
-    }
-
-    // Build the JSON response
-    char* ptr = json_response;
-    *ptr++ = '['; // Opening bracket
-    for (size_t i = 0; i < msgs_len; i++) {
-        int written = snprintf(ptr, json_size - (ptr - json_response),
-            "{\"data\":\"%s\",\"created_at\":%ld,\"updated_at\":%ld},",
-            msgs[i].data, (long)msgs[i].created_at, (long)msgs[i].updated_at);
-        ptr += written;
-    }
-
-    if (msgs_len > 0) {
-        ptr--; // Remove the trailing comma
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        goto cleanup;
     }
-    *ptr++ = ']'; // Closing bracket
-    *ptr = '\0'; // Null-terminate the string
 
-    // Send JSON response
-    create_http_response(res, "200", NULL, 0, json_response);
-
-    free(json_response);
-
-cleanup_msgs:
-    // Free messages array and its contents
-    for (size_t i = 0; i < msgs_len; i++) {
-        free(msgs[i].data);
-    }
-    free(msgs);
+    // Send response in negotiated format
+    create_http_response_adopt_body(
+        res, "200", (const char*[]) { wire_format_content_type_header(format), WIRE_FORMAT_VARY_HEADER }, 2,
+        json_response, json_len);
 
 cleanup:
     // Free input fields
@@ -167,4 +245,4 @@ cleanup:
     free(input.user_uuid);
 
     return 0;
-} 
+}
@@ -5,6 +5,10 @@
 
 #define MAX_PARAM_LENGTH 256
 
+// pages whose json outgrows one chunk are sent with
+// Transfer-Encoding: chunked, smaller ones as a plain body
+#define GET_MESSAGES_CHUNK_SIZE 16384
+
 typedef struct{
   char* user_uuid;
   char* session_key;
@@ -0,0 +1,105 @@
+#include "get_presence.h"
+#include "db.h"
+#include "event_bus.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "log.h"
+#include "uuid4.h"
+#include <stdlib.h>
+#include <string.h>
+
+void free_get_presence_input(GetPresenceInput* self)
+{
+    if (!self)
+        return;
+    json_free_string_array(&self->uuids);
+}
+
+#define GET_PRESENCE_INPUT_FIELDS(FIELD) \
+    FIELD(GetPresenceInput, session_key, string) \
+    FIELD(GetPresenceInput, uuids, string_array)
+
+JSON_DECODER(parse_json_to_get_presence_input, GetPresenceInput, GET_PRESENCE_INPUT_FIELDS)
+
+// {"<uuid>":true,...} in request order
+static char* build_presence_json(char** uuids, const int* online, size_t uuids_len, WireFormat format, size_t* len)
+{
+    JsonWriter w;
+    json_writer_init_format(&w, 2 + uuids_len * (UUID4_LEN + sizeof("\"\":false,")), format);
+    json_writer_begin_object(&w);
+    for (size_t i = 0; i < uuids_len; i++) {
+        json_writer_key_len(&w, uuids[i], strlen(uuids[i]));
+        json_writer_bool(&w, online[i]);
+    }
+    json_writer_end_object(&w);
+
+    return json_writer_finish(&w, len);
+}
+
+int get_presence_route(HttpRequest* req, HttpResponse* res)
+{
+    LogInfo("get_presence_route executed");
+
+    GetPresenceInput input = { 0 };
+    if (parse_json_to_get_presence_input(req->body_len, req->body, &input)) {
+        LogErr("Incorrect Json on Input: %zu bytes", req->body_len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        free_get_presence_input(&input);
+        return 0;
+    }
+
+    if (input.uuids.len == 0 || input.uuids.len > PRESENCE_MAX_USERS) {
+        LogErr("Presence users count out of range: %zu", input.uuids.len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        free_get_presence_input(&input);
+        return 0;
+    }
+
+    int user_id;
+    if (get_user_id_by_session_key(input.session_key, &user_id)) {
+        LogErr("Cant find such session key in db: session_key = '%s'", input.session_key);
+        create_http_response(res, "403", NULL, 0, NULL, 0);
+        free_get_presence_input(&input);
+        return 0;
+    }
+
+    char* json_response = NULL;
+    size_t json_len = 0;
+    WireFormat format = wire_format_from_accept(http_request_get_header(req, "Accept"));
+    int* user_ids = malloc(input.uuids.len * sizeof(int));
+    int* online = malloc(input.uuids.len * sizeof(int));
+    if (!user_ids || !online) {
+        LogErr("Cant alloc memory for presence");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        goto cleanup;
+    }
+
+    if (get_user_ids_by_uuids((const char**)input.uuids.items, input.uuids.len, user_ids)) {
+        LogErr("Cant find some of user uuids in db");
+        create_http_response(res, "404", NULL, 0, NULL, 0);
+        goto cleanup;
+    }
+
+    // nothing is stored, user is online while it holds an event stream
+    get_users_presence(global_event_bus, user_ids, input.uuids.len, online);
+
+    json_response = build_presence_json(input.uuids.items, online, input.uuids.len, format, &json_len);
+    if (!json_response) {
+        LogErr("Cant alloc memory for presence json");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        goto cleanup;
+    }
+
+    create_http_response_adopt_body(
+        res, "200", (const char*[]) { wire_format_content_type_header(format), WIRE_FORMAT_VARY_HEADER }, 2,
+        json_response, json_len);
+    json_response = NULL; // owned by response now
+
+cleanup:
+    free(json_response);
+    free(user_ids);
+    free(online);
+    free_get_presence_input(&input);
+
+    return 0;
+}
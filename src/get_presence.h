@@ -0,0 +1,24 @@
+#ifndef GET_PRESENCE_H
+#define GET_PRESENCE_H
+
+#include "http.h"
+#include "json_reader.h"
+
+// upper bound of users asked in one /presence request
+#define PRESENCE_MAX_USERS 1000
+
+// strings point into json parsed by parse_json_to_get_presence_input,
+// valid as long as it is
+typedef struct {
+    char* session_key;
+    JsonStringArray uuids;
+} GetPresenceInput;
+
+// frees only uuids array, strings belong to parsed json
+void free_get_presence_input(GetPresenceInput* self);
+// parses json in place, see json_read_insitu
+int parse_json_to_get_presence_input(size_t json_len, char json[json_len], GetPresenceInput* model);
+
+int get_presence_route(HttpRequest* req, HttpResponse* res);
+
+#endif
@@ -3,6 +3,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #define CONTENT_LEN "Content-Length: "
@@ -128,7 +130,7 @@ int http_request_read_from_socket(int socket, HttpRequest* http_request)
     }
     http_request->headers_len = header_count;
 
-    char* body = malloc(body_len);
+    char* body = malloc(body_len + HTTP_REQUEST_BODY_PADDING);
     if (body == NULL) {
         free_headers(http_request->headers, header_count);
         return -1;
@@ -139,6 +141,7 @@ int http_request_read_from_socket(int socket, HttpRequest* http_request)
         free_headers(http_request->headers, header_count);
         return -1;
     }
+    memset(body + body_len, 0, HTTP_REQUEST_BODY_PADDING);
 
     http_request->body_len = body_len;
     http_request->body = body;
@@ -152,6 +155,24 @@ void free_http_request(HttpRequest* http_request)
     free(http_request->body);
 }
 
+const char* http_request_get_header(HttpRequest* http_request, const char* name)
+{
+    size_t name_len = strlen(name);
+    for (size_t i = 0; i < http_request->headers_len; ++i) {
+        const char* header = http_request->headers[i];
+        if (strncasecmp(header, name, name_len) != 0 || header[name_len] != ':') {
+            continue;
+        }
+
+        const char* value = header + name_len + 1;
+        while (*value == ' ' || *value == '\t') {
+            value++;
+        }
+        return value;
+    }
+    return NULL;
+}
+
 int copy_http_request(HttpRequest* first, HttpRequest* second)
 {
     if (!first || !second) {
@@ -193,7 +214,7 @@ int copy_http_request(HttpRequest* first, HttpRequest* second)
     // Copy body
     second->body_len = first->body_len;
     if (first->body_len > 0) {
-        second->body = (char*)malloc(first->body_len);
+        second->body = (char*)malloc(first->body_len + HTTP_REQUEST_BODY_PADDING);
         if (!second->body) {
             // Free headers if body allocation fails
             if (second->headers) {
@@ -204,7 +225,7 @@ int copy_http_request(HttpRequest* first, HttpRequest* second)
             }
             return -1; // Error: Memory allocation failed
         }
-        memcpy(second->body, first->body, first->body_len);
+        memcpy(second->body, first->body, first->body_len + HTTP_REQUEST_BODY_PADDING);
     } else {
         second->body = NULL;
     }
@@ -255,7 +276,48 @@ int http_response_add_cors_headers(HttpResponse* http_response) {
     return 0;
 }
 
-int http_response_write_to_socket(int socket, HttpResponse* http_response)
+// writes iovecs fully, short writes would cut bodies and break chunk framing
+static int writev_all(int socket, struct iovec* iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        ssize_t written = writev(socket, iov, iovcnt);
+        if (written < 0) {
+            return -1;
+        }
+
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return 0;
+}
+
+int http_response_add_header(HttpResponse* http_response, const char* header)
+{
+    char* header_copy = strdup(header);
+    if (!header_copy) {
+        return -1;
+    }
+
+    char** new_headers = realloc(http_response->headers, (http_response->headers_len + 1) * sizeof(char*));
+    if (!new_headers) {
+        free(header_copy);
+        return -1;
+    }
+
+    http_response->headers = new_headers;
+    http_response->headers[http_response->headers_len++] = header_copy;
+    return 0;
+}
+
+int http_response_write_head_to_socket(int socket, HttpResponse* http_response)
 {
     // Write status line
     char status_line[512];
@@ -282,9 +344,19 @@ int http_response_write_to_socket(int socket, HttpResponse* http_response)
         return -1; // Failed to write to socket
     }
 
+    return 0;
+}
+
+int http_response_write_to_socket(int socket, HttpResponse* http_response)
+{
+    if (http_response_write_head_to_socket(socket, http_response)) {
+        return -1;
+    }
+
     // Write body
     if (http_response->body_len > 0 && http_response->body != NULL) {
-        if (write(socket, http_response->body, http_response->body_len) < 0) {
+        struct iovec iov = { .iov_base = http_response->body, .iov_len = http_response->body_len };
+        if (writev_all(socket, &iov, 1) < 0) {
             return -1; // Failed to write to socket
         }
     }
@@ -292,24 +364,74 @@ int http_response_write_to_socket(int socket, HttpResponse* http_response)
     return 0; // Success
 }
 
-// Constructor for HttpResponse
-HttpResponse* create_http_response(HttpResponse* response, const char* status, const char** headers, size_t headers_count, const char* body)
+int http_write_chunk_to_socket(int socket, const char* data, size_t len)
 {
+    if (len == 0) {
+        return 0;
+    }
+
+    char size_line[32];
+    int size_line_len = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+
+    struct iovec iov[] = {
+        { .iov_base = size_line, .iov_len = size_line_len },
+        { .iov_base = (char*)data, .iov_len = len },
+        { .iov_base = (char*)"\r\n", .iov_len = 2 },
+    };
+    return writev_all(socket, iov, 3);
+}
+
+int http_write_last_chunk_to_socket(int socket)
+{
+    struct iovec iov = { .iov_base = (char*)"0\r\n\r\n", .iov_len = 5 };
+    return writev_all(socket, &iov, 1);
+}
+
+int http_write_to_socket(int socket, const char* data, size_t len)
+{
+    struct iovec iov = { .iov_base = (char*)data, .iov_len = len };
+    return writev_all(socket, &iov, 1);
+}
+
+int http_write_event_stream_frame_to_socket(int socket, const char* event, const char* data, size_t data_len)
+{
+    char event_line[64];
+    int event_line_len = snprintf(event_line, sizeof(event_line), HTTP_EVENT_STREAM_FRAME_HEAD, event);
+    if (event_line_len < 0 || (size_t)event_line_len >= sizeof(event_line)) {
+        return -1;
+    }
+
+    struct iovec iov[] = {
+        { .iov_base = event_line, .iov_len = event_line_len },
+        { .iov_base = (char*)data, .iov_len = data_len },
+        { .iov_base = (char*)HTTP_EVENT_STREAM_FRAME_TAIL, .iov_len = sizeof(HTTP_EVENT_STREAM_FRAME_TAIL) - 1 },
+    };
+    return writev_all(socket, iov, 3);
+}
+
+// status and headers part shared by all constructors, on failure
+// response is left empty so free_http_response is still safe
+static int init_http_response_head(HttpResponse* response, const char* status, const char** headers, size_t headers_count)
+{
+    response->headers_len = 0;
+    response->headers = NULL;
+    response->body_len = 0;
+    response->body = NULL;
+    response->body_ownership = HttpBodyOwned;
+
     // Duplicate the status string
     response->status = strdup(status);
     if (!response->status) {
-        free(response);
-        return NULL;
+        return -1;
     }
 
     // Allocate memory for headers
-    response->headers_len = headers_count;
     if (headers_count > 0) {
         response->headers = (char**)malloc(headers_count * sizeof(char*));
         if (!response->headers) {
             free(response->status);
-            free(response);
-            return NULL;
+            response->status = NULL;
+            return -1;
         }
 
         // Copy each header
@@ -317,31 +439,61 @@ HttpResponse* create_http_response(HttpResponse* response, const char* status, c
             response->headers[i] = strdup(headers[i]);
             if (!response->headers[i]) {
                 free_headers(response->headers, i); // Free allocated headers up to this point
+                response->headers = NULL;
                 free(response->status);
-                free(response);
-                return NULL;
+                response->status = NULL;
+                return -1;
             }
         }
-    } else {
-        response->headers = NULL;
+        response->headers_len = headers_count;
+    }
+
+    return 0;
+}
+
+// Constructor for HttpResponse
+HttpResponse* create_http_response(HttpResponse* response, const char* status, const char** headers, size_t headers_count, const char* body, size_t body_len)
+{
+    if (init_http_response_head(response, status, headers, headers_count)) {
+        return NULL;
     }
 
-    // Duplicate the body
+    // Duplicate the body, nul is kept after it only for logging
     if (body) {
-        response->body_len = strlen(body);
-        response->body = (char*)malloc(response->body_len + 1);
+        response->body = (char*)malloc(body_len + 1);
         if (!response->body) {
-            free_headers(response->headers, headers_count);
-            free(response->status);
-            free(response);
+            free_http_response(response);
             return NULL;
         }
-        strcpy(response->body, body);
-    } else {
-        response->body_len = 0;
-        response->body = NULL;
+        memcpy(response->body, body, body_len);
+        response->body[body_len] = '\0';
+        response->body_len = body_len;
+    }
+
+    return response;
+}
+
+HttpResponse* create_http_response_adopt_body(HttpResponse* response, const char* status, const char** headers, size_t headers_count, char* body, size_t body_len)
+{
+    if (init_http_response_head(response, status, headers, headers_count)) {
+        free(body);
+        return NULL;
     }
 
+    response->body = body;
+    response->body_len = body ? body_len : 0;
+    return response;
+}
+
+HttpResponse* create_http_response_static_body(HttpResponse* response, const char* status, const char** headers, size_t headers_count, const char* body, size_t body_len)
+{
+    if (init_http_response_head(response, status, headers, headers_count)) {
+        return NULL;
+    }
+
+    response->body = (char*)body;
+    response->body_len = body ? body_len : 0;
+    response->body_ownership = HttpBodyBorrowed;
     return response;
 }
 
@@ -359,7 +511,9 @@ void free_http_response(HttpResponse* response)
     free_headers(response->headers, response->headers_len);
 
     // Free the body
-    free(response->body);
+    if (response->body_ownership == HttpBodyOwned) {
+        free(response->body);
+    }
 }
 
 int copy_http_response(HttpResponse* first, HttpResponse* second)
@@ -374,6 +528,8 @@ int copy_http_response(HttpResponse* first, HttpResponse* second)
     second->headers = NULL;
     second->body_len = 0;
     second->body = NULL;
+    second->body_ownership = HttpBodyOwned;
+    second->streamed = first->streamed;
 
     // Copy status
     if (first->status) {
@@ -7,6 +7,13 @@
 #define HTTP_INTERNAL_SERVER_ERROR "HTTP/1.0 500\n\n500 Internal Server Error"
 #define HTTP_NOT_FOUND_ERROR "HTTP/1.0 404\n\n404 Not Found"
 
+// string literal as body and length arguments, length known at compile time
+#define HTTP_LITERAL_BODY(str) (str), sizeof(str) - 1
+
+// zeroed bytes kept after request body data, json bodies
+// are parsed in place and the parser reads past their end
+#define HTTP_REQUEST_BODY_PADDING 4
+
 // Define the CORS headers
 #define ALLOW_ORIGIN_HEADER "Access-Control-Allow-Origin: *"
 #define ALLOW_METHODS_HEADER "Access-Control-Allow-Methods: GET, POST, OPTIONS, PUT, DELETE"
@@ -22,22 +29,59 @@ typedef struct {
     char* body;
 } HttpRequest;
 
+// who releases response body, owned ones are malloc'd and freed
+// with the response, borrowed ones are static strings or buffers
+// outliving the response and never freed by it
+typedef enum {
+    HttpBodyOwned,
+    HttpBodyBorrowed,
+} HttpBodyOwnership;
+
 typedef struct {
     char* status;
     size_t headers_len;
     char** headers;
     size_t body_len;
     char* body;
+    HttpBodyOwnership body_ownership;
+    // route already wrote the whole response to socket itself,
+    // as chunked streams do, nothing is left to send
+    int streamed;
 } HttpResponse;
 
 int http_request_read_from_socket(int socket, HttpRequest* http_request);
 void free_http_request(HttpRequest* http_request);
+// value of first header named name, case insensitive, NULL if absent
+const char* http_request_get_header(HttpRequest* http_request, const char* name);
 int copy_http_request(HttpRequest* first, HttpRequest* second);
 
 int http_response_add_cors_headers(HttpResponse* http_response);
+int http_response_add_header(HttpResponse* http_response, const char* header);
 int http_response_write_to_socket(int socket, HttpResponse* http_response);
+int http_response_write_head_to_socket(int socket, HttpResponse* http_response);
+
+// Transfer-Encoding: chunked framing, empty data is not
+// written as it would mark the end of the body
+int http_write_chunk_to_socket(int socket, const char* data, size_t len);
+int http_write_last_chunk_to_socket(int socket);
+
+// writes all of data, looping over short writes
+int http_write_to_socket(int socket, const char* data, size_t len);
+
+// text/event-stream frame around event data
+#define HTTP_EVENT_STREAM_FRAME_HEAD "event: %s\ndata: "
+#define HTTP_EVENT_STREAM_FRAME_TAIL "\n\n"
+
+// one text/event-stream frame, data is written as is with its length
+int http_write_event_stream_frame_to_socket(int socket, const char* event, const char* data, size_t data_len);
 
-HttpResponse* create_http_response(HttpResponse* response, const char* status, const char** headers, size_t headers_count, const char* body);
+// bodies carry explicit length and may hold any bytes, nul included
+HttpResponse* create_http_response(HttpResponse* response, const char* status, const char** headers, size_t headers_count, const char* body, size_t body_len);
+// takes over malloc'd body instead of copying it, body is
+// released with the response or right away on failure
+HttpResponse* create_http_response_adopt_body(HttpResponse* response, const char* status, const char** headers, size_t headers_count, char* body, size_t body_len);
+// references body without copying, it must outlive the response
+HttpResponse* create_http_response_static_body(HttpResponse* response, const char* status, const char** headers, size_t headers_count, const char* body, size_t body_len);
 void free_http_response(HttpResponse* response);
 int copy_http_response(HttpResponse* first, HttpResponse* second);
 
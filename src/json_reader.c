@@ -0,0 +1,80 @@
+#include "json_reader.h"
+#include "http.h"
+#include "log.h"
+#include <stdlib.h>
+
+#if HTTP_REQUEST_BODY_PADDING < YYJSON_PADDING_SIZE
+#error "request body padding is too small for in place parsing"
+#endif
+
+// pool is initialised once per thread and reused by every document,
+// each one is freed before next request, so it does not fragment
+static __thread yyjson_alc thread_json_alc;
+static __thread char* thread_json_pool;
+
+static const yyjson_alc* get_thread_json_alc(void)
+{
+    if (thread_json_pool) {
+        return &thread_json_alc;
+    }
+
+    thread_json_pool = malloc(JSON_READER_POOL_SIZE);
+    if (!thread_json_pool) {
+        return NULL;
+    }
+
+    yyjson_alc_pool_init(&thread_json_alc, thread_json_pool, JSON_READER_POOL_SIZE);
+    return &thread_json_alc;
+}
+
+yyjson_doc* json_read_insitu(char* json, size_t json_len)
+{
+    // NULL allocator makes yyjson use malloc
+    const yyjson_alc* alc = NULL;
+    size_t max_memory_usage = yyjson_read_max_memory_usage(json_len, YYJSON_READ_INSITU);
+    if (max_memory_usage && max_memory_usage <= JSON_READER_POOL_SIZE) {
+        alc = get_thread_json_alc();
+    }
+
+    yyjson_read_err err;
+    yyjson_doc* doc = yyjson_read_opts(json, json_len, YYJSON_READ_INSITU, alc, &err);
+    if (!doc) {
+        LogTrace("Cant parse json at %zu: %s", err.pos, err.msg);
+    }
+    return doc;
+}
+
+int json_decode_string_array(yyjson_val* val, JsonStringArray* dst)
+{
+    if (!yyjson_is_arr(val)) {
+        return 0;
+    }
+
+    size_t len = unsafe_yyjson_get_len(val);
+    char** items = len ? malloc(len * sizeof(char*)) : NULL;
+    if (len && !items) {
+        LogErr("Cant alloc memory for json string array");
+        return 0;
+    }
+
+    size_t idx, max;
+    yyjson_val* item;
+    yyjson_arr_foreach(val, idx, max, item)
+    {
+        if (!json_decode_string(item, &items[idx])) {
+            free(items);
+            return 0;
+        }
+    }
+
+    dst->len = len;
+    dst->items = items;
+    return 1;
+}
+
+void json_free_string_array(JsonStringArray* arr)
+{
+    free(arr->items);
+    arr->items = NULL;
+    arr->len = 0;
+}
@@ -0,0 +1,146 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include "yyjson.h"
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// per thread memory documents of request bodies are parsed into,
+// bodies whose worst case document does not fit use malloc
+#define JSON_READER_POOL_SIZE (64 * 1024)
+
+// parses json in place: strings are unescaped inside json and string
+// values point there, so they outlive yyjson_doc_free as long as json
+// does; json must be followed by HTTP_REQUEST_BODY_PADDING zero bytes
+// and is garbage for other uses afterwards
+yyjson_doc* json_read_insitu(char* json, size_t json_len);
+
+// length with first, middle and last byte of key; for literal keys
+// it folds to a constant, so a key is matched against a field of same
+// length with one more compare and only a hit costs memcmp
+#define JSON_KEY_FINGERPRINT(key, len)                                            \
+    ((uint32_t)((len) & 0xff) << 24 | (uint32_t)(unsigned char)(key)[0] << 16 \
+        | (uint32_t)(unsigned char)(key)[(len) / 2] << 8 | (uint32_t)(unsigned char)(key)[(len) - 1])
+
+// value decoders for field kinds, 0 when value is of other type;
+// routes may add own kinds named json_decode_<kind> the same way
+static inline int json_decode_string(yyjson_val* val, char** dst)
+{
+    if (!yyjson_is_str(val)) {
+        return 0;
+    }
+    // string lives in parsed json, not in document
+    *dst = (char*)unsafe_yyjson_get_str(val);
+    return 1;
+}
+
+// whole numbers only, positive ones are parsed as unsigned
+static inline int json_decode_int64(yyjson_val* val, int64_t* dst)
+{
+    if (yyjson_is_sint(val)) {
+        *dst = unsafe_yyjson_get_sint(val);
+        return 1;
+    }
+    if (yyjson_is_uint(val) && unsafe_yyjson_get_uint(val) <= INT64_MAX) {
+        *dst = (int64_t)unsafe_yyjson_get_uint(val);
+        return 1;
+    }
+    return 0;
+}
+
+static inline int json_decode_int(yyjson_val* val, int* dst)
+{
+    int64_t v;
+    if (!json_decode_int64(val, &v) || v < INT_MIN || v > INT_MAX) {
+        return 0;
+    }
+    *dst = (int)v;
+    return 1;
+}
+
+// items point into parsed json like strings do, only items array
+// itself is allocated and freed by json_free_string_array
+typedef struct {
+    size_t len;
+    char** items;
+} JsonStringArray;
+
+int json_decode_string_array(yyjson_val* val, JsonStringArray* dst);
+void json_free_string_array(JsonStringArray* arr);
+
+#define JSON_DECODER_FIELD_INDEX(type, member, kind) json_field_##member,
+
+#define JSON_DECODER_FIELD_MATCH(type, member, kind)                                                    \
+    if (key_len == sizeof(#member) - 1                                                                  \
+        && JSON_KEY_FINGERPRINT(key_str, key_len) == JSON_KEY_FINGERPRINT(#member, sizeof(#member) - 1) \
+        && memcmp(key_str, #member, sizeof(#member) - 1) == 0) {                                        \
+        if (!(seen & UINT32_C(1) << json_field_##member)) {                                            \
+            if (!json_decode_##kind(val, &out->member)) {                                              \
+                return -4;                                                                             \
+            }                                                                                          \
+            seen |= UINT32_C(1) << json_field_##member;                                                \
+        }                                                                                              \
+        continue;                                                                                      \
+    }
+
+// defines static int name(yyjson_val* obj, type* out) which fills out
+// in one walk over keys of obj; fields is an X-macro list of
+// FIELD(type, member, kind) entries, key is named as member and kind
+// picks json_decode_<kind>, at most 32 of them. every field is
+// required, first of duplicate keys wins. returns -3 when obj is not
+// an object and -4 when a field is missing or of other type, out may
+// be partially filled then
+#define JSON_OBJECT_DECODER(name, type, fields)                                           \
+    static int name(yyjson_val* obj, type* out)                                           \
+    {                                                                                     \
+        enum { fields(JSON_DECODER_FIELD_INDEX) json_fields_len };                        \
+        const uint32_t all = (uint32_t)((UINT64_C(1) << json_fields_len) - 1);            \
+        if (!yyjson_is_obj(obj)) {                                                        \
+            return -3;                                                                    \
+        }                                                                                 \
+                                                                                          \
+        /* first of duplicate keys wins, so walk ends once all are seen */                \
+        uint32_t seen = 0;                                                                \
+        size_t keys_len = unsafe_yyjson_get_len(obj);                                     \
+        yyjson_val* key = keys_len ? unsafe_yyjson_get_first(obj) : NULL;                 \
+        for (size_t k = 0; k < keys_len && seen != all; ++k, key = unsafe_yyjson_get_next(key + 1)) { \
+            const char* key_str = unsafe_yyjson_get_str(key);                             \
+            size_t key_len = unsafe_yyjson_get_len(key);                                  \
+            if (key_len == 0) {                                                           \
+                continue;                                                                 \
+            }                                                                             \
+            yyjson_val* val = key + 1;                                                    \
+            fields(JSON_DECODER_FIELD_MATCH)                                              \
+        }                                                                                 \
+                                                                                          \
+        return seen == all ? 0 : -4;                                                      \
+    }
+
+// defines int name(size_t json_len, char json[json_len], type* out)
+// which parses json in place and decodes its root object into out like
+// JSON_OBJECT_DECODER does; out is zeroed first, so kinds which allocate
+// can be freed whatever is returned. returns -2 when json does not parse
+#define JSON_DECODER(name, type, fields)                                                  \
+    JSON_OBJECT_DECODER(name##_object, type, fields)                                      \
+                                                                                          \
+    int name(size_t json_len, char json[json_len], type* out)                             \
+    {                                                                                     \
+        if (!json || !out) {                                                              \
+            return -1;                                                                    \
+        }                                                                                 \
+                                                                                          \
+        /* fields of failed decode stay NULL instead of pointing into json */            \
+        memset(out, 0, sizeof(*out));                                                     \
+        yyjson_doc* doc = json_read_insitu(json, json_len);                               \
+        if (!doc) {                                                                       \
+            return -2;                                                                    \
+        }                                                                                 \
+                                                                                          \
+        int rc = name##_object(yyjson_doc_get_root(doc), out);                            \
+        yyjson_doc_free(doc);                                                             \
+        return rc;                                                                        \
+    }
+
+#endif
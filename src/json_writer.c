@@ -0,0 +1,539 @@
+#include "json_writer.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+WireFormat wire_format_from_accept(const char* accept)
+{
+    if (!accept) {
+        return WireFormatJson;
+    }
+
+    // first listed binary type wins, q values are not weighed;
+    // covers application/msgpack and application/x-msgpack
+    const char* msgpack = strstr(accept, "msgpack");
+    const char* cbor = strstr(accept, "application/cbor");
+    if (msgpack && (!cbor || msgpack < cbor)) {
+        return WireFormatMsgPack;
+    }
+    if (cbor) {
+        return WireFormatCbor;
+    }
+    return WireFormatJson;
+}
+
+const char* wire_format_content_type_header(WireFormat format)
+{
+    switch (format) {
+    case WireFormatMsgPack:
+        return "Content-Type: application/msgpack";
+    case WireFormatCbor:
+        return "Content-Type: application/cbor";
+    default:
+        return "Content-Type: application/json";
+    }
+}
+
+// binary streams are values written back to back, both
+// formats are self delimiting so no framing is added
+const char* wire_format_stream_content_type_header(WireFormat format)
+{
+    switch (format) {
+    case WireFormatMsgPack:
+        return "Content-Type: application/msgpack";
+    case WireFormatCbor:
+        return "Content-Type: application/cbor-seq";
+    default:
+        return "Content-Type: text/event-stream";
+    }
+}
+
+int json_writer_init(JsonWriter* w, size_t initial_cap)
+{
+    return json_writer_init_format(w, initial_cap, WireFormatJson);
+}
+
+int json_writer_init_format(JsonWriter* w, size_t initial_cap, WireFormat format)
+{
+    memset(w, 0, sizeof(*w));
+    w->format = format;
+    w->cap = initial_cap > 0 ? initial_cap : 64;
+    w->buf = malloc(w->cap);
+    if (!w->buf) {
+        w->failed = 1;
+        return -1;
+    }
+    w->buf[0] = '\0';
+    return 0;
+}
+
+void json_writer_free(JsonWriter* w)
+{
+    free(w->buf);
+    w->buf = NULL;
+    w->len = w->cap = 0;
+}
+
+// makes room for extra bytes plus nul terminator
+static int json_writer_reserve(JsonWriter* w, size_t extra)
+{
+    if (w->failed) {
+        return -1;
+    }
+
+    if (w->len + extra + 1 <= w->cap) {
+        return 0;
+    }
+
+    size_t new_cap = w->cap ? w->cap * 2 : 64;
+    while (new_cap < w->len + extra + 1) {
+        new_cap *= 2;
+    }
+
+    char* new_buf = realloc(w->buf, new_cap);
+    if (!new_buf) {
+        w->failed = 1;
+        return -1;
+    }
+    w->buf = new_buf;
+    w->cap = new_cap;
+    return 0;
+}
+
+static void json_writer_append(JsonWriter* w, const char* data, size_t len)
+{
+    if (json_writer_reserve(w, len)) {
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+// comma between siblings, nothing after key
+static void json_writer_before_value(JsonWriter* w)
+{
+    if (w->after_key) {
+        w->after_key = 0;
+        return;
+    }
+
+    if (w->depth > 0) {
+        if (w->format == WireFormatJson && w->items[w->depth - 1] > 0) {
+            json_writer_append(w, ",", 1);
+        }
+        w->items[w->depth - 1]++;
+    }
+}
+
+static void put_be(unsigned char* dst, unsigned long long n, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++) {
+        dst[i] = n >> (8 * (bytes - 1 - i));
+    }
+}
+
+// cbor initial byte plus big endian argument, returns bytes written
+static size_t cbor_head(unsigned char* dst, int major, unsigned long long n)
+{
+    major <<= 5;
+    if (n < 24) {
+        dst[0] = major | n;
+        return 1;
+    }
+    size_t bytes = n <= 0xff ? 1 : n <= 0xffff ? 2 : n <= 0xffffffff ? 4 : 8;
+    dst[0] = major | (bytes == 1 ? 24 : bytes == 2 ? 25 : bytes == 4 ? 26 : 27);
+    put_be(dst + 1, n, bytes);
+    return 1 + bytes;
+}
+
+// fix, 16 and 32 bit variants of msgpack array, map and str heads
+static size_t msgpack_head(unsigned char* dst, unsigned char fix, unsigned int fix_max,
+    unsigned char* wide, unsigned long long n)
+{
+    if (n <= fix_max) {
+        dst[0] = fix | n;
+        return 1;
+    }
+    size_t bytes = n <= 0xffff ? 2 : 4;
+    dst[0] = bytes == 2 ? wide[0] : wide[1];
+    put_be(dst + 1, n, bytes);
+    return 1 + bytes;
+}
+
+static size_t msgpack_container_head(unsigned char* dst, int is_object, unsigned int n)
+{
+    if (is_object) {
+        return msgpack_head(dst, 0x80, 15, (unsigned char[]) { 0xde, 0xdf }, n);
+    }
+    return msgpack_head(dst, 0x90, 15, (unsigned char[]) { 0xdc, 0xdd }, n);
+}
+
+static size_t msgpack_str_head(unsigned char* dst, size_t len)
+{
+    if (len > 31 && len <= 0xff) {
+        dst[0] = 0xd9;
+        dst[1] = len;
+        return 2;
+    }
+    return msgpack_head(dst, 0xa0, 31, (unsigned char[]) { 0xda, 0xdb }, len);
+}
+
+static size_t msgpack_int(unsigned char* dst, long long value)
+{
+    if (value >= 0) {
+        unsigned long long n = value;
+        if (n < 128) {
+            dst[0] = n;
+            return 1;
+        }
+        size_t bytes = n <= 0xff ? 1 : n <= 0xffff ? 2 : n <= 0xffffffff ? 4 : 8;
+        dst[0] = bytes == 1 ? 0xcc : bytes == 2 ? 0xcd : bytes == 4 ? 0xce : 0xcf;
+        put_be(dst + 1, n, bytes);
+        return 1 + bytes;
+    }
+
+    if (value >= -32) {
+        dst[0] = (unsigned char)value;
+        return 1;
+    }
+    size_t bytes = value >= INT8_MIN ? 1 : value >= INT16_MIN ? 2 : value >= INT32_MIN ? 4 : 8;
+    dst[0] = bytes == 1 ? 0xd0 : bytes == 2 ? 0xd1 : bytes == 4 ? 0xd2 : 0xd3;
+    put_be(dst + 1, (unsigned long long)value, bytes);
+    return 1 + bytes;
+}
+
+// biggest header a container can get, placeholders are this long
+#define BINARY_CONTAINER_HEAD_MAX 5
+
+static void json_writer_open(JsonWriter* w, int is_object)
+{
+    json_writer_before_value(w);
+    if (w->depth == JSON_WRITER_MAX_DEPTH) {
+        w->failed = 1;
+        return;
+    }
+
+    w->starts[w->depth] = SIZE_MAX;
+    if (w->format == WireFormatJson) {
+        json_writer_append(w, is_object ? "{" : "[", 1);
+    } else if (w->format == WireFormatCbor && !is_object) {
+        // indefinite length, so arrays stay drainable while open
+        json_writer_append(w, "\x9f", 1);
+    } else {
+        // count is unknown yet, widest header is reserved and
+        // shrunk on close
+        w->starts[w->depth] = w->len;
+        json_writer_append(w, "\0\0\0\0\0", BINARY_CONTAINER_HEAD_MAX);
+    }
+    w->items[w->depth++] = 0;
+}
+
+static void json_writer_close(JsonWriter* w, int is_object)
+{
+    if (w->depth == 0) {
+        w->failed = 1;
+        return;
+    }
+    w->depth--;
+
+    if (w->format == WireFormatJson) {
+        json_writer_append(w, is_object ? "}" : "]", 1);
+        return;
+    }
+
+    size_t start = w->starts[w->depth];
+    if (start == SIZE_MAX) {
+        json_writer_append(w, "\xff", 1); // cbor break
+        return;
+    }
+    if (w->failed) {
+        return;
+    }
+
+    unsigned char head[BINARY_CONTAINER_HEAD_MAX];
+    unsigned int items = w->items[w->depth];
+    size_t head_len = w->format == WireFormatMsgPack
+        ? msgpack_container_head(head, is_object, items)
+        : cbor_head(head, is_object ? 5 : 4, items);
+
+    size_t body = start + BINARY_CONTAINER_HEAD_MAX;
+    if (head_len < BINARY_CONTAINER_HEAD_MAX) {
+        memmove(w->buf + start + head_len, w->buf + body, w->len - body);
+        w->len -= BINARY_CONTAINER_HEAD_MAX - head_len;
+    }
+    memcpy(w->buf + start, head, head_len);
+}
+
+void json_writer_begin_object(JsonWriter* w)
+{
+    json_writer_open(w, 1);
+}
+
+void json_writer_end_object(JsonWriter* w)
+{
+    json_writer_close(w, 1);
+}
+
+void json_writer_begin_array(JsonWriter* w)
+{
+    json_writer_open(w, 0);
+}
+
+void json_writer_end_array(JsonWriter* w)
+{
+    json_writer_close(w, 0);
+}
+
+static void binary_writer_string(JsonWriter* w, const char* str, size_t len)
+{
+    unsigned char head[9];
+    size_t head_len = w->format == WireFormatMsgPack
+        ? msgpack_str_head(head, len)
+        : cbor_head(head, 3, len);
+
+    if (json_writer_reserve(w, head_len + len)) {
+        return;
+    }
+    memcpy(w->buf + w->len, head, head_len);
+    memcpy(w->buf + w->len + head_len, str, len);
+    w->len += head_len + len;
+}
+
+void json_writer_key(JsonWriter* w, const char* key)
+{
+    json_writer_before_value(w);
+
+    if (w->format != WireFormatJson) {
+        binary_writer_string(w, key, strlen(key));
+        w->after_key = 1;
+        return;
+    }
+
+    size_t key_len = strlen(key);
+    if (json_writer_reserve(w, key_len + 3)) {
+        return;
+    }
+    w->buf[w->len++] = '"';
+    memcpy(w->buf + w->len, key, key_len);
+    w->len += key_len;
+    w->buf[w->len++] = '"';
+    w->buf[w->len++] = ':';
+    w->after_key = 1;
+}
+
+void json_writer_key_len(JsonWriter* w, const char* key, size_t len)
+{
+    json_writer_string_len(w, key, len);
+    if (w->format == WireFormatJson) {
+        json_writer_append(w, ":", 1);
+    }
+    w->after_key = 1;
+}
+
+// index of first byte which has to be escaped, len if there is none
+static size_t json_find_escape(const char* str, size_t len)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    // 16 bytes per step: quote, backslash or anything below 0x20
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1f);
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(chunk, control_max), chunk));
+        int mask = _mm_movemask_epi8(special);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    for (; i < len; i++) {
+        unsigned char c = str[i];
+        if (c == '"' || c == '\\' || c < 0x20) {
+            return i;
+        }
+    }
+    return len;
+}
+
+size_t json_escape_string(char* dst, const char* str, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    char* out = dst;
+
+    while (len > 0) {
+        // plain runs are copied at once
+        size_t run = json_find_escape(str, len);
+        memcpy(out, str, run);
+        out += run;
+        str += run;
+        len -= run;
+        if (len == 0) {
+            break;
+        }
+
+        unsigned char c = *str++;
+        len--;
+        *out++ = '\\';
+        switch (c) {
+        case '"':
+            *out++ = '"';
+            break;
+        case '\\':
+            *out++ = '\\';
+            break;
+        case '\n':
+            *out++ = 'n';
+            break;
+        case '\r':
+            *out++ = 'r';
+            break;
+        case '\t':
+            *out++ = 't';
+            break;
+        case '\b':
+            *out++ = 'b';
+            break;
+        case '\f':
+            *out++ = 'f';
+            break;
+        default:
+            *out++ = 'u';
+            *out++ = '0';
+            *out++ = '0';
+            *out++ = hex[c >> 4];
+            *out++ = hex[c & 0xf];
+            break;
+        }
+    }
+
+    return out - dst;
+}
+
+void json_writer_string_len(JsonWriter* w, const char* str, size_t len)
+{
+    json_writer_before_value(w);
+
+    if (w->format != WireFormatJson) {
+        binary_writer_string(w, str, len);
+        return;
+    }
+
+    // worst case is every byte escaped as \u00XX
+    if (json_writer_reserve(w, len * 6 + 2)) {
+        return;
+    }
+    w->buf[w->len++] = '"';
+    w->len += json_escape_string(w->buf + w->len, str, len);
+    w->buf[w->len++] = '"';
+}
+
+void json_writer_string(JsonWriter* w, const char* str)
+{
+    json_writer_string_len(w, str ? str : "", str ? strlen(str) : 0);
+}
+
+void json_writer_int(JsonWriter* w, long long value)
+{
+    json_writer_before_value(w);
+
+    if (json_writer_reserve(w, 24)) {
+        return;
+    }
+
+    unsigned char* dst = (unsigned char*)w->buf + w->len;
+    switch (w->format) {
+    case WireFormatMsgPack:
+        w->len += msgpack_int(dst, value);
+        break;
+    case WireFormatCbor:
+        w->len += value >= 0 ? cbor_head(dst, 0, value) : cbor_head(dst, 1, -1 - value);
+        break;
+    default:
+        w->len += snprintf(w->buf + w->len, 24, "%lld", value);
+        break;
+    }
+}
+
+void json_writer_bool(JsonWriter* w, int value)
+{
+    json_writer_before_value(w);
+    if (w->format == WireFormatMsgPack) {
+        json_writer_append(w, value ? "\xc3" : "\xc2", 1);
+    } else if (w->format == WireFormatCbor) {
+        json_writer_append(w, value ? "\xf5" : "\xf4", 1);
+    } else if (value) {
+        json_writer_append(w, "true", 4);
+    } else {
+        json_writer_append(w, "false", 5);
+    }
+}
+
+void json_writer_null(JsonWriter* w)
+{
+    json_writer_before_value(w);
+    if (w->format == WireFormatMsgPack) {
+        json_writer_append(w, "\xc0", 1);
+    } else if (w->format == WireFormatCbor) {
+        json_writer_append(w, "\xf6", 1);
+    } else {
+        json_writer_append(w, "null", 4);
+    }
+}
+
+void json_writer_raw(JsonWriter* w, const char* json, size_t len)
+{
+    json_writer_before_value(w);
+    json_writer_append(w, json, len);
+}
+
+char* json_writer_finish(JsonWriter* w, size_t* len)
+{
+    if (w->failed || w->depth != 0) {
+        json_writer_free(w);
+        return NULL;
+    }
+
+    w->buf[w->len] = '\0';
+    if (len) {
+        *len = w->len;
+    }
+
+    char* buf = w->buf;
+    w->buf = NULL;
+    w->len = w->cap = 0;
+    return buf;
+}
+
+int json_writer_can_drain(const JsonWriter* w)
+{
+    for (int i = 0; i < w->depth; i++) {
+        if (w->starts[i] != SIZE_MAX) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void json_writer_drain(JsonWriter* w)
+{
+    if (w->failed) {
+        return;
+    }
+    if (!json_writer_can_drain(w)) {
+        w->failed = 1;
+        return;
+    }
+    w->len = 0;
+    w->buf[0] = '\0';
+}
@@ -0,0 +1,84 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+
+// nesting of objects and arrays one writer can track
+#define JSON_WRITER_MAX_DEPTH 16
+
+// encodings one writer produces from the same value calls,
+// objects become maps with string keys in binary ones
+typedef enum {
+    WireFormatJson,
+    WireFormatMsgPack,
+    WireFormatCbor,
+} WireFormat;
+
+// picks format from Accept header value, json when it is NULL
+// or names none of binary types
+WireFormat wire_format_from_accept(const char* accept);
+// Content-Type header line of single document in format
+const char* wire_format_content_type_header(WireFormat format);
+// Content-Type header line of stream of documents in format
+const char* wire_format_stream_content_type_header(WireFormat format);
+// every response whose format was picked from Accept carries it,
+// so caches keep json and binary bodies of one url apart
+#define WIRE_FORMAT_VARY_HEADER "Vary: Accept"
+
+// append only json builder, values are written in one pass into
+// a growing buffer and strings are escaped on the way; errors are
+// sticky and reported once by json_writer_finish
+typedef struct {
+    char* buf;
+    size_t len;
+    size_t cap;
+    int failed;
+    int depth;
+    int after_key;
+    WireFormat format;
+    // items of each open container, pairs for objects
+    unsigned int items[JSON_WRITER_MAX_DEPTH];
+    // binary formats: offset of container header patched with
+    // its count on close, SIZE_MAX if it needs no patching
+    size_t starts[JSON_WRITER_MAX_DEPTH];
+} JsonWriter;
+
+int json_writer_init(JsonWriter* w, size_t initial_cap);
+int json_writer_init_format(JsonWriter* w, size_t initial_cap, WireFormat format);
+void json_writer_free(JsonWriter* w);
+
+void json_writer_begin_object(JsonWriter* w);
+void json_writer_end_object(JsonWriter* w);
+void json_writer_begin_array(JsonWriter* w);
+void json_writer_end_array(JsonWriter* w);
+
+// key must not need escaping, keys are literals of routes
+void json_writer_key(JsonWriter* w, const char* key);
+// key coming from data, escaped like string values are
+void json_writer_key_len(JsonWriter* w, const char* key, size_t len);
+void json_writer_string(JsonWriter* w, const char* str);
+void json_writer_string_len(JsonWriter* w, const char* str, size_t len);
+void json_writer_int(JsonWriter* w, long long value);
+void json_writer_bool(JsonWriter* w, int value);
+void json_writer_null(JsonWriter* w);
+// value already serialized in writer's format, written as is
+void json_writer_raw(JsonWriter* w, const char* json, size_t len);
+
+// hands nul terminated buffer over to caller,
+// returns NULL if anything failed while writing
+char* json_writer_finish(JsonWriter* w, size_t* len);
+
+// whether json_writer_drain is possible now: msgpack containers
+// and cbor maps get their counts patched in on close, so their
+// headers must not be drained while they are open
+int json_writer_can_drain(const JsonWriter* w);
+
+// forgets bytes written so far but keeps nesting state, so a long
+// document can be sent out piece by piece from the same buffer
+void json_writer_drain(JsonWriter* w);
+
+// escapes str as json string contents, without quotes,
+// returns length written; dst must hold 6 * len bytes
+size_t json_escape_string(char* dst, const char* str, size_t len);
+
+#endif
@@ -0,0 +1,390 @@
+#include "messages_archive.h"
+#include "log.h"
+#include "sqlite3.h"
+#include "trinity.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    sqlite3* db;
+    // archive files are named <name>_YYYY_MM.db
+    char name[64];
+} MessagesArchiver;
+
+static const char archive_schema[] = STR(
+    CREATE TABLE IF NOT EXISTS part.messages(
+        id INTEGER PRIMARY KEY,
+        deleted_at BIGINTEGER,
+        created_at BIGINTEGER NOT NULL,
+        updated_at BIGINTEGER NOT NULL,
+        uuid BLOB NOT NULL,
+        sender_id INTEGER NOT NULL,
+        receiver_id INTEGER NOT NULL,
+        data TEXT NOT NULL);
+
+    CREATE INDEX IF NOT EXISTS part.messages_receiver_sender_created_at
+        ON messages(receiver_id, sender_id, created_at););
+
+static int exec_archiver_sql(MessagesArchiver* archiver, const char* sql)
+{
+    char* err_msg = NULL;
+    if (sqlite3_exec(archiver->db, sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        LogErr("Archiver failed to execute SQL '%s': %s", sql, err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    return 0;
+}
+
+static time_t month_start(time_t t, int months_offset)
+{
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    tm.tm_mday = 1;
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_mon += months_offset;
+    return timegm(&tm);
+}
+
+// param is bound only when sql has a placeholder for it
+static int query_int64(MessagesArchiver* archiver, const char* sql, sqlite3_int64 param, sqlite3_int64* result, int* found)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(archiver->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Archiver failed to prepare SQL statement: %s", sqlite3_errmsg(archiver->db));
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, param);
+
+    int rc = sqlite3_step(stmt);
+    *found = rc == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL;
+    if (*found) {
+        *result = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        LogErr("Archiver failed to execute SQL statement: %s", sqlite3_errmsg(archiver->db));
+        return -1;
+    }
+    return 0;
+}
+
+static int get_archive_boundary(MessagesArchiver* archiver, time_t* boundary)
+{
+    sqlite3_int64 ends_at = 0;
+    int found = 0;
+    if (query_int64(archiver, "SELECT MAX(ends_at) FROM message_partitions;", 0, &ends_at, &found)) {
+        return -1;
+    }
+    *boundary = found ? ends_at : 0;
+    return 0;
+}
+
+static int exec_with_range(MessagesArchiver* archiver, const char* sql, time_t from, time_t to, const char* path)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(archiver->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Archiver failed to prepare SQL statement: %s", sqlite3_errmsg(archiver->db));
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, from);
+    sqlite3_bind_int64(stmt, 2, to);
+    if (path) {
+        sqlite3_bind_text(stmt, 3, path, -1, SQLITE_STATIC);
+    }
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Archiver failed to execute SQL statement: %s", sqlite3_errmsg(archiver->db));
+        return -1;
+    }
+    return 0;
+}
+
+static int attach_archive(MessagesArchiver* archiver, const char* path)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(archiver->db, "ATTACH DATABASE ? AS part;", -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Archiver failed to prepare SQL statement: %s", sqlite3_errmsg(archiver->db));
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Archiver failed to attach '%s': %s", path, sqlite3_errmsg(archiver->db));
+        return -1;
+    }
+
+    return exec_archiver_sql(archiver, archive_schema);
+}
+
+// copies rows of month as they are now, rows already copied are
+// replaced, so edits and soft deletes made since last copy win;
+// only archive file is written, main db is just read
+static int copy_month_to_archive(MessagesArchiver* archiver, time_t from, time_t to)
+{
+    if (exec_archiver_sql(archiver, "BEGIN;")
+        || exec_with_range(
+            archiver,
+            "INSERT OR REPLACE INTO part.messages "
+            "SELECT id, deleted_at, created_at, updated_at, uuid, sender_id, receiver_id, data "
+            "FROM main.messages WHERE created_at >= ? AND created_at < ?;",
+            from, to, NULL)
+        || exec_archiver_sql(archiver, "COMMIT;")) {
+        exec_archiver_sql(archiver, "ROLLBACK;");
+        return -1;
+    }
+    return 0;
+}
+
+// copies one month to its file and registers it, rows stay in
+// hot table until next tick so in flight readers still see them
+static int archive_month(MessagesArchiver* archiver, time_t from, time_t to)
+{
+    struct tm tm;
+    gmtime_r(&from, &tm);
+
+    char path[256];
+    snprintf(path, sizeof(path), MESSAGES_ARCHIVE_DIR "/%s_%04d_%02d.db", archiver->name, tm.tm_year + 1900, tm.tm_mon + 1);
+
+    LogInfo("Archiving messages in [%ld, %ld) to '%s'", (long)from, (long)to, path);
+
+    if (attach_archive(archiver, path)) {
+        exec_archiver_sql(archiver, "DETACH DATABASE part;");
+        return -1;
+    }
+
+    // copy is idempotent, so crash before registration only repeats it
+    int rc = copy_month_to_archive(archiver, from, to);
+    if (exec_archiver_sql(archiver, "DETACH DATABASE part;") || rc) {
+        return -1;
+    }
+
+    return exec_with_range(
+        archiver,
+        "INSERT INTO message_partitions (starts_at, ends_at, path) VALUES (?, ?, ?);",
+        from, to, path);
+}
+
+// hot rows of partition whose archived copy is identical, anything
+// changed after last copy stays until next tick copies it again
+#define ARCHIVED_UNCHANGED_ROWS                                                 \
+    "SELECT m.id FROM main.messages m JOIN part.messages p ON p.id = m.id "      \
+    "WHERE m.created_at >= ?1 AND m.created_at < ?2 "                           \
+    "AND p.updated_at = m.updated_at AND p.deleted_at IS m.deleted_at "         \
+    "AND p.data = m.data ORDER BY m.id LIMIT ?3"
+
+static int exec_with_range_and_limit(MessagesArchiver* archiver, const char* sql, time_t from, time_t to, int limit)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(archiver->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Archiver failed to prepare SQL statement: %s", sqlite3_errmsg(archiver->db));
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, from);
+    sqlite3_bind_int64(stmt, 2, to);
+    sqlite3_bind_int(stmt, 3, limit);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Archiver failed to execute SQL statement: %s", sqlite3_errmsg(archiver->db));
+        return -1;
+    }
+    return 0;
+}
+
+// drops rows of one archived month from hot table in small
+// transactions; archive is refreshed first, so an edit or soft
+// delete made after month was copied is never lost
+static int delete_archived_month(MessagesArchiver* archiver, time_t from, time_t to, const char* path)
+{
+    if (attach_archive(archiver, path) || copy_month_to_archive(archiver, from, to)) {
+        exec_archiver_sql(archiver, "DETACH DATABASE part;");
+        return -1;
+    }
+
+    int rc = 0;
+    while (1) {
+        // fts 'delete' has to see the text being removed, so it
+        // picks the same rows before they go
+        if (exec_archiver_sql(archiver, "BEGIN IMMEDIATE;")
+            || exec_with_range_and_limit(
+                archiver,
+                "INSERT INTO messages_fts (messages_fts, rowid, data) "
+                "SELECT 'delete', id, data FROM main.messages WHERE id IN (" ARCHIVED_UNCHANGED_ROWS ");",
+                from, to, MESSAGES_ARCHIVE_DELETE_BATCH)
+            || exec_with_range_and_limit(
+                archiver,
+                "DELETE FROM main.messages WHERE id IN (" ARCHIVED_UNCHANGED_ROWS ");",
+                from, to, MESSAGES_ARCHIVE_DELETE_BATCH)) {
+            exec_archiver_sql(archiver, "ROLLBACK;");
+            rc = -1;
+            break;
+        }
+
+        int deleted = sqlite3_changes(archiver->db);
+        if (exec_archiver_sql(archiver, "COMMIT;")) {
+            exec_archiver_sql(archiver, "ROLLBACK;");
+            rc = -1;
+            break;
+        }
+
+        if (deleted < MESSAGES_ARCHIVE_DELETE_BATCH) {
+            break;
+        }
+
+        // let request writers in between batches
+        nanosleep(&(struct timespec) { .tv_nsec = 10 * 1000000L }, NULL);
+    }
+
+    if (exec_archiver_sql(archiver, "DETACH DATABASE part;")) {
+        return -1;
+    }
+    return rc;
+}
+
+// partitions up to boundary which still have rows in hot table
+static int delete_archived_rows(MessagesArchiver* archiver, time_t boundary)
+{
+    sqlite3_stmt* stmt;
+    const char* sql = "SELECT p.starts_at, p.ends_at, p.path FROM message_partitions p "
+                      "WHERE p.ends_at <= ? AND EXISTS ("
+                      "SELECT 1 FROM messages m WHERE m.created_at >= p.starts_at AND m.created_at < p.ends_at) "
+                      "ORDER BY p.starts_at;";
+    if (sqlite3_prepare_v2(archiver->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Archiver failed to prepare SQL statement: %s", sqlite3_errmsg(archiver->db));
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, boundary);
+
+    // partitions are collected first, statement can't stay open
+    // across transactions of deletion
+    struct {
+        time_t from;
+        time_t to;
+        char path[256];
+    } parts[16];
+    int parts_len = 0;
+    int rc;
+    while (parts_len < 16 && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        parts[parts_len].from = sqlite3_column_int64(stmt, 0);
+        parts[parts_len].to = sqlite3_column_int64(stmt, 1);
+        snprintf(parts[parts_len].path, sizeof(parts[parts_len].path), "%s", (const char*)sqlite3_column_text(stmt, 2));
+        parts_len++;
+    }
+    sqlite3_finalize(stmt);
+
+    int failed = 0;
+    for (int i = 0; i < parts_len; i++) {
+        if (delete_archived_month(archiver, parts[i].from, parts[i].to, parts[i].path)) {
+            failed = 1;
+        }
+    }
+    return failed ? -1 : 0;
+}
+
+static void* messages_archiver_worker(void* data)
+{
+    MessagesArchiver* archiver = data;
+
+    time_t prev_boundary = 0;
+    if (get_archive_boundary(archiver, &prev_boundary)) {
+        LogErr("Archiver cant read archive boundary");
+    }
+
+    while (1) {
+        if (prev_boundary > 0 && delete_archived_rows(archiver, prev_boundary)) {
+            LogWarn("Archiver failed to delete archived rows");
+        }
+
+        // archive every month which fell out of hot window
+        time_t cutoff = month_start(time(NULL), -MESSAGES_HOT_MONTHS);
+        time_t boundary = 0;
+        while (get_archive_boundary(archiver, &boundary) == 0) {
+            sqlite3_int64 oldest = 0;
+            int found = 0;
+            int rc = query_int64(
+                archiver,
+                "SELECT created_at FROM messages WHERE created_at >= ? ORDER BY id LIMIT 1;",
+                boundary, &oldest, &found);
+            if (rc || !found || oldest >= cutoff) {
+                break;
+            }
+
+            time_t from = month_start(oldest, 0);
+            if (from < boundary) {
+                from = boundary;
+            }
+            if (archive_month(archiver, from, month_start(oldest, 1))) {
+                LogWarn("Archiver failed to archive month");
+                break;
+            }
+        }
+
+        // rows registered on this tick are deleted on the next one
+        get_archive_boundary(archiver, &prev_boundary);
+
+        sleep(MESSAGES_ARCHIVE_INTERVAL_SEC);
+    }
+
+    return NULL;
+}
+
+int start_messages_archiver(const char* db_path, const char* name)
+{
+    if (!db_path || !name) {
+        return -1;
+    }
+
+    if (mkdir(MESSAGES_ARCHIVE_DIR, 0755) && errno != EEXIST) {
+        LogErr("Cant create archive directory '%s'", MESSAGES_ARCHIVE_DIR);
+        return -1;
+    }
+
+    MessagesArchiver* archiver = calloc(1, sizeof(MessagesArchiver));
+    if (!archiver) {
+        LogErr("Cant allocate messages archiver");
+        return -1;
+    }
+    snprintf(archiver->name, sizeof(archiver->name), "%s", name);
+
+    // attached databases inherit open flags, archive files must be creatable
+    if (sqlite3_open_v2(db_path, &archiver->db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK) {
+        LogErr("Cant open connection for messages archiver: %s", sqlite3_errmsg(archiver->db));
+        goto fail;
+    }
+
+    // checkpoints belong to wal checkpointer
+    if (exec_archiver_sql(archiver, "pragma busy_timeout = 5000; pragma wal_autocheckpoint = 0;")) {
+        goto fail;
+    }
+
+    pthread_t thrd;
+    if (pthread_create(&thrd, NULL, messages_archiver_worker, archiver)) {
+        LogErr("Cant create messages archiver thread");
+        goto fail;
+    }
+    pthread_detach(thrd);
+
+    LogInfo("Messages archiver started for '%s'", db_path);
+    return 0;
+
+fail:
+    sqlite3_close(archiver->db);
+    free(archiver);
+    return -1;
+}
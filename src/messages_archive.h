@@ -0,0 +1,20 @@
+#ifndef MESSAGES_ARCHIVE_H
+#define MESSAGES_ARCHIVE_H
+
+// messages newer than this many whole months stay in main db
+#define MESSAGES_HOT_MONTHS 3
+#define MESSAGES_ARCHIVE_DIR "archive"
+#define MESSAGES_ARCHIVE_INTERVAL_SEC 60
+// rows deleted from hot table per transaction
+#define MESSAGES_ARCHIVE_DELETE_BATCH 500
+
+// archived months are read only, edit, delete and search work on
+// hot table, so they answer not found for message already moved to
+// archive file; change made before move is copied over with it
+
+// opens own connection to db_path and starts detached thread
+// which moves old months of messages to per month archive files
+// named after name, called once per database file with messages
+int start_messages_archiver(const char* db_path, const char* name);
+
+#endif
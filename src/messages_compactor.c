@@ -0,0 +1,196 @@
+#include "messages_compactor.h"
+#include "log.h"
+#include "sqlite3.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static const struct timespec compaction_pause = {
+    .tv_sec = MESSAGES_COMPACTION_PAUSE_MS / 1000,
+    .tv_nsec = (MESSAGES_COMPACTION_PAUSE_MS % 1000) * 1000000L,
+};
+
+static int exec_compactor_sql(sqlite3* db, const char* sql)
+{
+    char* err_msg = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        LogErr("Compactor failed to execute SQL '%s': %s", sql, err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    return 0;
+}
+
+static int exec_with_deleted_before(sqlite3* db, const char* sql, time_t deleted_before)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Compactor failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, deleted_before);
+    sqlite3_bind_int(stmt, 2, MESSAGES_COMPACTION_BATCH);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Compactor failed to execute SQL statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    return 0;
+}
+
+static int query_pragma_int(sqlite3* db, const char* sql, int* result)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Compactor failed to prepare SQL statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        *result = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_ROW) {
+        LogErr("Compactor failed to execute SQL statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    return 0;
+}
+
+// purges rows deleted before deleted_before in small transactions;
+// ids of a batch are picked once, so fts entries and rows go away
+// together even when rows tie on deleted_at, and fts entries are
+// removed with the original text still in place
+static int purge_deleted_messages(sqlite3* db, time_t deleted_before, int* purged)
+{
+    *purged = 0;
+    while (1) {
+        if (exec_compactor_sql(db, "BEGIN IMMEDIATE;")
+            || exec_compactor_sql(db, "DELETE FROM temp.compaction_batch;")
+            || exec_with_deleted_before(
+                db,
+                "INSERT INTO temp.compaction_batch (id) "
+                "SELECT id FROM messages WHERE deleted_at < ? ORDER BY deleted_at LIMIT ?;",
+                deleted_before)) {
+            exec_compactor_sql(db, "ROLLBACK;");
+            return -1;
+        }
+
+        int deleted = sqlite3_changes(db);
+        if (exec_compactor_sql(
+                db,
+                "INSERT INTO messages_fts (messages_fts, rowid, data) "
+                "SELECT 'delete', m.id, m.data FROM temp.compaction_batch b JOIN messages m ON m.id = b.id;")
+            || exec_compactor_sql(db, "DELETE FROM messages WHERE id IN (SELECT id FROM temp.compaction_batch);")) {
+            exec_compactor_sql(db, "ROLLBACK;");
+            return -1;
+        }
+
+        if (exec_compactor_sql(db, "COMMIT;")) {
+            exec_compactor_sql(db, "ROLLBACK;");
+            return -1;
+        }
+        *purged += deleted;
+
+        if (deleted < MESSAGES_COMPACTION_BATCH) {
+            return 0;
+        }
+
+        nanosleep(&compaction_pause, NULL);
+    }
+}
+
+// releases free pages a few at a time, each step is a short write
+static int vacuum_free_pages(sqlite3* db)
+{
+    char vacuum_sql[64];
+    snprintf(vacuum_sql, sizeof(vacuum_sql), "pragma incremental_vacuum(%d);", MESSAGES_VACUUM_PAGES_STEP);
+
+    while (1) {
+        int free_pages = 0;
+        if (query_pragma_int(db, "pragma freelist_count;", &free_pages)) {
+            return -1;
+        }
+        if (free_pages == 0) {
+            return 0;
+        }
+
+        if (exec_compactor_sql(db, vacuum_sql)) {
+            return -1;
+        }
+
+        nanosleep(&compaction_pause, NULL);
+    }
+}
+
+static void* messages_compactor_worker(void* data)
+{
+    sqlite3* db = data;
+
+    // databases created before incremental auto vacuum keep
+    // free pages for reuse, switching them needs full vacuum
+    int auto_vacuum = 0;
+    if (query_pragma_int(db, "pragma auto_vacuum;", &auto_vacuum)) {
+        LogErr("Compactor cant read auto vacuum mode");
+    }
+    if (auto_vacuum != 2) {
+        LogWarn("Database is not in incremental auto vacuum mode, free pages stay in file");
+    }
+
+    while (1) {
+        int purged = 0;
+        if (purge_deleted_messages(db, time(NULL) - MESSAGES_DELETED_RETENTION_SEC, &purged)) {
+            LogWarn("Compactor failed to purge deleted messages");
+        } else if (purged > 0) {
+            LogInfo("Compactor purged %d deleted messages", purged);
+        }
+
+        if (auto_vacuum == 2 && vacuum_free_pages(db)) {
+            LogWarn("Compactor failed to vacuum free pages");
+        }
+
+        sleep(MESSAGES_COMPACTION_INTERVAL_SEC);
+    }
+
+    return NULL;
+}
+
+int start_messages_compactor(const char* db_path)
+{
+    if (!db_path) {
+        return -1;
+    }
+
+    sqlite3* db = NULL;
+    if (sqlite3_open_v2(db_path, &db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK) {
+        LogErr("Cant open connection for messages compactor: %s", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return -1;
+    }
+
+    // checkpoints belong to wal checkpointer; ids of purged
+    // batch are kept in connection's own temp table
+    if (exec_compactor_sql(db, "pragma busy_timeout = 5000; pragma wal_autocheckpoint = 0; pragma temp_store = memory;")
+        || exec_compactor_sql(db, "CREATE TEMP TABLE compaction_batch (id INTEGER PRIMARY KEY);")) {
+        sqlite3_close(db);
+        return -1;
+    }
+
+    pthread_t thrd;
+    if (pthread_create(&thrd, NULL, messages_compactor_worker, db)) {
+        LogErr("Cant create messages compactor thread");
+        sqlite3_close(db);
+        return -1;
+    }
+    pthread_detach(thrd);
+
+    LogInfo("Messages compactor started for '%s'", db_path);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef MESSAGES_COMPACTOR_H
+#define MESSAGES_COMPACTOR_H
+
+// soft deleted messages are kept this long before purge
+#define MESSAGES_DELETED_RETENTION_SEC (24 * 60 * 60)
+#define MESSAGES_COMPACTION_INTERVAL_SEC 60
+// rows purged per transaction
+#define MESSAGES_COMPACTION_BATCH 200
+// free pages released to filesystem per incremental vacuum step
+#define MESSAGES_VACUUM_PAGES_STEP 64
+// pause between batches and vacuum steps, bounds compactor io rate
+#define MESSAGES_COMPACTION_PAUSE_MS 50
+
+// opens own connection to db_path and starts detached thread which
+// purges soft deleted messages and gives free pages back to filesystem,
+// called once per database file with messages
+int start_messages_compactor(const char* db_path);
+
+#endif
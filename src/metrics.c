@@ -0,0 +1,85 @@
+#include "metrics.h"
+#include "compression.h"
+#include "log.h"
+#include "read_receipts.h"
+#include "typing_events.h"
+#include "wal_checkpointer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// one line per database file, lines of one metric stay together
+#define WAL_METRIC(name, fmt, member)                                                    \
+    for (size_t i = 0; i < wal_len; i++) {                                               \
+        fprintf(out, name "{db=\"%s\"} " fmt "\n", wal[i].db_name, wal[i].member);       \
+    }
+
+static void write_wal_metrics(FILE* out, const WalCheckpointerStats* wal, size_t wal_len)
+{
+    for (size_t i = 0; i < wal_len; i++) {
+        fprintf(out, "trinity_wal_checkpoints_total{db=\"%s\",mode=\"passive\"} %zu\n", wal[i].db_name, wal[i].passive_checkpoints);
+        fprintf(out, "trinity_wal_checkpoints_total{db=\"%s\",mode=\"truncate\"} %zu\n", wal[i].db_name, wal[i].truncate_checkpoints);
+    }
+    WAL_METRIC("trinity_wal_checkpoint_failures_total", "%zu", failed_checkpoints)
+    WAL_METRIC("trinity_wal_checkpoint_duration_ms_last", "%.3f", last_duration_ms)
+    WAL_METRIC("trinity_wal_checkpoint_duration_ms_max", "%.3f", max_duration_ms)
+    WAL_METRIC("trinity_wal_checkpoint_duration_ms_sum", "%.3f", total_duration_ms)
+    WAL_METRIC("trinity_wal_frames", "%d", last_wal_frames)
+}
+
+// prometheus text exposition format
+int metrics_route(HttpRequest* req, HttpResponse* res)
+{
+    LogInfo("metrics_route executed");
+
+    WalCheckpointerStats wal[WAL_CHECKPOINTERS_MAX];
+    size_t wal_len = get_wal_checkpointer_stats(wal);
+
+    ReadReceiptsStats read = { 0 };
+    get_read_receipts_stats(&read);
+
+    TypingEventsStats typing = { 0 };
+    get_typing_events_stats(&typing);
+
+    CompressionStats compression = { 0 };
+    get_compression_stats(&compression);
+
+    char* body = NULL;
+    size_t body_len = 0;
+    FILE* out = open_memstream(&body, &body_len);
+    if (!out) {
+        LogErr("Cant open metrics stream");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    write_wal_metrics(out, wal, wal_len);
+    fprintf(out,
+        "trinity_read_marks_total %zu\n"
+        "trinity_read_watermark_writes_total %zu\n"
+        "trinity_read_watermark_failed_flushes_total %zu\n"
+        "trinity_typing_events_total %zu\n"
+        "trinity_typing_coalesced_total %zu\n"
+        "trinity_typing_rate_limited_total %zu\n"
+        "trinity_compressed_responses_total %zu\n"
+        "trinity_compression_input_bytes_total %zu\n"
+        "trinity_compression_output_bytes_total %zu\n",
+        read.marks,
+        read.watermark_writes,
+        read.failed_flushes,
+        typing.published,
+        typing.coalesced,
+        typing.rate_limited,
+        compression.responses,
+        compression.input_bytes,
+        compression.output_bytes);
+    if (fclose(out) || !body) {
+        LogErr("Cant format metrics");
+        free(body);
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    create_http_response_adopt_body(res, "200", (const char*[]) { "Content-Type: text/plain; version=0.0.4" }, 1, body, body_len);
+
+    return 0;
+}
@@ -0,0 +1,8 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "http.h"
+
+int metrics_route(HttpRequest* req, HttpResponse* res);
+
+#endif
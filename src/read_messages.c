@@ -0,0 +1,49 @@
+#include "read_messages.h"
+#include "db.h"
+#include "json_reader.h"
+#include "log.h"
+#include "read_receipts.h"
+#include <stdlib.h>
+
+#define READ_MESSAGES_INPUT_FIELDS(FIELD) \
+    FIELD(ReadMessagesInput, session_key, string) \
+    FIELD(ReadMessagesInput, uuid, string)
+
+JSON_DECODER(parse_json_to_read_messages_input, ReadMessagesInput, READ_MESSAGES_INPUT_FIELDS)
+
+int read_messages_route(HttpRequest* req, HttpResponse* res)
+{
+    LogInfo("read_messages_route executed");
+
+    ReadMessagesInput input;
+    if (parse_json_to_read_messages_input(req->body_len, req->body, &input)) {
+        LogErr("Incorrect Json on Input: %zu bytes", req->body_len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    int user_id;
+    if (get_user_id_by_session_key(input.session_key, &user_id)) {
+        LogErr("Cant find such session key in db: session_key = '%s'", input.session_key);
+        create_http_response(res, "403", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    ReadWatermark wm;
+    if (get_received_message_read_watermark(user_id, input.uuid, &wm)) {
+        LogErr("Cant find received message: uuid = '%s'", input.uuid);
+        create_http_response(res, "404", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    // written to db and announced to sender by read receipts flusher
+    if (mark_messages_read(&wm, input.uuid)) {
+        LogErr("Cant mark messages as read: uuid = '%s'", input.uuid);
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    create_http_response_static_body(res, "200", NULL, 0, HTTP_LITERAL_BODY("messages read"));
+
+    return 0;
+}
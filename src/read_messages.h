@@ -0,0 +1,18 @@
+#ifndef READ_MESSAGES_H
+#define READ_MESSAGES_H
+
+#include "http.h"
+
+// fields point into json parsed by parse_json_to_read_messages_input,
+// valid as long as it is and never freed
+typedef struct {
+    char* session_key;
+    char* uuid; // last read message
+} ReadMessagesInput;
+
+// parses json in place, see json_read_insitu
+int parse_json_to_read_messages_input(size_t json_len, char json[json_len], ReadMessagesInput* model);
+
+int read_messages_route(HttpRequest* req, HttpResponse* res);
+
+#endif
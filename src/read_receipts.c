@@ -0,0 +1,168 @@
+#include "read_receipts.h"
+#include "event_bus.h"
+#include "events.h"
+#include "log.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    ReadWatermark wm;
+    char message_uuid[UUID4_LEN];
+    time_t read_at;
+} PendingReadMark;
+
+// marks of the current interval, one per conversation; few readers
+// are active within one interval, so linear lookup is enough
+static PendingReadMark* pending_marks = NULL;
+static size_t pending_marks_len = 0;
+static size_t pending_marks_capacity = 0;
+static ReadReceiptsStats read_receipts_stats = { 0 };
+static pthread_mutex_t read_receipts_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int mark_messages_read(const ReadWatermark* wm, const char* message_uuid)
+{
+    if (!wm || !message_uuid) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&read_receipts_mutex);
+    read_receipts_stats.marks++;
+
+    for (size_t i = 0; i < pending_marks_len; i++) {
+        PendingReadMark* mark = &pending_marks[i];
+        if (mark->wm.user_id != wm->user_id || mark->wm.peer_id != wm->peer_id) {
+            continue;
+        }
+
+        // scrolling back does not move watermark back
+        if (wm->message_id > mark->wm.message_id) {
+            mark->wm = *wm;
+            strncpy(mark->message_uuid, message_uuid, UUID4_LEN);
+            mark->message_uuid[UUID4_LEN - 1] = '\0';
+            mark->read_at = time(NULL);
+        }
+        pthread_mutex_unlock(&read_receipts_mutex);
+        return 0;
+    }
+
+    if (pending_marks_len == pending_marks_capacity) {
+        size_t new_capacity = pending_marks_capacity ? pending_marks_capacity * 2 : 16;
+        PendingReadMark* new_marks = realloc(pending_marks, new_capacity * sizeof(PendingReadMark));
+        if (!new_marks) {
+            LogErr("Cant grow pending read marks");
+            pthread_mutex_unlock(&read_receipts_mutex);
+            return -1;
+        }
+        pending_marks = new_marks;
+        pending_marks_capacity = new_capacity;
+    }
+
+    PendingReadMark* mark = &pending_marks[pending_marks_len++];
+    mark->wm = *wm;
+    strncpy(mark->message_uuid, message_uuid, UUID4_LEN);
+    mark->message_uuid[UUID4_LEN - 1] = '\0';
+    mark->read_at = time(NULL);
+
+    pthread_mutex_unlock(&read_receipts_mutex);
+    return 0;
+}
+
+static void publish_read_receipt(const PendingReadMark* mark)
+{
+    char reader_uuid[UUID4_LEN];
+    if (get_user_uuid_by_id(mark->wm.user_id, reader_uuid)) {
+        LogErr("Cant find uuid of reader: user_id = %d", mark->wm.user_id);
+        return;
+    }
+
+    EventReadReceipt ev;
+    if (create_event_read_receipt(&ev, reader_uuid, mark->message_uuid, mark->read_at)) {
+        LogErr("Cant create read receipt event");
+        return;
+    }
+
+    // bus queues own copies of the event
+    if (add_new_event_to_queue_by_user_id(global_event_bus, mark->wm.peer_id, (EventBase*)&ev)) {
+        LogTrace("Sender of read messages is not connected: user_id = %d", mark->wm.peer_id);
+    }
+}
+
+static void flush_read_marks(void)
+{
+    pthread_mutex_lock(&read_receipts_mutex);
+    PendingReadMark* marks = pending_marks;
+    size_t marks_len = pending_marks_len;
+    pending_marks = NULL;
+    pending_marks_len = 0;
+    pending_marks_capacity = 0;
+    pthread_mutex_unlock(&read_receipts_mutex);
+
+    if (marks_len == 0) {
+        free(marks);
+        return;
+    }
+
+    ReadWatermark* wms = malloc(marks_len * sizeof(ReadWatermark));
+    if (!wms) {
+        LogErr("Cant alloc read watermarks for flush");
+        free(marks);
+        return;
+    }
+    for (size_t i = 0; i < marks_len; i++) {
+        wms[i] = marks[i].wm;
+    }
+
+    int failed = save_read_watermarks(wms, marks_len);
+    if (failed) {
+        LogWarn("Failed to save some of %zu read watermarks", marks_len);
+    }
+
+    pthread_mutex_lock(&read_receipts_mutex);
+    read_receipts_stats.watermark_writes += marks_len;
+    read_receipts_stats.failed_flushes += failed != 0;
+    pthread_mutex_unlock(&read_receipts_mutex);
+
+    for (size_t i = 0; i < marks_len; i++) {
+        publish_read_receipt(&marks[i]);
+    }
+
+    free(wms);
+    free(marks);
+}
+
+static void* read_receipts_flusher_worker(void* _)
+{
+    const struct timespec interval = {
+        .tv_sec = READ_RECEIPTS_FLUSH_INTERVAL_MS / 1000,
+        .tv_nsec = (READ_RECEIPTS_FLUSH_INTERVAL_MS % 1000) * 1000000L,
+    };
+
+    while (1) {
+        nanosleep(&interval, NULL);
+        flush_read_marks();
+    }
+
+    return NULL;
+}
+
+int start_read_receipts_flusher(void)
+{
+    pthread_t thrd;
+    if (pthread_create(&thrd, NULL, read_receipts_flusher_worker, NULL)) {
+        LogErr("Cant create read receipts flusher thread");
+        return -1;
+    }
+    pthread_detach(thrd);
+
+    LogInfo("Read receipts flusher started");
+    return 0;
+}
+
+void get_read_receipts_stats(ReadReceiptsStats* stats)
+{
+    pthread_mutex_lock(&read_receipts_mutex);
+    *stats = read_receipts_stats;
+    pthread_mutex_unlock(&read_receipts_mutex);
+}
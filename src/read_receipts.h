@@ -0,0 +1,24 @@
+#ifndef READ_RECEIPTS_H
+#define READ_RECEIPTS_H
+
+#include "db.h"
+
+// read watermarks are kept in memory for this long before one
+// write per conversation and one receipt per conversation
+#define READ_RECEIPTS_FLUSH_INTERVAL_MS 1000
+
+typedef struct {
+    size_t marks; // /messages/read calls accepted
+    size_t watermark_writes; // conversation rows written by flusher
+    size_t failed_flushes;
+} ReadReceiptsStats;
+
+// starts detached thread which flushes coalesced watermarks
+int start_read_receipts_flusher(void);
+
+// keeps the newest watermark of conversation until next flush
+int mark_messages_read(const ReadWatermark* wm, const char* message_uuid);
+
+void get_read_receipts_stats(ReadReceiptsStats* stats);
+
+#endif
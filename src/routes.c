@@ -1,12 +1,24 @@
 #include "routes.h"
+#include "add_group_message.h"
 #include "add_message.h"
+#include "add_messages_batch.h"
 #include "auth_user.h"
+#include "create_group.h"
 #include "create_user.h"
+#include "delete_message.h"
+#include "edit_message.h"
 #include "event_subcribe.h"
 #include "get_contacts.h"
+#include "get_group_messages.h"
 #include "get_messages.h"
+#include "get_presence.h"
 #include "http.h"
 #include "log.h"
+#include "metrics.h"
+#include "read_messages.h"
+#include "search_messages.h"
+#include "send_typing.h"
+#include "sync_messages.h"
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h> // for close
@@ -26,15 +38,27 @@ int exec_route_by_path(HttpRequest* req, HttpResponse* res)
     if (strcmp(req->method, "OPTIONS") == 0) {
 
         LogInfo("cors request");
-        create_http_response(res, "200", NULL, 0, NULL);
+        create_http_response(res, "200", NULL, 0, NULL, 0);
         return 0;
     }
 
     int rc = strcmp(path, "/register") == 0 ? create_user_route(req, res) : strcmp(path, "/login") == 0 ? auth_user_route(req, res)
         : strcmp(path, "/send") == 0                                                                       ? add_message_route(req, res)
+        : strcmp(path, "/send/batch") == 0                                                                 ? add_messages_batch_route(req, res)
         : strcmp(path, "/events/subscribe") == 0                                                           ? event_subcribe_route(req, res)
         : strcmp(path, "/contacts") == 0                                                                   ? get_contacts_route(req, res)
-        : strcmp(path, "/messages") == 0                                                                   ? get_messages_route(req, res) : -255;
+        : strcmp(path, "/messages") == 0                                                                   ? get_messages_route(req, res)
+        : strcmp(path, "/messages/search") == 0                                                            ? search_messages_route(req, res)
+        : strcmp(path, "/messages/delete") == 0                                                            ? delete_message_route(req, res)
+        : strcmp(path, "/messages/edit") == 0                                                              ? edit_message_route(req, res)
+        : strcmp(path, "/messages/read") == 0                                                              ? read_messages_route(req, res)
+        : strcmp(path, "/typing") == 0                                                                     ? send_typing_route(req, res)
+        : strcmp(path, "/presence") == 0                                                                   ? get_presence_route(req, res)
+        : strcmp(path, "/groups/create") == 0                                                              ? create_group_route(req, res)
+        : strcmp(path, "/groups/send") == 0                                                                ? add_group_message_route(req, res)
+        : strcmp(path, "/groups/messages") == 0                                                            ? get_group_messages_route(req, res)
+        : strcmp(path, "/sync") == 0                                                                       ? sync_messages_route(req, res)
+        : strcmp(path, "/metrics") == 0                                                                    ? metrics_route(req, res) : -255;
 
     free(path);
     return rc;
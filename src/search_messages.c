@@ -0,0 +1,163 @@
+#include "search_messages.h"
+#include "db.h"
+#include "json_writer.h"
+#include "log.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void free_search_messages_input(SearchMessagesInput* self)
+{
+    if (!self)
+        return;
+    free(self->session_key);
+    free(self->query);
+}
+
+int parse_url_params_to_search_messages_input(const char* path, SearchMessagesInput* model)
+{
+    if (!path || !model) {
+        return -1; // Invalid input
+    }
+
+    model->session_key = NULL;
+    model->query = NULL;
+    model->limit = 0;
+    model->offset = 0;
+
+    const char* query_start = strchr(path, '?');
+    if (!query_start) {
+        return -1; // No query parameters found
+    }
+    query_start++; // Move past the '?' character
+
+    const char* current = query_start;
+    while (*current) {
+        const char* key_end = strchr(current, '=');
+        if (!key_end) {
+            break; // Malformed query string
+        }
+
+        size_t key_len = key_end - current;
+        if (key_len >= SEARCH_MAX_PARAM_LENGTH) {
+            return -1; // Key too long
+        }
+
+        char param[SEARCH_MAX_PARAM_LENGTH];
+        memcpy(param, current, key_len);
+        param[key_len] = '\0';
+
+        const char* value_start = key_end + 1;
+        const char* value_end = strchr(value_start, '&');
+        if (!value_end) {
+            value_end = value_start + strlen(value_start);
+        }
+
+        size_t value_len = value_end - value_start;
+        if (value_len >= SEARCH_MAX_PARAM_LENGTH) {
+            return -1; // Value too long
+        }
+
+        char value[SEARCH_MAX_PARAM_LENGTH];
+        memcpy(value, value_start, value_len);
+        value[value_len] = '\0';
+
+        if (url_decode(value)) {
+            return -1; // Malformed escape
+        }
+
+        if (strcmp(param, "session_key") == 0) {
+            free(model->session_key);
+            model->session_key = strdup(value);
+        } else if (strcmp(param, "q") == 0) {
+            free(model->query);
+            model->query = strdup(value);
+        } else if (strcmp(param, "limit") == 0) {
+            model->limit = atoi(value);
+        } else if (strcmp(param, "offset") == 0) {
+            model->offset = atoi(value);
+        }
+
+        current = value_end;
+        if (*current == '&') {
+            current++; // Move past the '&' character
+        }
+    }
+
+    if (!model->session_key || !model->query) {
+        return -1; // session_key and q are mandatory
+    }
+
+    return 0; // Success
+}
+
+int search_messages_route(HttpRequest* req, HttpResponse* res)
+{
+    LogInfo("search_messages_route executed");
+
+    SearchMessagesInput input = { 0 };
+    if (parse_url_params_to_search_messages_input(req->path, &input)) {
+        LogErr("Incorrect URL params on Input: URL = '%s'", req->path);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        free_search_messages_input(&input);
+        return 0;
+    }
+
+    if (input.limit <= 0 || input.offset < 0) {
+        LogErr("Invalid input parameters: limit = %d, offset = %d", input.limit, input.offset);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        free_search_messages_input(&input);
+        return 0;
+    }
+
+    MessageSearchResult* msgs = NULL;
+    size_t msgs_len = 0;
+    if (search_messages_by_user_id_from_session_key(
+            input.session_key, input.query, input.offset, input.limit, &msgs, &msgs_len)
+        != EXIT_SUCCESS) {
+        LogErr("Failed to search messages in database.");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        free_search_messages_input(&input);
+        return 0;
+    }
+
+    free_search_messages_input(&input);
+
+    // Build the JSON response
+    JsonWriter w;
+    json_writer_init(&w, 64 + msgs_len * 192);
+    json_writer_begin_array(&w);
+    for (size_t i = 0; i < msgs_len; i++) {
+        json_writer_begin_object(&w);
+        json_writer_key(&w, "uuid");
+        json_writer_string(&w, msgs[i].uuid);
+        json_writer_key(&w, "sender_uuid");
+        json_writer_string(&w, msgs[i].sender_uuid);
+        json_writer_key(&w, "receiver_uuid");
+        json_writer_string(&w, msgs[i].receiver_uuid);
+        json_writer_key(&w, "data");
+        json_writer_string(&w, msgs[i].data);
+        json_writer_key(&w, "created_at");
+        json_writer_int(&w, msgs[i].created_at);
+        json_writer_key(&w, "updated_at");
+        json_writer_int(&w, msgs[i].updated_at);
+        json_writer_end_object(&w);
+    }
+    json_writer_end_array(&w);
+
+    size_t json_len = 0;
+    char* json_response = json_writer_finish(&w, &json_len);
+    if (!json_response) {
+        LogErr("Memory allocation for JSON response failed.");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        free_message_search_results(msgs, msgs_len);
+        return 0;
+    }
+
+    create_http_response_adopt_body(res, "200", NULL, 0, json_response, json_len);
+
+    free_message_search_results(msgs, msgs_len);
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef SEARCH_MESSAGES_H
+#define SEARCH_MESSAGES_H
+
+#include "http.h"
+
+#define SEARCH_MAX_PARAM_LENGTH 256
+
+typedef struct {
+    char* session_key;
+    char* query;
+    int limit;
+    int offset;
+} SearchMessagesInput;
+
+void free_search_messages_input(SearchMessagesInput* self);
+int parse_url_params_to_search_messages_input(const char* path, SearchMessagesInput* model);
+
+int search_messages_route(HttpRequest* req, HttpResponse* res);
+
+#endif
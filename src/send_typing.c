@@ -0,0 +1,58 @@
+#include "send_typing.h"
+#include "db.h"
+#include "json_reader.h"
+#include "log.h"
+#include "typing_events.h"
+#include <stdlib.h>
+
+#define SEND_TYPING_INPUT_FIELDS(FIELD) \
+    FIELD(SendTypingInput, session_key, string) \
+    FIELD(SendTypingInput, receiver_uuid, string)
+
+JSON_DECODER(parse_json_to_send_typing_input, SendTypingInput, SEND_TYPING_INPUT_FIELDS)
+
+int send_typing_route(HttpRequest* req, HttpResponse* res)
+{
+    LogInfo("send_typing_route executed");
+
+    SendTypingInput input;
+    if (parse_json_to_send_typing_input(req->body_len, req->body, &input)) {
+        LogErr("Incorrect Json on Input: %zu bytes", req->body_len);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    int user_id;
+    if (get_user_id_by_session_key(input.session_key, &user_id)) {
+        LogErr("Cant find such session key in db: session_key = '%s'", input.session_key);
+        create_http_response(res, "403", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+    int receiver_id;
+    if (get_user_id_by_uuid(input.receiver_uuid, &receiver_id)) {
+        LogErr("Cant find such receiver uuid in db: uuid = '%s'", input.receiver_uuid);
+        create_http_response(res, "404", NULL, 0, NULL, 0);
+        return 0;
+    }
+
+
+    // coalesced pings and offline receivers are fine for client,
+    // indicator is best effort anyway
+    switch (publish_typing_event(user_id, receiver_id)) {
+    case TypingPublished:
+    case TypingCoalesced:
+    case TypingReceiverOffline:
+        create_http_response_static_body(res, "200", NULL, 0, HTTP_LITERAL_BODY("typing sent"));
+        break;
+    case TypingRateLimited:
+        LogWarn("Typing pings rate limited: user_id = %d", user_id);
+        create_http_response(res, "429", NULL, 0, NULL, 0);
+        break;
+    default:
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        break;
+    }
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef SEND_TYPING_H
+#define SEND_TYPING_H
+
+#include "http.h"
+
+// fields point into json parsed by parse_json_to_send_typing_input,
+// valid as long as it is and never freed
+typedef struct {
+    char* session_key;
+    char* receiver_uuid;
+} SendTypingInput;
+
+// parses json in place, see json_read_insitu
+int parse_json_to_send_typing_input(size_t json_len, char json[json_len], SendTypingInput* model);
+
+int send_typing_route(HttpRequest* req, HttpResponse* res);
+
+#endif
@@ -1,64 +1,224 @@
 #include "sqlite_connection_pool.h"
 #include "log.h"
+#include "trinity.h"
+#include <stdio.h>
+
+// per connection pragmas, sqlite forgets them on every open
+// so they cant live in db schema which runs only once
+static const char connection_pragmas[] = STR(
+    pragma busy_timeout = 5000;
+    pragma cache_size = -16000;
+    pragma mmap_size = 30000000000;
+    pragma temp_store = memory;);
+
+// checkpoints are done by wal checkpointer thread,
+// not inside of request which commit crossed the threshold
+static const char writer_pragmas[] = STR(
+    pragma synchronous = normal;
+    pragma journal_size_limit = 6144000;
+    pragma wal_autocheckpoint = 0;);
+
+static const char reader_pragmas[] = STR(
+    pragma query_only = 1;);
+
+static int exec_pragmas(sqlite3* db, const char* pragmas)
+{
+    char* err_msg = NULL;
+    if (sqlite3_exec(db, pragmas, NULL, NULL, &err_msg) != SQLITE_OK) {
+        LogErr("Error applying connection pragmas: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    return 0;
+}
+
+static int attach_global_db(sqlite3* db, const char* global_db_path)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "ATTACH DATABASE ? AS global;", -1, &stmt, NULL) != SQLITE_OK) {
+        LogErr("Error preparing attach: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sqlite3_bind_text(stmt, 1, global_db_path, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogErr("Error attaching global database: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int open_connection(sqlite3** db, const char* db_path, const char* global_db_path, int flags, const char* pragmas)
+{
+    if (sqlite3_open_v2(db_path, db, flags, NULL) != SQLITE_OK) {
+        LogErr("Error opening SQLite database: %s\n", sqlite3_errmsg(*db));
+        return -1;
+    }
+
+    if (exec_pragmas(*db, connection_pragmas)
+        || exec_pragmas(*db, pragmas)) {
+        return -1;
+    }
+
+    if (global_db_path && attach_global_db(*db, global_db_path)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int open_connection_set(
+    SQLiteConnectionSet* set, size_t len, const char* db_path,
+    const char* global_db_path, int flags, const char* pragmas)
+{
+    pthread_cond_init(&set->cond, NULL);
+    set->len = len;
+
+    for (size_t i = 0; i < set->len; i++) {
+        set->in_use[i] = 0;
+        if (open_connection(&set->connections[i], db_path, global_db_path, flags, pragmas)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void close_connection_set(SQLiteConnectionSet* set)
+{
+    for (size_t i = 0; i < set->len; i++) {
+        if (set->connections[i]) {
+            sqlite3_close(set->connections[i]);
+            set->connections[i] = NULL;
+        }
+    }
+    pthread_cond_destroy(&set->cond);
+}
 
 // Function to initialize the connection pool
-int init_sqlite_connection_pool(SQLiteConnectionPool* pool, const char* db_path)
+int init_sqlite_connection_pool(SQLiteConnectionPool* pool, const char* db_path, const char* global_db_path)
 {
     if (!pool || !db_path) {
         return -1;
     }
 
     pthread_mutex_init(&pool->mutex, NULL);
-    pthread_cond_init(&pool->cond, NULL);
+    snprintf(pool->db_path, sizeof(pool->db_path), "%s", db_path);
+    snprintf(pool->global_db_path, sizeof(pool->global_db_path), "%s", global_db_path ? global_db_path : "");
 
-    for (int i = 0; i < SQLITE_CONN_POOL_SIZE; i++) {
-        if (sqlite3_open(db_path, &pool->connections[i]) != SQLITE_OK) {
-            LogErr("Error opening SQLite database: %s\n", sqlite3_errmsg(pool->connections[i]));
-            return -1;
-        }
-        pool->in_use[i] = 0;
+    // writers are opened first so database file exists
+    // before read only connections try to open it
+    if (open_connection_set(
+            &pool->writers, SQLITE_CONN_POOL_WRITERS, db_path, global_db_path,
+            SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, writer_pragmas)) {
+        return -1;
+    }
+
+    if (open_connection_set(
+            &pool->readers, SQLITE_CONN_POOL_READERS, db_path, global_db_path,
+            SQLITE_OPEN_READONLY, reader_pragmas)) {
+        return -1;
     }
 
     return 0;
 }
 
 // Function to get a connection from the pool
-sqlite3* sqlite_get_connection(SQLiteConnectionPool* pool)
+sqlite3* sqlite_get_connection(SQLiteConnectionPool* pool, SQLiteConnIntent intent)
 {
+    SQLiteConnectionSet* set = intent == SQLiteConnWrite ? &pool->writers : &pool->readers;
+
     pthread_mutex_lock(&pool->mutex);
 
-    LogTrace("getting connection from pool");
+    LogTrace("getting %s connection from pool", intent == SQLiteConnWrite ? "write" : "read");
     while (1) {
-        for (int i = 0; i < SQLITE_CONN_POOL_SIZE; i++) {
-            LogTrace("check for connection %d access: in_use = %d", i, pool->in_use[i]);
-            if (!pool->in_use[i]) {
-                LogTrace("connection %d free", i);
-                pool->in_use[i] = 1;
+        for (size_t i = 0; i < set->len; i++) {
+            LogTrace("check for connection %zu access: in_use = %d", i, set->in_use[i]);
+            if (!set->in_use[i]) {
+                LogTrace("connection %zu free", i);
+                set->in_use[i] = 1;
                 pthread_mutex_unlock(&pool->mutex);
-                return pool->connections[i];
+                return set->connections[i];
             }
         }
         // Wait for a connection to become available
-        pthread_cond_wait(&pool->cond, &pool->mutex);
+        pthread_cond_wait(&set->cond, &pool->mutex);
         LogTrace("condition");
     }
 }
 
+static int release_connection_in_set(SQLiteConnectionSet* set, sqlite3* connection)
+{
+    for (size_t i = 0; i < set->len; i++) {
+        if (set->connections[i] == connection) {
+            set->in_use[i] = 0;
+            LogTrace("sending condition");
+            pthread_cond_signal(&set->cond);
+            return 1;
+        }
+    }
+    return 0;
+}
+
 // Function to release a connection back to the pool
 void sqlite_release_connection(SQLiteConnectionPool* pool, sqlite3* connection)
 {
     pthread_mutex_lock(&pool->mutex);
 
     LogTrace("condition release");
-    for (int i = 0; i < SQLITE_CONN_POOL_SIZE; i++) {
-        if (pool->connections[i] == connection) {
-            pool->in_use[i] = 0;
-            break;
+    if (!release_connection_in_set(&pool->readers, connection)) {
+        release_connection_in_set(&pool->writers, connection);
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void sqlite_discard_connection(SQLiteConnectionPool* pool, sqlite3* connection)
+{
+    pthread_mutex_lock(&pool->mutex);
+
+    int is_writer = 0;
+    SQLiteConnectionSet* set = &pool->readers;
+    size_t i = 0;
+    while (i < set->len && set->connections[i] != connection) {
+        i++;
+    }
+    if (i == set->len) {
+        is_writer = 1;
+        set = &pool->writers;
+        i = 0;
+        while (i < set->len && set->connections[i] != connection) {
+            i++;
         }
     }
+    if (i == set->len) {
+        LogErr("Discarded connection is not from this pool");
+        pthread_mutex_unlock(&pool->mutex);
+        return;
+    }
+
+    sqlite3_close_v2(connection);
+    set->connections[i] = NULL;
+
+    const char* global_db_path = pool->global_db_path[0] ? pool->global_db_path : NULL;
+    int opened = is_writer
+        ? open_connection(&set->connections[i], pool->db_path, global_db_path,
+              SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, writer_pragmas)
+        : open_connection(&set->connections[i], pool->db_path, global_db_path,
+              SQLITE_OPEN_READONLY, reader_pragmas);
+    if (opened) {
+        // slot stays taken, pool just runs with one connection less
+        sqlite3_close_v2(set->connections[i]);
+        set->connections[i] = NULL;
+        LogErr("Cant reopen discarded %s connection", is_writer ? "write" : "read");
+    } else {
+        set->in_use[i] = 0;
+        pthread_cond_signal(&set->cond);
+    }
 
-    LogTrace("sending condition");
-    pthread_cond_signal(&pool->cond);
     pthread_mutex_unlock(&pool->mutex);
 }
 
@@ -67,14 +227,9 @@ void sqlite_destroy_connection_pool(SQLiteConnectionPool* pool)
 {
     pthread_mutex_lock(&pool->mutex);
 
-    for (int i = 0; i < SQLITE_CONN_POOL_SIZE; i++) {
-        if (pool->connections[i]) {
-            sqlite3_close(pool->connections[i]);
-            pool->connections[i] = NULL;
-        }
-    }
+    close_connection_set(&pool->readers);
+    close_connection_set(&pool->writers);
 
     pthread_mutex_unlock(&pool->mutex);
     pthread_mutex_destroy(&pool->mutex);
-    pthread_cond_destroy(&pool->cond);
 }
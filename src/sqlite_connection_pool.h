@@ -4,19 +4,47 @@
 #include "sqlite3.h"
 #include "trinity.h"
 #include <pthread.h>
+#include <stddef.h>
 
-#define SQLITE_CONN_POOL_SIZE NUM_THREADS
+// writes are serialized by sqlite anyway, so only a few
+// writer connections are kept and readers never wait on them
+#define SQLITE_CONN_POOL_WRITERS 1
+#define SQLITE_CONN_POOL_READERS NUM_THREADS
+
+#define SQLITE_CONN_POOL_MAX_SET_SIZE                          \
+    (SQLITE_CONN_POOL_WRITERS > SQLITE_CONN_POOL_READERS       \
+            ? SQLITE_CONN_POOL_WRITERS                         \
+            : SQLITE_CONN_POOL_READERS)
+
+typedef enum {
+    SQLiteConnRead,
+    SQLiteConnWrite,
+} SQLiteConnIntent;
 
 typedef struct {
-    sqlite3* connections[SQLITE_CONN_POOL_SIZE];
-    int in_use[SQLITE_CONN_POOL_SIZE];
-    pthread_mutex_t mutex;
+    size_t len;
+    sqlite3* connections[SQLITE_CONN_POOL_MAX_SET_SIZE];
+    int in_use[SQLITE_CONN_POOL_MAX_SET_SIZE];
     pthread_cond_t cond;
+} SQLiteConnectionSet;
+
+typedef struct {
+    SQLiteConnectionSet writers;
+    SQLiteConnectionSet readers;
+    pthread_mutex_t mutex;
+    // kept to reopen discarded connections
+    char db_path[256];
+    char global_db_path[256];
 } SQLiteConnectionPool;
 
-int init_sqlite_connection_pool(SQLiteConnectionPool* pool, const char* db_path);
-sqlite3* sqlite_get_connection(SQLiteConnectionPool* pool);
+// global_db_path is attached as "global" to every connection
+// when not NULL, so tables missing in db_path resolve to it
+int init_sqlite_connection_pool(SQLiteConnectionPool* pool, const char* db_path, const char* global_db_path);
+sqlite3* sqlite_get_connection(SQLiteConnectionPool* pool, SQLiteConnIntent intent);
 void sqlite_release_connection(SQLiteConnectionPool* pool, sqlite3* connection);
+// closes connection left in unknown state instead of releasing it,
+// a fresh one with the same settings takes its place in pool
+void sqlite_discard_connection(SQLiteConnectionPool* pool, sqlite3* connection);
 void sqlite_destroy_connection_pool(SQLiteConnectionPool* pool);
 
 #endif
@@ -0,0 +1,268 @@
+#include "sync_messages.h"
+#include "db.h"
+#include "json_writer.h"
+#include "log.h"
+#include "messages_compactor.h"
+#include "utils.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void free_sync_messages_input(SyncMessagesInput* self)
+{
+    if (!self)
+        return;
+    free(self->session_key);
+    free(self->since);
+}
+
+int parse_url_params_to_sync_messages_input(const char* path, SyncMessagesInput* model)
+{
+    if (!path || !model) {
+        return -1; // Invalid input
+    }
+
+    model->session_key = NULL;
+    model->since = NULL;
+
+    const char* query_start = strchr(path, '?');
+    if (!query_start) {
+        return -1; // No query parameters found
+    }
+    query_start++; // Move past the '?' character
+
+    const char* current = query_start;
+    while (*current) {
+        const char* key_end = strchr(current, '=');
+        if (!key_end) {
+            break; // Malformed query string
+        }
+
+        size_t key_len = key_end - current;
+        if (key_len >= SYNC_MAX_PARAM_LENGTH) {
+            return -1; // Key too long
+        }
+
+        char param[SYNC_MAX_PARAM_LENGTH];
+        memcpy(param, current, key_len);
+        param[key_len] = '\0';
+
+        const char* value_start = key_end + 1;
+        const char* value_end = strchr(value_start, '&');
+        if (!value_end) {
+            value_end = value_start + strlen(value_start);
+        }
+
+        size_t value_len = value_end - value_start;
+        if (value_len >= SYNC_MAX_PARAM_LENGTH) {
+            return -1; // Value too long
+        }
+
+        char value[SYNC_MAX_PARAM_LENGTH];
+        memcpy(value, value_start, value_len);
+        value[value_len] = '\0';
+
+        if (url_decode(value)) {
+            return -1; // Malformed escape
+        }
+
+        if (strcmp(param, "session_key") == 0) {
+            free(model->session_key);
+            model->session_key = strdup(value);
+        } else if (strcmp(param, "since") == 0) {
+            free(model->since);
+            model->since = strdup(value);
+        }
+
+        current = value_end;
+        if (*current == '&') {
+            current++; // Move past the '&' character
+        }
+    }
+
+    if (!model->session_key) {
+        return -1; // session_key is mandatory
+    }
+
+    return 0; // Success
+}
+
+static int parse_cursor_number(const char** p, long long* value)
+{
+    if (!isdigit((unsigned char)**p)) {
+        return -1;
+    }
+
+    char* end;
+    errno = 0;
+    long long v = strtoll(*p, &end, 10);
+    if (errno) {
+        return -1;
+    }
+    *value = v;
+    *p = end;
+    return 0;
+}
+
+// cursor is "<last id of every shard, '.' separated>-<changes since>",
+// until has_more drops "-<shard>.<id>.<next changes since>" follows
+// with position of changed pass, shard past last one once it is
+// done; opaque for clients
+static int parse_sync_cursor(const char* cursor, SyncCursor* out, time_t* next_changed_since)
+{
+    const char* p = cursor;
+    long long since = 0;
+    for (int shard = 0; shard < DB_SHARDS; shard++) {
+        if ((shard > 0 && *p++ != '.') || parse_cursor_number(&p, &out->after_ids[shard])) {
+            return -1;
+        }
+    }
+    if (*p++ != '-' || parse_cursor_number(&p, &since)) {
+        return -1;
+    }
+    out->changed_since = since;
+
+    if (*p == '\0') {
+        return 0;
+    }
+
+    long long shard = 0;
+    long long next_since = 0;
+    if (*p++ != '-' || parse_cursor_number(&p, &shard) || shard > DB_SHARDS
+        || *p++ != '.' || parse_cursor_number(&p, &out->changed_after_id)
+        || *p++ != '.' || parse_cursor_number(&p, &next_since) || *p != '\0') {
+        return -1;
+    }
+    out->changed_shard = shard;
+    *next_changed_since = next_since;
+    return 0;
+}
+
+static void format_sync_cursor(
+    char* buf, size_t buf_len, const SyncCursor* cursor, time_t next_changed_since, int has_more)
+{
+    size_t len = 0;
+    for (int shard = 0; shard < DB_SHARDS; shard++) {
+        len += snprintf(buf + len, buf_len - len, shard > 0 ? ".%lld" : "%lld", cursor->after_ids[shard]);
+    }
+
+    // both passes done, next sync looks for changes since this one
+    if (!has_more) {
+        snprintf(buf + len, buf_len - len, "-%lld", (long long)next_changed_since);
+        return;
+    }
+
+    snprintf(
+        buf + len, buf_len - len, "-%lld-%d.%lld.%lld",
+        (long long)cursor->changed_since, cursor->changed_shard,
+        cursor->changed_after_id, (long long)next_changed_since);
+}
+
+int sync_messages_route(HttpRequest* req, HttpResponse* res)
+{
+    LogInfo("sync_messages_route executed");
+
+    SyncMessagesInput input = { 0 };
+    if (parse_url_params_to_sync_messages_input(req->path, &input)) {
+        LogErr("Incorrect URL params on Input: URL = '%s'", req->path);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        free_sync_messages_input(&input);
+        return 0;
+    }
+
+    // next cursor time is taken before reading, so nothing committed
+    // during the read can fall between two syncs; while has_more is
+    // set it stays at time of first page
+    time_t sync_started_at = time(NULL);
+    time_t next_changed_since = sync_started_at - SYNC_CLOCK_SLACK_SEC;
+
+    // no cursor means full resync
+    SyncCursor cursor = { 0 };
+    if (input.since && parse_sync_cursor(input.since, &cursor, &next_changed_since)) {
+        LogErr("Malformed sync cursor: '%s'", input.since);
+        create_http_response(res, "400", NULL, 0, NULL, 0);
+        free_sync_messages_input(&input);
+        return 0;
+    }
+
+    int synced = 0;
+    for (int shard = 0; shard < DB_SHARDS; shard++) {
+        synced |= cursor.after_ids[shard] > 0;
+    }
+
+    // deletions older than retention are purged, client must resync
+    if (synced && cursor.changed_shard < DB_SHARDS && cursor.changed_since < sync_started_at - MESSAGES_DELETED_RETENTION_SEC) {
+        LogWarn("Sync cursor is older than deleted messages retention: '%s'", input.since);
+        create_http_response(res, "410", NULL, 0, NULL, 0);
+        free_sync_messages_input(&input);
+        return 0;
+    }
+
+    SyncMessage* msgs = NULL;
+    size_t msgs_len = 0;
+    int has_more = 0;
+    if (get_sync_messages_by_user_id_from_session_key(
+            input.session_key, &cursor, SYNC_MAX_MESSAGES, &msgs, &msgs_len, &has_more)
+        != EXIT_SUCCESS) {
+        LogErr("Failed to sync messages from database.");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        free_sync_messages_input(&input);
+        return 0;
+    }
+
+    free_sync_messages_input(&input);
+
+    char next_cursor[SYNC_MAX_CURSOR_LENGTH];
+    format_sync_cursor(next_cursor, sizeof(next_cursor), &cursor, next_changed_since, has_more);
+
+    // Build the response in negotiated format
+    WireFormat format = wire_format_from_accept(http_request_get_header(req, "Accept"));
+    JsonWriter w;
+    json_writer_init_format(&w, 128 + msgs_len * 256, format);
+    json_writer_begin_object(&w);
+    json_writer_key(&w, "cursor");
+    json_writer_string(&w, next_cursor);
+    json_writer_key(&w, "has_more");
+    json_writer_bool(&w, has_more);
+    json_writer_key(&w, "msgs");
+    json_writer_begin_array(&w);
+    for (size_t i = 0; i < msgs_len; i++) {
+        json_writer_begin_object(&w);
+        json_writer_key(&w, "uuid");
+        json_writer_string(&w, msgs[i].uuid);
+        json_writer_key(&w, "sender_uuid");
+        json_writer_string(&w, msgs[i].sender_uuid);
+        json_writer_key(&w, "receiver_uuid");
+        json_writer_string(&w, msgs[i].receiver_uuid);
+        json_writer_key(&w, "data");
+        json_writer_string(&w, msgs[i].data);
+        json_writer_key(&w, "created_at");
+        json_writer_int(&w, msgs[i].created_at);
+        json_writer_key(&w, "updated_at");
+        json_writer_int(&w, msgs[i].updated_at);
+        json_writer_key(&w, "deleted_at");
+        json_writer_int(&w, msgs[i].deleted_at);
+        json_writer_end_object(&w);
+    }
+    json_writer_end_array(&w);
+    json_writer_end_object(&w);
+
+    size_t json_len = 0;
+    char* json_response = json_writer_finish(&w, &json_len);
+    if (!json_response) {
+        LogErr("Memory allocation for JSON response failed.");
+        create_http_response(res, "500", NULL, 0, NULL, 0);
+        free_sync_messages(msgs, msgs_len);
+        return 0;
+    }
+
+    create_http_response_adopt_body(
+        res, "200", (const char*[]) { wire_format_content_type_header(format), WIRE_FORMAT_VARY_HEADER }, 2,
+        json_response, json_len);
+
+    free_sync_messages(msgs, msgs_len);
+
+    return 0;
+}
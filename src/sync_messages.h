@@ -0,0 +1,25 @@
+#ifndef SYNC_MESSAGES_H
+#define SYNC_MESSAGES_H
+
+#include "http.h"
+
+// shard ids, time and position of paged changes
+#define SYNC_MAX_CURSOR_LENGTH (DB_SHARDS * 21 + 80)
+#define SYNC_MAX_PARAM_LENGTH (SYNC_MAX_CURSOR_LENGTH > 256 ? SYNC_MAX_CURSOR_LENGTH : 256)
+// messages per response, client follows cursor while has_more
+#define SYNC_MAX_MESSAGES 1000
+// changes stamped before commit may land after cursor was issued,
+// so cursor time looks back this far and a few changes repeat
+#define SYNC_CLOCK_SLACK_SEC 5
+
+typedef struct {
+    char* session_key;
+    char* since;
+} SyncMessagesInput;
+
+void free_sync_messages_input(SyncMessagesInput* self);
+int parse_url_params_to_sync_messages_input(const char* path, SyncMessagesInput* model);
+
+int sync_messages_route(HttpRequest* req, HttpResponse* res);
+
+#endif
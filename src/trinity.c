@@ -1,8 +1,10 @@
 #include "trinity.h"
+#include "compression.h"
 #include "db.h"
 #include "event_bus.h"
 #include "http.h"
 #include "log.h"
+#include "read_receipts.h"
 #include "routes.h"
 #include "sqlite3.h"
 #include "tcp_server.h"
@@ -31,6 +33,7 @@ void client_handler(int client_socket)
     for (size_t i = 0; i < request.headers_len; ++i) {
         LogTrace("%s", request.headers[i]);
     }
+    // routes parse body in place, this is the last point it is intact
     LogTrace("body_len = %lu '%.*s'", request.body_len, (int)request.body_len, request.body);
 
     HttpResponse response = { 0 };
@@ -81,6 +84,18 @@ void client_handler(int client_socket)
         return;
     }
 
+    if (response.streamed) {
+        close(client_socket);
+        free_http_request(&request);
+        free_http_response(&response);
+        return;
+    }
+
+    // uncompressed body is still a valid response
+    if (compress_http_response(&request, &response)) {
+        LogWarn("Response compression failed, sending it as is");
+    }
+
     if (http_response_add_cors_headers(&response)) { 
         perror("Http add cors header to response failed");
         send(client_socket, HTTP_INTERNAL_SERVER_ERROR, sizeof(HTTP_INTERNAL_SERVER_ERROR) - 1, 0);
@@ -141,6 +156,11 @@ int main(void)
         return -1;
     }
 
+    if (start_read_receipts_flusher()) {
+        perror("Error with read receipts flusher");
+        return -1;
+    }
+
     TCPServer server;
 
     // Initialize the server with the user-defined handler
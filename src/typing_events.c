@@ -0,0 +1,170 @@
+#include "typing_events.h"
+#include "db.h"
+#include "event_bus.h"
+#include "events.h"
+#include "log.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+    int sender_id;
+    long long window_start_ms;
+    int pings;
+} TypingSender;
+
+typedef struct {
+    int sender_id;
+    int receiver_id;
+    long long published_at_ms;
+} TypingPair;
+
+// only users typing right now are kept, stale entries are
+// dropped on every ping, so linear lookup is enough
+static TypingSender* typing_senders = NULL;
+static size_t typing_senders_len = 0;
+static size_t typing_senders_capacity = 0;
+static TypingPair* typing_pairs = NULL;
+static size_t typing_pairs_len = 0;
+static size_t typing_pairs_capacity = 0;
+static TypingEventsStats typing_events_stats = { 0 };
+static pthread_mutex_t typing_events_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static long long monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int grow_array(void** arr, size_t* capacity, size_t item_size)
+{
+    size_t new_capacity = *capacity ? *capacity * 2 : 16;
+    void* new_arr = realloc(*arr, new_capacity * item_size);
+    if (!new_arr) {
+        return -1;
+    }
+    *arr = new_arr;
+    *capacity = new_capacity;
+    return 0;
+}
+
+static void drop_stale_typing_entries(long long now_ms)
+{
+    for (size_t i = 0; i < typing_senders_len;) {
+        if (now_ms - typing_senders[i].window_start_ms >= 1000) {
+            typing_senders[i] = typing_senders[--typing_senders_len];
+        } else {
+            i++;
+        }
+    }
+
+    for (size_t i = 0; i < typing_pairs_len;) {
+        if (now_ms - typing_pairs[i].published_at_ms >= TYPING_COALESCE_WINDOW_MS) {
+            typing_pairs[i] = typing_pairs[--typing_pairs_len];
+        } else {
+            i++;
+        }
+    }
+}
+
+// counts ping against sender rate and receiver window,
+// returns TypingPublished if event has to be sent
+static int account_typing_ping(int sender_id, int receiver_id)
+{
+    pthread_mutex_lock(&typing_events_mutex);
+
+    long long now_ms = monotonic_ms();
+    drop_stale_typing_entries(now_ms);
+
+    TypingSender* sender = NULL;
+    for (size_t i = 0; i < typing_senders_len; i++) {
+        if (typing_senders[i].sender_id == sender_id) {
+            sender = &typing_senders[i];
+            break;
+        }
+    }
+
+    if (!sender) {
+        if (typing_senders_len == typing_senders_capacity
+            && grow_array((void**)&typing_senders, &typing_senders_capacity, sizeof(TypingSender))) {
+            pthread_mutex_unlock(&typing_events_mutex);
+            return -1;
+        }
+        sender = &typing_senders[typing_senders_len++];
+        sender->sender_id = sender_id;
+        sender->window_start_ms = now_ms;
+        sender->pings = 0;
+    }
+
+    if (sender->pings >= TYPING_MAX_PINGS_PER_SEC) {
+        typing_events_stats.rate_limited++;
+        pthread_mutex_unlock(&typing_events_mutex);
+        return TypingRateLimited;
+    }
+    sender->pings++;
+
+    for (size_t i = 0; i < typing_pairs_len; i++) {
+        if (typing_pairs[i].sender_id == sender_id && typing_pairs[i].receiver_id == receiver_id) {
+            typing_events_stats.coalesced++;
+            pthread_mutex_unlock(&typing_events_mutex);
+            return TypingCoalesced;
+        }
+    }
+
+    if (typing_pairs_len == typing_pairs_capacity
+        && grow_array((void**)&typing_pairs, &typing_pairs_capacity, sizeof(TypingPair))) {
+        pthread_mutex_unlock(&typing_events_mutex);
+        return -1;
+    }
+    TypingPair* pair = &typing_pairs[typing_pairs_len++];
+    pair->sender_id = sender_id;
+    pair->receiver_id = receiver_id;
+    pair->published_at_ms = now_ms;
+
+    typing_events_stats.published++;
+    pthread_mutex_unlock(&typing_events_mutex);
+    return TypingPublished;
+}
+
+int publish_typing_event(int sender_id, int receiver_id)
+{
+    int result = account_typing_ping(sender_id, receiver_id);
+    if (result != TypingPublished) {
+        if (result < 0) {
+            LogErr("Cant grow typing events state");
+        }
+        return result;
+    }
+
+    // nobody to show indicator to, it is not kept for later
+    if (!is_user_connected_to_event_bus(global_event_bus, receiver_id)) {
+        return TypingReceiverOffline;
+    }
+
+    char sender_uuid[UUID4_LEN];
+    if (get_user_uuid_by_id(sender_id, sender_uuid)) {
+        LogErr("Cant find uuid of typing user: user_id = %d", sender_id);
+        return -1;
+    }
+
+    EventTyping ev;
+    if (create_event_typing(&ev, sender_uuid, time(NULL))) {
+        LogErr("Cant create typing event");
+        return -1;
+    }
+
+    // bus queues own copies of the event
+    if (add_new_event_to_queue_by_user_id(global_event_bus, receiver_id, (EventBase*)&ev)) {
+        return TypingReceiverOffline;
+    }
+
+    return TypingPublished;
+}
+
+void get_typing_events_stats(TypingEventsStats* stats)
+{
+    pthread_mutex_lock(&typing_events_mutex);
+    *stats = typing_events_stats;
+    pthread_mutex_unlock(&typing_events_mutex);
+}
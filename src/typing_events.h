@@ -0,0 +1,31 @@
+#ifndef TYPING_EVENTS_H
+#define TYPING_EVENTS_H
+
+#include <stddef.h>
+
+// repeated typing pings to the same receiver within this window
+// produce only one event
+#define TYPING_COALESCE_WINDOW_MS 3000
+// typing pings one sender may make per second, others are rejected
+#define TYPING_MAX_PINGS_PER_SEC 20
+
+enum {
+    TypingPublished,
+    TypingCoalesced,
+    TypingReceiverOffline,
+    TypingRateLimited
+};
+
+typedef struct {
+    size_t published; // pings not coalesced nor rate limited
+    size_t coalesced;
+    size_t rate_limited;
+} TypingEventsStats;
+
+// pushes typing event straight to receiver event streams, nothing is stored
+// returns one of Typing* results above or < 0 on error
+int publish_typing_event(int sender_id, int receiver_id);
+
+void get_typing_events_stats(TypingEventsStats* stats);
+
+#endif
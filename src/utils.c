@@ -44,3 +44,44 @@ char* xsprintf(const char* fmt, ...)
 
     return buffer; // Return the number of characters written
 }
+
+static int hex_digit_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+int url_decode(char* str)
+{
+    if (!str) {
+        return -1;
+    }
+
+    char* out = str;
+    for (char* in = str; *in; ++in) {
+        if (*in == '+') {
+            *out++ = ' ';
+        } else if (*in == '%') {
+            int hi = hex_digit_value(in[1]);
+            int lo = hi < 0 ? -1 : hex_digit_value(in[2]);
+            if (lo < 0) {
+                return -1; // Malformed escape
+            }
+            *out++ = (char)((hi << 4) | lo);
+            in += 2;
+        } else {
+            *out++ = *in;
+        }
+    }
+    *out = '\0';
+
+    return 0;
+}
@@ -7,4 +7,7 @@ int is_it_event_subscription(HttpRequest* req);
 
 char* xsprintf(const char* fmt, ...);
 
+// decodes %XX escapes and '+' in place, returns -1 on malformed escape
+int url_decode(char* str);
+
 #endif
@@ -97,3 +97,57 @@ void uuid4_generate(char* dst)
     }
     *dst = '\0';
 }
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/* parses canonical 8-4-4-4-12 text form into UUID4_BYTES_LEN bytes */
+int uuid4_to_bytes(const char* src, unsigned char* dst)
+{
+    int i, hi, lo;
+    for (i = 0; i < UUID4_BYTES_LEN; i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            if (*src != '-') {
+                return UUID4_EFAILURE;
+            }
+            src++;
+        }
+        hi = hex_value(src[0]);
+        if (hi < 0) {
+            return UUID4_EFAILURE;
+        }
+        lo = hex_value(src[1]);
+        if (lo < 0) {
+            return UUID4_EFAILURE;
+        }
+        dst[i] = (unsigned char)((hi << 4) | lo);
+        src += 2;
+    }
+    return *src == '\0' ? UUID4_ESUCCESS : UUID4_EFAILURE;
+}
+
+/* writes UUID4_LEN bytes of lowercase text form including terminator */
+void uuid4_from_bytes(const unsigned char* src, char* dst)
+{
+    static const char* chars = "0123456789abcdef";
+    int i;
+    for (i = 0; i < UUID4_BYTES_LEN; i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            *dst++ = '-';
+        }
+        *dst++ = chars[src[i] >> 4];
+        *dst++ = chars[src[i] & 0xf];
+    }
+    *dst = '\0';
+}
@@ -10,6 +10,7 @@
 
 #define UUID4_VERSION "1.0.0"
 #define UUID4_LEN 37
+#define UUID4_BYTES_LEN 16
 
 enum {
     UUID4_ESUCCESS = 0,
@@ -18,5 +19,7 @@ enum {
 
 int uuid4_init(void);
 void uuid4_generate(char* dst);
+int uuid4_to_bytes(const char* src, unsigned char* dst);
+void uuid4_from_bytes(const unsigned char* src, char* dst);
 
 #endif
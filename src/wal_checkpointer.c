@@ -0,0 +1,159 @@
+#include "wal_checkpointer.h"
+#include "log.h"
+#include "sqlite3.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    sqlite3* db;
+    WalCheckpointerStats stats;
+} WalCheckpointer;
+
+// every database file has own slot, its thread gets it as argument;
+// mutex guards stats of all of them and the slot count
+static WalCheckpointer checkpointers[WAL_CHECKPOINTERS_MAX];
+static size_t checkpointers_len = 0;
+static pthread_mutex_t checkpointer_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static double monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int run_checkpoint(WalCheckpointer* cp, int mode, int* wal_frames, int* checkpointed_frames)
+{
+    double start = monotonic_ms();
+    int rc = sqlite3_wal_checkpoint_v2(cp->db, NULL, mode, wal_frames, checkpointed_frames);
+    double duration = monotonic_ms() - start;
+
+    WalCheckpointerStats* stats = &cp->stats;
+    pthread_mutex_lock(&checkpointer_stats_mutex);
+    if (rc != SQLITE_OK) {
+        stats->failed_checkpoints++;
+    } else if (mode == SQLITE_CHECKPOINT_TRUNCATE) {
+        stats->truncate_checkpoints++;
+    } else {
+        stats->passive_checkpoints++;
+    }
+    stats->last_duration_ms = duration;
+    stats->total_duration_ms += duration;
+    if (duration > stats->max_duration_ms) {
+        stats->max_duration_ms = duration;
+    }
+    stats->last_wal_frames = *wal_frames;
+    pthread_mutex_unlock(&checkpointer_stats_mutex);
+
+    if (rc != SQLITE_OK) {
+        LogWarn("Wal checkpoint failed: db = %s; mode = %d; err = '%s'", stats->db_name, mode, sqlite3_errmsg(cp->db));
+        return -1;
+    }
+
+    LogTrace("Wal checkpoint done: db = %s; mode = %d; frames = %d; checkpointed = %d; duration = %.3fms",
+        stats->db_name, mode, *wal_frames, *checkpointed_frames, duration);
+    return 0;
+}
+
+static void* wal_checkpointer_worker(void* data)
+{
+    WalCheckpointer* cp = data;
+
+    const struct timespec interval = {
+        .tv_sec = WAL_CHECKPOINT_INTERVAL_MS / 1000,
+        .tv_nsec = (WAL_CHECKPOINT_INTERVAL_MS % 1000) * 1000000L,
+    };
+
+    int prev_wal_frames = -1;
+    int idle_ticks = 0;
+
+    while (1) {
+        nanosleep(&interval, NULL);
+
+        int wal_frames = 0;
+        int checkpointed_frames = 0;
+        if (run_checkpoint(cp, SQLITE_CHECKPOINT_PASSIVE, &wal_frames, &checkpointed_frames)) {
+            continue;
+        }
+
+        // wal did not grow since last tick, nobody is writing
+        if (wal_frames > 0 && wal_frames == prev_wal_frames) {
+            idle_ticks++;
+        } else {
+            idle_ticks = 0;
+        }
+        prev_wal_frames = wal_frames;
+
+        if (idle_ticks >= WAL_CHECKPOINT_IDLE_TICKS) {
+            if (run_checkpoint(cp, SQLITE_CHECKPOINT_TRUNCATE, &wal_frames, &checkpointed_frames) == 0) {
+                prev_wal_frames = wal_frames;
+            }
+            idle_ticks = 0;
+        }
+    }
+
+    return NULL;
+}
+
+int start_wal_checkpointer(const char* db_path, const char* db_name)
+{
+    if (!db_path || !db_name) {
+        return -1;
+    }
+
+    sqlite3* db = NULL;
+    if (sqlite3_open_v2(db_path, &db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK) {
+        LogErr("Cant open connection for wal checkpointer: %s", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return -1;
+    }
+
+    // truncate waits for readers to finish, but should not stall forever
+    sqlite3_busy_timeout(db, 100);
+
+    // connection learns journal mode only after first read,
+    // checkpoint on untouched connection is a no-op
+    if (sqlite3_exec(db, "SELECT 1 FROM sqlite_master LIMIT 1;", NULL, NULL, NULL) != SQLITE_OK) {
+        LogErr("Cant read database for wal checkpointer: %s", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return -1;
+    }
+
+    // slot is taken before thread starts and never given back,
+    // so failed start leaves it with zero stats
+    pthread_mutex_lock(&checkpointer_stats_mutex);
+    if (checkpointers_len == WAL_CHECKPOINTERS_MAX) {
+        pthread_mutex_unlock(&checkpointer_stats_mutex);
+        LogErr("Too many wal checkpointers");
+        sqlite3_close(db);
+        return -1;
+    }
+    WalCheckpointer* cp = &checkpointers[checkpointers_len++];
+    cp->db = db;
+    snprintf(cp->stats.db_name, sizeof(cp->stats.db_name), "%s", db_name);
+    pthread_mutex_unlock(&checkpointer_stats_mutex);
+
+    pthread_t thrd;
+    if (pthread_create(&thrd, NULL, wal_checkpointer_worker, cp)) {
+        LogErr("Cant create wal checkpointer thread");
+        sqlite3_close(db);
+        return -1;
+    }
+    pthread_detach(thrd);
+
+    LogInfo("Wal checkpointer started for '%s'", db_path);
+    return 0;
+}
+
+size_t get_wal_checkpointer_stats(WalCheckpointerStats stats[WAL_CHECKPOINTERS_MAX])
+{
+    pthread_mutex_lock(&checkpointer_stats_mutex);
+    size_t len = checkpointers_len;
+    for (size_t i = 0; i < len; i++) {
+        memcpy(&stats[i], &checkpointers[i].stats, sizeof(stats[i]));
+    }
+    pthread_mutex_unlock(&checkpointer_stats_mutex);
+    return len;
+}
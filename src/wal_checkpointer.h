@@ -0,0 +1,32 @@
+#ifndef WAL_CHECKPOINTER_H
+#define WAL_CHECKPOINTER_H
+
+#include <stddef.h>
+
+// how often passive checkpoint runs
+#define WAL_CHECKPOINT_INTERVAL_MS 1000
+// wal is truncated after this many ticks without new frames
+#define WAL_CHECKPOINT_IDLE_TICKS 5
+
+// one checkpointer per database file
+#define WAL_CHECKPOINTERS_MAX DB_SHARDS
+
+typedef struct {
+    char db_name[32]; // "main" or "shard_N", metrics label
+    size_t passive_checkpoints;
+    size_t truncate_checkpoints;
+    size_t failed_checkpoints;
+    double last_duration_ms;
+    double max_duration_ms;
+    double total_duration_ms;
+    int last_wal_frames;
+} WalCheckpointerStats;
+
+// opens own connection to db_path and starts detached thread,
+// called once per database file; db_name labels its stats
+int start_wal_checkpointer(const char* db_path, const char* db_name);
+
+// copies stats of every started checkpointer, returns their number
+size_t get_wal_checkpointer_stats(WalCheckpointerStats stats[WAL_CHECKPOINTERS_MAX]);
+
+#endif
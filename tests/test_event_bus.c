@@ -0,0 +1,124 @@
+#include "test.h"
+#include "event_bus.h"
+#include "events.h"
+#include "log.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// subscribers connect and disconnect in a loop while publishers fan
+// events out to them and a joiner keeps growing slot array under
+// subscribers reading their own slots; unlocked access to the array
+// is a race only thread sanitizer reports reliably:
+// make clean test SANITIZE=thread
+
+#define TEST_SUBSCRIBERS 8
+#define TEST_PUBLISHERS 4
+#define TEST_ROUNDS 5000
+// users which only connect, every one of them grows slot array
+#define TEST_JOINERS 2000
+
+static EventBus eb;
+static atomic_int subscribers_left = TEST_SUBSCRIBERS;
+
+static void publish_typing(int user_id)
+{
+    EventTyping ev;
+    CHECK(create_event_typing(&ev, "00000000-0000-0000-0000-000000000000", 0) == 0);
+    add_new_event_to_queue_by_user_id(&eb, user_id, (EventBase*)&ev);
+}
+
+static void* subscriber(void* arg)
+{
+    int user_id = (int)(size_t)arg;
+    for (int round = 0; round < TEST_ROUNDS; round++) {
+        int index = add_new_user_id_with_queue_to_event_bus(&eb, user_id);
+        CHECK(index >= 0);
+
+        // own event guarantees wait below returns
+        publish_typing(user_id);
+        EventBase* ev;
+        CHECK(get_or_wait_for_new_event_in_queue_by_index(&eb, index, &ev) == 0);
+        free_event_base(ev);
+
+        while (try_get_new_event_in_queue_by_index(&eb, index, &ev) == 0) {
+            free_event_base(ev);
+        }
+        disconnect_from_queue_by_index(&eb, index);
+    }
+
+    atomic_fetch_sub(&subscribers_left, 1);
+    return NULL;
+}
+
+static void* joiner(void* arg)
+{
+    static int indexes[TEST_JOINERS];
+    int joined = 0;
+    // spread over whole run, so array grows while subscribers read it
+    while (joined < TEST_JOINERS && atomic_load(&subscribers_left) > 0) {
+        indexes[joined] = add_new_user_id_with_queue_to_event_bus(&eb, 1000 + joined);
+        CHECK(indexes[joined] >= 0);
+        joined++;
+        nanosleep(&(struct timespec) { .tv_nsec = 20 * 1000L }, NULL);
+    }
+    for (int i = 0; i < joined; i++) {
+        disconnect_from_queue_by_index(&eb, indexes[i]);
+    }
+    return NULL;
+}
+
+static void* publisher(void* arg)
+{
+    unsigned seed = (unsigned)(size_t)arg;
+    const int all[TEST_SUBSCRIBERS] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    while (atomic_load(&subscribers_left) > 0) {
+        if (rand_r(&seed) % 2) {
+            publish_typing(1 + rand_r(&seed) % TEST_SUBSCRIBERS);
+            continue;
+        }
+
+        EventTyping ev;
+        CHECK(create_event_typing(&ev, "00000000-0000-0000-0000-000000000000", 0) == 0);
+        add_new_event_to_queues_by_user_ids(&eb, all, TEST_SUBSCRIBERS, (EventBase*)&ev);
+
+        int online[TEST_SUBSCRIBERS];
+        get_users_presence(&eb, all, TEST_SUBSCRIBERS, online);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    LogMaxVerbosity = LOG_VERBOSITY_Error;
+    CHECK(create_event_bus(&eb) == 0);
+
+    pthread_t threads[TEST_SUBSCRIBERS + TEST_PUBLISHERS + 1];
+    for (size_t i = 0; i < TEST_SUBSCRIBERS; i++) {
+        CHECK(pthread_create(&threads[i], NULL, subscriber, (void*)(i + 1)) == 0);
+    }
+    for (size_t i = 0; i < TEST_PUBLISHERS; i++) {
+        CHECK(pthread_create(&threads[TEST_SUBSCRIBERS + i], NULL, publisher, (void*)(i + 1)) == 0);
+    }
+    CHECK(pthread_create(&threads[TEST_SUBSCRIBERS + TEST_PUBLISHERS], NULL, joiner, NULL) == 0);
+    for (size_t i = 0; i <= TEST_SUBSCRIBERS + TEST_PUBLISHERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // every slot is free again, so no user is online
+    for (int user_id = 1; user_id <= TEST_SUBSCRIBERS; user_id++) {
+        CHECK(!is_user_connected_to_event_bus(&eb, user_id));
+    }
+    CHECK(!is_user_connected_to_event_bus(&eb, 1000));
+    CHECK(eb.user_queues_len <= TEST_SUBSCRIBERS + TEST_JOINERS);
+
+    for (size_t i = 0; i < eb.user_queues_len; i++) {
+        free(eb.user_queues[i]);
+    }
+    free(eb.user_queues);
+    pthread_mutex_destroy(&eb.mutex);
+
+    printf("event bus: %d subscribers x %d rounds, %d publishers, %d joiners ok\n",
+        TEST_SUBSCRIBERS, TEST_ROUNDS, TEST_PUBLISHERS, TEST_JOINERS);
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include "test.h"
+#include "http.h"
+#include "json_reader.h"
+#include "log.h"
+#include <string.h>
+
+// corpus of request bodies run through generated decoders: truncated,
+// duplicate keys, wrong types and bodies too big for thread pool;
+// every body is copied with padding first since decoding is in place
+
+typedef struct {
+    char* session_key;
+    int limit;
+    int64_t since;
+    JsonStringArray uuids;
+} TestInput;
+
+#define TEST_INPUT_FIELDS(FIELD)               \
+    FIELD(TestInput, session_key, string)      \
+    FIELD(TestInput, limit, int)               \
+    FIELD(TestInput, since, int64)             \
+    FIELD(TestInput, uuids, string_array)
+
+JSON_DECODER(parse_test_input, TestInput, TEST_INPUT_FIELDS)
+
+static char* padded_copy(const char* body, size_t body_len)
+{
+    char* copy = calloc(1, body_len + HTTP_REQUEST_BODY_PADDING);
+    CHECK(copy);
+    memcpy(copy, body, body_len);
+    return copy;
+}
+
+static int decode(const char* body, size_t body_len, TestInput* input)
+{
+    char* copy = padded_copy(body, body_len);
+    int rc = parse_test_input(body_len, copy, input);
+    // strings pointed into copy, only return code is left to check
+    json_free_string_array(&input->uuids);
+    free(copy);
+    return rc;
+}
+
+static const struct {
+    const char* body;
+    int rc;
+} corpus[] = {
+    // well formed, order and extra keys don't matter
+    { "{\"session_key\":\"k\",\"limit\":1,\"since\":2,\"uuids\":[]}", 0 },
+    { "{\"uuids\":[\"a\",\"b\"],\"x\":{\"limit\":\"no\"},\"since\":-9,\"limit\":-1,\"session_key\":\"\"}", 0 },
+    { " \r\n{\"session_key\":\"\\u0000\\\"\",\"limit\":0,\"since\":0,\"uuids\":[\"\\ud83d\\ude00\"]} ", 0 },
+    // truncated
+    { "", -2 },
+    { "{", -2 },
+    { "{\"session_key\"", -2 },
+    { "{\"session_key\":\"k", -2 },
+    { "{\"session_key\":\"k\",\"limit\":1,\"since\":2,\"uuids\":[\"a\"", -2 },
+    { "{\"session_key\":\"k\",\"limit\":1,\"since\":2,\"uuids\":[]", -2 },
+    { "{\"session_key\":\"k\\", -2 },
+    { "{\"session_key\":\"k\",\"limit\":1e", -2 },
+    // not an object
+    { "[]", -3 },
+    { "\"session_key\"", -3 },
+    { "null", -3 },
+    { "1", -3 },
+    // missing field
+    { "{}", -4 },
+    { "{\"session_key\":\"k\",\"limit\":1,\"since\":2}", -4 },
+    { "{\"session_ke\":\"k\",\"limit\":1,\"since\":2,\"uuids\":[]}", -4 },
+    { "{\"session_keyy\":\"k\",\"limit\":1,\"since\":2,\"uuids\":[]}", -4 },
+    { "{\"\":\"k\",\"limit\":1,\"since\":2,\"uuids\":[]}", -4 },
+    // wrong type
+    { "{\"session_key\":1,\"limit\":1,\"since\":2,\"uuids\":[]}", -4 },
+    { "{\"session_key\":\"k\",\"limit\":\"1\",\"since\":2,\"uuids\":[]}", -4 },
+    { "{\"session_key\":\"k\",\"limit\":1.5,\"since\":2,\"uuids\":[]}", -4 },
+    { "{\"session_key\":\"k\",\"limit\":2147483648,\"since\":2,\"uuids\":[]}", -4 },
+    { "{\"session_key\":\"k\",\"limit\":1,\"since\":9223372036854775808,\"uuids\":[]}", -4 },
+    { "{\"session_key\":\"k\",\"limit\":1,\"since\":true,\"uuids\":[]}", -4 },
+    { "{\"session_key\":\"k\",\"limit\":1,\"since\":2,\"uuids\":[1]}", -4 },
+    { "{\"session_key\":\"k\",\"limit\":1,\"since\":2,\"uuids\":{}}", -4 },
+    { "{\"session_key\":null,\"limit\":1,\"since\":2,\"uuids\":[]}", -4 },
+    // duplicate keys, first one wins whatever comes after it
+    { "{\"session_key\":\"k\",\"session_key\":1,\"limit\":1,\"since\":2,\"uuids\":[]}", 0 },
+    { "{\"session_key\":1,\"session_key\":\"k\",\"limit\":1,\"since\":2,\"uuids\":[]}", -4 },
+    { "{\"limit\":1,\"limit\":\"x\",\"session_key\":\"k\",\"since\":2,\"uuids\":[],\"uuids\":5}", 0 },
+};
+
+static void check_corpus(void)
+{
+    for (size_t i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+        TestInput input;
+        int rc = decode(corpus[i].body, strlen(corpus[i].body), &input);
+        if (rc != corpus[i].rc) {
+            fprintf(stderr, "corpus[%zu] '%s': got %d, want %d\n", i, corpus[i].body, rc, corpus[i].rc);
+        }
+        CHECK(rc == corpus[i].rc);
+    }
+}
+
+static void check_values(void)
+{
+    const char body[] = "{\"limit\":7,\"limit\":8,\"session_key\":\"a\\\"b\",\"since\":-5,\"uuids\":[\"x\",\"y\\n\"]}";
+    char* copy = padded_copy(body, sizeof(body) - 1);
+    TestInput input;
+    CHECK(parse_test_input(sizeof(body) - 1, copy, &input) == 0);
+    CHECK(strcmp(input.session_key, "a\"b") == 0);
+    CHECK(input.limit == 7);
+    CHECK(input.since == -5);
+    CHECK(input.uuids.len == 2 && strcmp(input.uuids.items[0], "x") == 0 && strcmp(input.uuids.items[1], "y\n") == 0);
+    json_free_string_array(&input.uuids);
+    free(copy);
+
+    // failed decode leaves nothing pointing into body
+    const char bad[] = "{\"session_key\":\"k\",\"limit\":\"1\"}";
+    copy = padded_copy(bad, sizeof(bad) - 1);
+    CHECK(parse_test_input(sizeof(bad) - 1, copy, &input) == -4);
+    CHECK(input.uuids.items == NULL);
+    free(copy);
+}
+
+// documents bigger than JSON_READER_POOL_SIZE are parsed with malloc
+static void check_oversize(void)
+{
+    size_t items = JSON_READER_POOL_SIZE;
+    size_t cap = items * 5 + 128;
+    char* body = malloc(cap);
+    CHECK(body);
+    size_t len = snprintf(body, cap, "{\"session_key\":\"k\",\"limit\":1,\"since\":2,\"uuids\":[");
+    for (size_t i = 0; i < items; i++) {
+        len += snprintf(body + len, cap - len, i ? ",\"%zu\"" : "\"%zu\"", i % 10);
+    }
+    len += snprintf(body + len, cap - len, "]}");
+
+    char* copy = padded_copy(body, len);
+    TestInput input;
+    CHECK(parse_test_input(len, copy, &input) == 0);
+    CHECK(input.uuids.len == items);
+    CHECK(input.uuids.items[items - 1][0] == (char)('0' + (items - 1) % 10));
+    json_free_string_array(&input.uuids);
+    free(copy);
+
+    // same body cut anywhere never parses
+    for (size_t cut = len - 1; cut > len - 64; cut--) {
+        CHECK(decode(body, cut, &input) == -2);
+    }
+
+    // deep nesting in an ignored key
+    size_t depth = 100000;
+    char* deep = malloc(depth * 2 + 64);
+    CHECK(deep);
+    len = snprintf(deep, 64, "{\"x\":");
+    memset(deep + len, '[', depth);
+    memset(deep + len + depth, ']', depth);
+    len += depth * 2;
+    len += snprintf(deep + len, 64, "}");
+    CHECK(decode(deep, len, &input) == -4);
+
+    free(deep);
+    free(body);
+}
+
+int main(void)
+{
+    LogMaxVerbosity = LOG_VERBOSITY_Error;
+
+    check_corpus();
+    check_values();
+    check_oversize();
+
+    printf("json reader: %zu corpus bodies ok\n", sizeof(corpus) / sizeof(corpus[0]));
+    return 0;
+}